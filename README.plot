@@ -1,5 +0,0 @@
-The Power Page is optionally capable to plot a power shart if the headers are detected from the makefile.
-
-https://github.com/bertrandmartel/plot-sdl
-
-Apply the plot-sdl-lib.patch to plot-sdl, build and install in /usr/local
@@ -0,0 +1,568 @@
+/*
+ * alrmSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The alarm engine. The rules live in the alarms table of the configuration
+ * database, each with a channel, a comparator, a threshold with hysteresis,
+ * a delay before it goes off, a severity and a sound. The engine subscribes
+ * to the data bus and evaluates the rules of a channel as soon as a sample
+ * of it arrives, so the latency of an alarm is that of the sample itself.
+ * Besides plain limits there are rules on the gust above the ten minute
+ * mean, on the trend of a channel, on the distance from where the vessel
+ * settled at anchor and on a channel that has gone silent. The other rules
+ * clear when their channel has been silent for a few seconds.
+ * An alarm that sounds may be acknowledged, which silences it until it has
+ * cleared, or for the highest severity only snoozed for a while.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define ALRM_MAX        32      // Rules
+#define ALRM_NOTICE     1       // Severity that does not keep the vessel from being calm
+#define ALRM_SEVERE     3       // Severity that can only be snoozed
+#define ALRM_SNOOZE     120     // Seconds a severe alarm stays quiet
+#define ALRM_ANCHOR_SET 0.5     // Max SOG the last 10 min to set the anchor position
+#define ALRM_ANCHOR_OFF 1.5     // SOG that clears it
+#define ALRM_SLOPE      30      // Seconds in each half of a trend
+#define ALRM_STALE      4       // Seconds before the last sample is too old to judge, as S_TIMEOUT
+
+enum alrmCmps {
+    ALRM_BELOW = 0,     // Value below threshold
+    ALRM_ABOVE,         // Value above threshold
+    ALRM_GUST,          // Value above the 10 min mean by threshold
+    ALRM_FALL,          // Falling faster than threshold per minute
+    ALRM_RISE,          // Rising faster than threshold per minute
+    ALRM_DRAG,          // Position further than threshold meters from the anchor
+    ALRM_LOST           // No sample for threshold seconds
+};
+
+enum alrmStates {
+    ALRM_OFF = 0,
+    ALRM_PENDING,       // Condition met, waiting for the delay
+    ALRM_ACTIVE,
+    ALRM_ACKED
+};
+
+typedef struct {
+    char    name[40];
+    int     chan;
+    int     cmp;
+    float   threshold;
+    float   hysteresis;
+    int     delay;          // Seconds
+    int     severity;
+    char    sound[40];
+    int     state;
+    time_t  since;          // Start of the pending state
+    time_t  snoozed;        // Quiet until
+    float   value;          // Last evaluated value
+} alrmRule;
+
+static const char *chanNames[BUS_NCHAN] = {
+    "SOG", "STW", "DBT", "MTW", "HDM", "ROLL", "AWA", "AWS",
+    "TWA", "TWS", "VOLT", "CURR", "TEMP", "POWER", "POS"
+};
+
+static const char *cmpNames[] = { "<", ">", "gust", "fall", "rise", "drag", "lost" };
+
+static alrmRule rules[ALRM_MAX];
+static int nrules;
+static SDL_mutex *alrmLock;
+static int alrmEvent = -1;      // eventfd, raised alarms wake up the sound player
+static time_t lastSeen[BUS_NCHAN];
+static double anchorLat, anchorLon;
+static int anchorSet;
+static float lastSog;
+
+static int alrmLookup(const char **names, int n, const char *name)
+{
+    for (int i = 0; i < n; i++) {
+        if (name != NULL && !strcasecmp(names[i], name))
+            return i;
+    }
+
+    return -1;
+}
+
+static void alrmExec(sqlite3 *conn, const char *sql)
+{
+    char *err = NULL;
+
+    if (sqlite3_exec(conn, sql, NULL, NULL, &err) != SQLITE_OK) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Alarm table: %s", err);
+        sqlite3_free(err);
+    }
+}
+
+// The rules of old are the warnings, the rest are new
+static void alrmDefaults(sqlite3 *conn, const warnings *warn)
+{
+    char buf[512];
+
+    snprintf(buf, sizeof(buf),
+        "INSERT INTO alarms (name,chan,cmp,threshold,hysteresis,delay,severity,sound,enabled) VALUES "
+        "('Shallow water','DBT','<',%.1f,0.5,0,3,'shallow-water.wav',1),"
+        "('High current','CURR','<',%.1f,1.0,5,2,'current-high.wav',1),"
+        "('Low voltage','VOLT','<',%.1f,0.2,30,2,'low-voltage.wav',1)",
+            warn->depthw, -warn->highcurrw, warn->lowvoltw);
+    alrmExec(conn, buf);
+
+    alrmExec(conn,
+        "INSERT INTO alarms (name,chan,cmp,threshold,hysteresis,delay,severity,sound,enabled) VALUES "
+        "('Anchor drag','POS','drag',50,10,20,3,'alarm.wav',1),"
+        "('Wind gust','AWS','gust',5,1,0,1,'alarm.wav',0),"
+        "('Depth falling','DBT','fall',1,0.2,10,2,'shallow-water.wav',0),"
+        "('Depth lost','DBT','lost',30,0,0,1,'',1),"
+        "('Position lost','POS','lost',30,0,0,1,'',1)");
+}
+
+// Read the rules. Alarms that are still there keep their state.
+int alrmLoad(sqlite3 *conn, const warnings *warn)
+{
+    alrmRule loaded[ALRM_MAX];
+    sqlite3_stmt *res;
+    int n = 0;
+
+    if (conn == NULL)
+        return -1;
+
+    if (alrmLock == NULL && (alrmLock = SDL_CreateMutex()) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "alrmLoad: %s", SDL_GetError());
+        return -1;
+    }
+
+    if (alrmEvent < 0 && (alrmEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "alrmLoad: eventfd: %s", strerror(errno));
+
+    alrmExec(conn, "CREATE TABLE IF NOT EXISTS alarms (Id INTEGER PRIMARY KEY, name TEXT, chan TEXT, cmp TEXT, "
+        "threshold REAL, hysteresis REAL, delay INTEGER, severity INTEGER, sound TEXT, enabled INTEGER)");
+
+    if (sqlite3_prepare_v2(conn, "select count(*) from alarms", -1, &res, NULL) == SQLITE_OK) {
+        if (sqlite3_step(res) == SQLITE_ROW && sqlite3_column_int(res, 0) == 0)
+            alrmDefaults(conn, warn);
+        sqlite3_finalize(res);
+    }
+
+    if (sqlite3_prepare_v2(conn, "select name,chan,cmp,threshold,hysteresis,delay,severity,sound from alarms where enabled = 1",
+            -1, &res, NULL) != SQLITE_OK) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to fetch alarms from database: %s", (char*)sqlite3_errmsg(conn));
+        return -1;
+    }
+
+    memset(loaded, 0, sizeof(loaded));
+
+    while (n < ALRM_MAX && sqlite3_step(res) == SQLITE_ROW) {
+        alrmRule *r = &loaded[n];
+
+        if (sqlite3_column_text(res, 0) == NULL)
+            continue;
+
+        snprintf(r->name, sizeof(r->name), "%s", (const char*)sqlite3_column_text(res, 0));
+        r->chan = alrmLookup(chanNames, BUS_NCHAN, (const char*)sqlite3_column_text(res, 1));
+        r->cmp = alrmLookup(cmpNames, sizeof(cmpNames)/sizeof(cmpNames[0]), (const char*)sqlite3_column_text(res, 2));
+        r->threshold = sqlite3_column_double(res, 3);
+        r->hysteresis = fabs(sqlite3_column_double(res, 4));
+        r->delay = sqlite3_column_int(res, 5);
+        r->severity = sqlite3_column_int(res, 6);
+        snprintf(r->sound, sizeof(r->sound), "%s", sqlite3_column_text(res, 7)? (const char*)sqlite3_column_text(res, 7) : "");
+
+        // A position has no value of its own to compare
+        if (r->chan < 0 || r->cmp < 0 || (r->chan == BUS_POS? r->cmp != ALRM_DRAG && r->cmp != ALRM_LOST : r->cmp == ALRM_DRAG)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Alarm %s: Bad channel or comparator, ignored", r->name);
+            continue;
+        }
+        n++;
+    }
+
+    sqlite3_finalize(res);
+
+    SDL_LockMutex(alrmLock);
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < nrules; j++) {
+            if (!strcmp(loaded[i].name, rules[j].name)) {
+                loaded[i].state = rules[j].state;
+                loaded[i].since = rules[j].since;
+                loaded[i].snoozed = rules[j].snoozed;
+                loaded[i].value = rules[j].value;
+            }
+        }
+    }
+
+    memcpy(rules, loaded, sizeof(rules));
+    nrules = n;
+
+    SDL_UnlockMutex(alrmLock);
+
+    SDL_Log("%d alarm rules loaded", n);
+
+    return 0;
+}
+
+// Channels with rules, for the bus subscription
+static uint32_t alrmMask(void)
+{
+    uint32_t mask = 0;
+
+    for (int i = 0; i < nrules; i++)
+        mask |= BUS_MASK(rules[i].chan);
+
+    // Anchor watch needs to know when the vessel lies still
+    return mask & BUS_MASK(BUS_POS)? mask | BUS_MASK(HIST_SOG) : mask;
+}
+
+// Change per minute from the mean of the last half minute and the one before
+static float alrmSlope(int chan, time_t ct)
+{
+    histStat then, now;
+
+    if (!histStats(chan, ct - 2*ALRM_SLOPE, ct - ALRM_SLOPE, &then) || !histStats(chan, ct - ALRM_SLOPE, ct, &now))
+        return NAN;
+
+    return (now.mean - then.mean) * 60/ALRM_SLOPE;
+}
+
+static float alrmDistance(double lat1, double lon1, double lat2, double lon2)
+{
+    double dy = (lat2 - lat1) * 60*1852;
+    double dx = (lon2 - lon1) * 60*1852 * cos((lat1 + lat2)/2 * M_PI/180);
+
+    return hypot(dx, dy);
+}
+
+// Under way again, off at once before a distance is judged
+static void alrmAnchorOff(void)
+{
+    if (anchorSet && lastSog > ALRM_ANCHOR_OFF) {
+        anchorSet = 0;
+        logbEvent("Anchor watch off");
+    }
+}
+
+static void alrmAnchor(const busMsg *msg)
+{
+    statValue st;
+
+    if (!anchorSet) {
+        if (statGet(HIST_SOG, STAT_10MIN, &st) >= 300 && st.max < ALRM_ANCHOR_SET && lastSog < ALRM_ANCHOR_SET) {
+            anchorLat = msg->val;
+            anchorLon = msg->val2;
+            anchorSet = 1;
+            logbEvent("Anchor watch set at %.5f %.5f", anchorLat, anchorLon);
+        }
+    } else
+        alrmAnchorOff();
+}
+
+// The value of a sample as seen by a rule, NAN if the rule has no say
+static float alrmValue(alrmRule *r, const busMsg *msg)
+{
+    statValue st;
+    float v;
+
+    switch (r->cmp) {
+        case ALRM_GUST:
+            if (statGet(r->chan, STAT_10MIN, &st) < 60)
+                return NAN;
+            return msg->val - st.mean;
+        case ALRM_FALL:
+            return -alrmSlope(r->chan, msg->ts);
+        case ALRM_RISE:
+            return alrmSlope(r->chan, msg->ts);
+        case ALRM_DRAG:
+            return anchorSet? alrmDistance(anchorLat, anchorLon, msg->val, msg->val2) : NAN;
+        case ALRM_LOST:
+            return NAN;     // Only by the clock
+        default:
+            v = msg->val;
+            return r->cmp == ALRM_BELOW? -v : v;
+    }
+}
+
+/*
+ * Advance the state of a rule with a new value. The values of all
+ * comparators are turned so that the alarm is above the threshold.
+ */
+static int alrmStep(alrmRule *r, float v, time_t ct)
+{
+    float limit = r->cmp == ALRM_BELOW? -r->threshold : r->threshold;
+    int raised = 0;
+
+    if (isnan(v)) {
+        // No longer judgeable, i.e. the anchor watch went off
+        if (r->cmp == ALRM_DRAG || r->cmp == ALRM_GUST)
+            v = -INFINITY;
+        else
+            return 0;
+    }
+
+    r->value = r->cmp == ALRM_BELOW? -v : v;
+
+    switch (r->state) {
+        case ALRM_OFF:
+            if (v <= limit)
+                break;
+            r->state = ALRM_PENDING;
+            r->since = ct;
+            /* Fall through */
+        case ALRM_PENDING:
+            if (v <= limit)
+                r->state = ALRM_OFF;
+            else if (ct - r->since >= r->delay) {
+                r->state = ALRM_ACTIVE;
+                r->snoozed = 0;
+                raised = 1;
+                logbEvent("Alarm: %s %.1f", r->name, r->value);
+                metrAdd(METR_ALARMS, 1);
+            }
+            break;
+        default:
+            if (v <= limit - r->hysteresis) {
+                r->state = ALRM_OFF;
+                logbEvent("Alarm cleared: %s", r->name);
+            }
+            break;
+    }
+
+    return raised;
+}
+
+static void alrmRaised(void)
+{
+    govWake();
+
+    if (alrmEvent >= 0)
+        (void)eventfd_write(alrmEvent, 1);
+}
+
+static void alrmSample(const busMsg *msg)
+{
+    int raised = 0;
+
+    lastSeen[msg->chan] = msg->ts;
+
+    if (msg->chan == HIST_SOG) {
+        lastSog = msg->val;
+        alrmAnchorOff();
+    }
+
+    if (msg->chan == BUS_POS)
+        alrmAnchor(msg);
+
+    SDL_LockMutex(alrmLock);
+
+    for (int i = 0; i < nrules; i++) {
+        if (rules[i].chan != msg->chan)
+            continue;
+        // The channel is back, no need to wait for the clock
+        if (rules[i].cmp == ALRM_LOST)
+            raised |= alrmStep(&rules[i], 0, msg->ts);
+        else
+            raised |= alrmStep(&rules[i], alrmValue(&rules[i], msg), msg->ts);
+    }
+
+    SDL_UnlockMutex(alrmLock);
+
+    if (raised)
+        alrmRaised();
+}
+
+// Once a second for what has no sample to wait for
+static void alrmTick(time_t ct)
+{
+    int raised = 0;
+
+    SDL_LockMutex(alrmLock);
+
+    for (int i = 0; i < nrules; i++) {
+        alrmRule *r = &rules[i];
+
+        if (r->cmp == ALRM_LOST) {
+            if (lastSeen[r->chan])
+                raised |= alrmStep(r, ct - lastSeen[r->chan], ct);
+        } else if (r->state != ALRM_OFF && ct - lastSeen[r->chan] > ALRM_STALE) {
+            // The source went quiet, a lost rule may take over
+            if (r->state != ALRM_PENDING)
+                logbEvent("Alarm cleared: %s, no data", r->name);
+            r->state = ALRM_OFF;
+        } else if (r->state == ALRM_PENDING) {
+            raised |= alrmStep(r, r->cmp == ALRM_BELOW? -r->value : r->value, ct);
+        } else if (r->state == ALRM_ACTIVE && r->snoozed && r->snoozed <= ct) {
+            r->snoozed = 0;
+            raised = 1;
+        }
+    }
+
+    SDL_UnlockMutex(alrmLock);
+
+    if (raised)
+        alrmRaised();
+}
+
+// Evaluate the rules as the data arrives on the bus
+int threadAlarm(void *conf)
+{
+    configuration *configParams = conf;
+    busSub *bus;
+    busMsg msg;
+    uint32_t mask;
+    time_t tick = 0;
+
+    if (alrmLock == NULL)
+        return 0;
+
+    SDL_LockMutex(alrmLock);
+    mask = alrmMask();
+    SDL_UnlockMutex(alrmLock);
+
+    if ((bus = busSubscribe(mask, 0)) == NULL)
+        return 0;
+
+    SDL_Log("Alarm engine started");
+
+    while (configParams->runAlm) {
+        time_t ct;
+
+        if (thrdWait(busFd(bus), POLLIN, 1000) < 0)
+            break;
+
+        while (busPoll(bus, &msg))
+            alrmSample(&msg);
+
+        if ((ct = time(NULL)) != tick) {
+            tick = ct;
+            alrmTick(ct);
+
+            // The rules may have been reloaded
+            SDL_LockMutex(alrmLock);
+            if ((mask = alrmMask()) != 0)
+                busWatch(bus, mask);
+            SDL_UnlockMutex(alrmLock);
+        }
+    }
+
+    busUnsubscribe(bus);
+
+    SDL_Log("Alarm engine stopped");
+
+    return 0;
+}
+
+// Active alarms not acknowledged. With all also those of the lowest
+// severity, but not those snoozed.
+static int alrmCount(int all)
+{
+    time_t ct = time(NULL);
+    int n = 0;
+
+    if (alrmLock == NULL)
+        return 0;
+
+    SDL_LockMutex(alrmLock);
+
+    for (int i = 0; i < nrules; i++)
+        n += rules[i].state == ALRM_ACTIVE && (all? rules[i].snoozed <= ct : rules[i].severity > ALRM_NOTICE);
+
+    SDL_UnlockMutex(alrmLock);
+
+    return n;
+}
+
+// Alarms that keep the vessel from being calm
+int alrmActive(void)
+{
+    return alrmCount(0);
+}
+
+// Alarms to acknowledge, with a sound or silent
+int alrmUnacked(void)
+{
+    return alrmCount(1);
+}
+
+// The alarms that are to be heard, at most max of them. Returns how many there are.
+int alrmSounding(alrmSound *out, int max)
+{
+    time_t ct = time(NULL);
+    int n = 0;
+
+    if (alrmLock == NULL)
+        return 0;
+
+    SDL_LockMutex(alrmLock);
+
+    for (int i = 0; i < nrules; i++) {
+        alrmRule *r = &rules[i];
+
+        if (r->state != ALRM_ACTIVE || r->snoozed > ct || !r->sound[0])
+            continue;
+
+        if (n < max) {
+            snprintf(out[n].sound, sizeof(out[n].sound), "%s", r->sound);
+            out[n].severity = r->severity;
+        }
+        n++;
+    }
+
+    SDL_UnlockMutex(alrmLock);
+
+    return n;
+}
+
+// Silence what sounds: until cleared, or for a while if severe
+void alrmAck(void)
+{
+    time_t ct = time(NULL);
+
+    if (alrmLock == NULL)
+        return;
+
+    SDL_LockMutex(alrmLock);
+
+    for (int i = 0; i < nrules; i++) {
+        alrmRule *r = &rules[i];
+
+        if (r->state != ALRM_ACTIVE || r->snoozed > ct)
+            continue;
+
+        if (r->severity >= ALRM_SEVERE) {
+            r->snoozed = ct + ALRM_SNOOZE;
+            logbEvent("Alarm snoozed: %s", r->name);
+        } else {
+            r->state = ALRM_ACKED;
+            logbEvent("Alarm acknowledged: %s", r->name);
+        }
+    }
+
+    SDL_UnlockMutex(alrmLock);
+}
+
+// Wait up to ms for an alarm to be raised, as thrdWait()
+int alrmWait(int ms)
+{
+    int rval = thrdWait(alrmEvent, POLLIN, ms);
+
+    if (rval > 0) {
+        eventfd_t dummy;
+        (void)eventfd_read(alrmEvent, &dummy);
+    }
+
+    return rval;
+}
@@ -0,0 +1,622 @@
+/*
+ * archSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The long term archive of the history store.
+ * Each completed hour is rolled out of the history store into a compressed
+ * chunk appended to a file per day. A chunk holds one column of timestamps,
+ * as delta-of-delta varints with runs of zeros collapsed, and one column per
+ * channel where each float is XOR'ed with the previous one and bit packed
+ * with its leading and trailing zeros dropped (as in Facebook's Gorilla).
+ * A steady 1 Hz hour of a slowly changing channel is a few hundred bytes.
+ * An index file holds the position and min/max/sum of every chunk, so plots
+ * with buckets of an hour or more never touch the data files.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>   // For the purpose of logging
+#include "sdlSpeedometer.h"
+
+#define ARCH_MAGIC      "SDLARCH"
+#define ARCH_VERSION    1
+#define ARCH_CHUNK      3600                    // Seconds per chunk
+#define ARCH_MAXCOL     (ARCH_CHUNK*6 + 16)     // Worst case bytes of an encoded column
+#define ARCH_LAG        5                       // Seconds into the next hour before rolling
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t nchan;
+} archHeader;
+
+typedef struct {
+    float    min;
+    float    max;
+    float    sum;
+    uint32_t count;
+} archAgg;
+
+typedef struct {
+    int64_t  start;                 // First second of the chunk
+    uint32_t day;                   // Data file as YYYYMMDD (UTC)
+    uint32_t offset;                // Position in the data file
+    uint32_t rows;                  // Timestamps in the chunk
+    uint32_t len[HIST_NCHAN+1];     // Column sizes, timestamps first
+    archAgg  agg[HIST_NCHAN];
+} archIndex;
+
+typedef struct {
+    uint8_t  *buf;
+    size_t   pos;                   // Bytes
+    uint64_t acc;                   // Pending bits
+    int      nacc;
+} archBits;
+
+static char archDir[PATH_MAX-32];
+static archIndex *chunks;           // All chunks in time order
+static int nchunks;
+static int maxchunks;
+static int idxFd = -1;
+static time_t archDone;             // Archived up to, exclusive
+static SDL_mutex *archLock;
+
+/*
+ * Encoding
+ */
+static size_t putVarint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+
+    return n;
+}
+
+static size_t getVarint(const uint8_t *p, size_t len, uint64_t *v)
+{
+    size_t n = 0;
+    int shift = 0;
+
+    *v = 0;
+    while (n < len && shift < 64) {
+        *v |= (uint64_t)(p[n] & 0x7f) << shift;
+        if (!(p[n++] & 0x80))
+            return n;
+        shift += 7;
+    }
+
+    return 0;   // Truncated
+}
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Timestamps as delta-of-delta from an implied 1 Hz start. A zero is
+// followed by the number of zeros that come after it.
+static size_t encodeTs(uint8_t *p, time_t start, const int64_t *ts, int n)
+{
+    int64_t prev = start - 1, delta = 1;
+    size_t len = 0;
+
+    for (int i = 0; i < n; ) {
+        int64_t d = ts[i] - prev;
+        int64_t dod = d - delta;
+
+        len += putVarint(p + len, zigzag(dod));
+        prev = ts[i++];
+        delta = d;
+
+        if (dod == 0) {
+            int run = 0;
+            while (i < n && ts[i] - prev == delta) {
+                prev = ts[i++];
+                run++;
+            }
+            len += putVarint(p + len, run);
+        }
+    }
+
+    return len;
+}
+
+static int decodeTs(const uint8_t *p, size_t len, time_t start, int64_t *ts, int max)
+{
+    int64_t prev = start - 1, delta = 1;
+    size_t pos = 0;
+    int n = 0;
+
+    while (pos < len && n < max) {
+        uint64_t v;
+        size_t k = getVarint(p + pos, len - pos, &v);
+
+        if (k == 0)
+            break;
+        pos += k;
+
+        delta += unzigzag(v);
+        ts[n++] = prev += delta;
+
+        if (v == 0) {
+            if ((k = getVarint(p + pos, len - pos, &v)) == 0)
+                break;
+            pos += k;
+            while (v-- && n < max)
+                ts[n++] = prev += delta;
+        }
+    }
+
+    return n;
+}
+
+static void putBits(archBits *b, uint32_t v, int n)
+{
+    if (n == 0)
+        return;
+
+    b->acc = (b->acc << n) | (v & (n == 32? 0xffffffffu : (1u << n) - 1));
+    b->nacc += n;
+
+    while (b->nacc >= 8) {
+        b->nacc -= 8;
+        b->buf[b->pos++] = (uint8_t)(b->acc >> b->nacc);
+    }
+}
+
+static void flushBits(archBits *b)
+{
+    if (b->nacc)
+        b->buf[b->pos++] = (uint8_t)(b->acc << (8 - b->nacc));
+    b->nacc = 0;
+}
+
+static uint32_t getBits(archBits *b, size_t len, int n)
+{
+    uint32_t v;
+
+    while (b->nacc < n) {
+        b->acc = (b->acc << 8) | (b->pos < len? b->buf[b->pos] : 0);
+        b->pos++;
+        b->nacc += 8;
+    }
+
+    b->nacc -= n;
+    v = (uint32_t)(b->acc >> b->nacc);
+
+    return n == 32? v : v & ((1u << n) - 1);
+}
+
+static inline uint32_t floatBits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+// XOR with the previous value. 0 = same value, 10 = meaningful bits
+// within the previous window, 11 = new window of 5 bits leading zeros
+// and 5 bits length-1 followed by the bits.
+static size_t encodeVal(uint8_t *p, const float *val, int n)
+{
+    archBits b = { .buf = p };
+    uint32_t prev = 0;
+    int plead = -1, ptrail = 0;
+
+    for (int i = 0; i < n; i++) {
+        uint32_t cur = floatBits(val[i]);
+        uint32_t x = cur ^ prev;
+
+        if (i == 0) {
+            putBits(&b, cur, 32);
+        } else if (x == 0) {
+            putBits(&b, 0, 1);
+        } else {
+            int lead = __builtin_clz(x), trail = __builtin_ctz(x);
+
+            if (plead >= 0 && lead >= plead && trail >= ptrail) {
+                putBits(&b, 2, 2);
+                putBits(&b, x >> ptrail, 32 - plead - ptrail);
+            } else {
+                putBits(&b, 3, 2);
+                putBits(&b, lead, 5);
+                putBits(&b, 32 - lead - trail - 1, 5);
+                putBits(&b, x >> trail, 32 - lead - trail);
+                plead = lead;
+                ptrail = trail;
+            }
+        }
+        prev = cur;
+    }
+
+    flushBits(&b);
+
+    return b.pos;
+}
+
+static void decodeVal(const uint8_t *p, size_t len, float *val, int n)
+{
+    archBits b = { .buf = (uint8_t*)p };
+    uint32_t prev = 0;
+    int plead = 0, ptrail = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (i == 0) {
+            prev = getBits(&b, len, 32);
+        } else if (getBits(&b, len, 1)) {
+            if (getBits(&b, len, 1)) {
+                plead = getBits(&b, len, 5);
+                ptrail = 32 - plead - (getBits(&b, len, 5) + 1);
+            }
+            prev ^= getBits(&b, len, 32 - plead - ptrail) << ptrail;
+        }
+        memcpy(&val[i], &prev, sizeof(float));
+    }
+}
+
+/*
+ * Files
+ */
+static void archDayPath(char *path, size_t size, uint32_t day)
+{
+    snprintf(path, size, "%s/%08u.arc", archDir, day);
+}
+
+static int archGrow(void)
+{
+    if (nchunks == maxchunks) {
+        int n = maxchunks? maxchunks*2 : 24*31;
+        archIndex *ix = realloc(chunks, sizeof(archIndex)*n);
+        if (ix == NULL)
+            return -1;
+        chunks = ix;
+        maxchunks = n;
+    }
+
+    return 0;
+}
+
+int archOpen(const char *dir)
+{
+    char path[PATH_MAX];
+    archHeader ah;
+    archIndex rec;
+    struct stat sb;
+
+    if (idxFd >= 0)
+        return 0;
+
+    snprintf(archDir, sizeof(archDir), "%s", dir);
+
+    if (mkdir(archDir, (mode_t)0775) < 0 && errno != EEXIST) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create archive %s: %s", archDir, strerror(errno));
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "%s/archive.idx", archDir);
+
+    if ((idxFd = open(path, O_RDWR | O_CREAT, (mode_t)0664)) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open archive chunks %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if (read(idxFd, &ah, sizeof(ah)) != sizeof(ah) || strcmp(ah.magic, ARCH_MAGIC) ||
+            ah.version != ARCH_VERSION || ah.nchan != HIST_NCHAN) {
+        if (fstat(idxFd, &sb) == 0 && sb.st_size > 0)
+            SDL_Log("Archive index %s has an old layout and will be reset", path);
+        memset(&ah, 0, sizeof(ah));
+        strcpy(ah.magic, ARCH_MAGIC);
+        ah.version = ARCH_VERSION;
+        ah.nchan = HIST_NCHAN;
+        if (ftruncate(idxFd, 0) < 0 || pwrite(idxFd, &ah, sizeof(ah), 0) != sizeof(ah)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create archive chunks %s: %s", path, strerror(errno));
+            close(idxFd);
+            idxFd = -1;
+            return -1;
+        }
+    }
+
+    // A torn record at the end from a crash is dropped
+    while (read(idxFd, &rec, sizeof(rec)) == sizeof(rec)) {
+        if (archGrow()) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "archOpen: Out of memory");
+            break;
+        }
+        chunks[nchunks++] = rec;
+    }
+
+    if (ftruncate(idxFd, sizeof(ah) + sizeof(rec)*nchunks) < 0 || lseek(idxFd, 0, SEEK_END) < 0)
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to trim archive chunks %s: %s", path, strerror(errno));
+
+    archDone = nchunks? chunks[nchunks-1].start + ARCH_CHUNK : 0;
+
+    if (archLock == NULL)
+        archLock = SDL_CreateMutex();
+
+    SDL_Log("Archive %s holds %d hours", archDir, nchunks);
+
+    return 0;
+}
+
+void archClose(void)
+{
+    if (idxFd < 0)
+        return;
+
+    close(idxFd);
+    idxFd = -1;
+    free(chunks);
+    chunks = NULL;
+    nchunks = maxchunks = 0;
+}
+
+time_t archFirst(void)
+{
+    return nchunks? chunks[0].start : 0;
+}
+
+// Encode the hour at start from the history store and append it
+static int archChunk(time_t start)
+{
+    static int64_t ts[ARCH_CHUNK];
+    static float val[ARCH_CHUNK];
+    static uint8_t col[ARCH_MAXCOL];
+    char path[PATH_MAX];
+    struct tm tm;
+    archIndex rec;
+    off_t off;
+    int rows = 0;
+    int fd;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.start = start;
+
+    // Rows with any data at all
+    for (time_t t = start; t < start + ARCH_CHUNK; t++) {
+        for (int c = 0; c < HIST_NCHAN; c++) {
+            if (!isnan(histGet(c, t))) {
+                ts[rows++] = t;
+                break;
+            }
+        }
+    }
+
+    if (rows == 0)
+        return 0;
+
+    rec.rows = rows;
+    gmtime_r(&start, &tm);
+    rec.day = (tm.tm_year + 1900)*10000 + (tm.tm_mon + 1)*100 + tm.tm_mday;
+    archDayPath(path, sizeof(path), rec.day);
+
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_APPEND, (mode_t)0664)) < 0 ||
+            (off = lseek(fd, 0, SEEK_END)) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open archive %s: %s", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    rec.offset = off;
+    rec.len[0] = encodeTs(col, start, ts, rows);
+
+    if (write(fd, col, rec.len[0]) != rec.len[0])
+        goto fail;
+
+    for (int c = 0; c < HIST_NCHAN; c++) {
+        archAgg *agg = &rec.agg[c];
+
+        for (int i = 0; i < rows; i++) {
+            float v = val[i] = histGet(c, ts[i]);
+            if (isnan(v))
+                continue;
+            if (!agg->count++) {
+                agg->min = agg->max = v;
+            } else {
+                if (v < agg->min) agg->min = v;
+                if (v > agg->max) agg->max = v;
+            }
+            agg->sum += v;
+        }
+
+        rec.len[c+1] = encodeVal(col, val, rows);
+        if (write(fd, col, rec.len[c+1]) != rec.len[c+1])
+            goto fail;
+    }
+
+    // The data must be on disk before the chunks refers to it
+    if (fdatasync(fd) < 0)
+        goto fail;
+    close(fd);
+
+    if (write(idxFd, &rec, sizeof(rec)) != sizeof(rec) || fdatasync(idxFd) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write archive chunks: %s", strerror(errno));
+        return -1;
+    }
+
+    SDL_LockMutex(archLock);
+    if (archGrow() == 0)
+        chunks[nchunks++] = rec;
+    SDL_UnlockMutex(archLock);
+
+    return 1;
+
+fail:
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write archive %s: %s", path, strerror(errno));
+    close(fd);
+    return -1;
+}
+
+// Archive the oldest completed hour still in the history store, one per call
+// so that a backlog after downtime does not hold up the history sampler.
+// Returns the number of chunks written.
+int archRoll(time_t now)
+{
+    time_t first = histFirst();
+    time_t start;
+    int n = 0;
+
+    if (idxFd < 0 || first == 0)
+        return 0;
+
+    start = archDone > first? archDone : first - first % ARCH_CHUNK;
+
+    // Hours without any samples are passed over in the same call
+    for (; n == 0 && start + ARCH_CHUNK + ARCH_LAG <= now; start += ARCH_CHUNK) {
+        int rval = archChunk(start);
+        if (rval < 0)
+            break;
+        n += rval;
+        archDone = start + ARCH_CHUNK;
+    }
+
+    return n;
+}
+
+// Decode one channel of a chunk. Returns number of rows.
+static int archDecode(const archIndex *rec, int chan, int64_t *ts, float *val)
+{
+    static uint8_t col[2][ARCH_MAXCOL];
+    static uint32_t openDay;
+    static int fd = -1;
+    char path[PATH_MAX];
+    uint32_t off = rec->offset + rec->len[0];
+    int rows;
+
+    if (fd < 0 || openDay != rec->day) {
+        if (fd >= 0)
+            close(fd);
+        archDayPath(path, sizeof(path), rec->day);
+        if ((fd = open(path, O_RDONLY)) < 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open archive %s: %s", path, strerror(errno));
+            return 0;
+        }
+        openDay = rec->day;
+    }
+
+    for (int c = 0; c < chan; c++)
+        off += rec->len[c+1];
+
+    if (rec->len[0] > ARCH_MAXCOL || rec->len[chan+1] > ARCH_MAXCOL ||
+            pread(fd, col[0], rec->len[0], rec->offset) != rec->len[0] ||
+            pread(fd, col[1], rec->len[chan+1], off) != rec->len[chan+1])
+        return 0;
+
+    rows = decodeTs(col[0], rec->len[0], rec->start, ts, ARCH_CHUNK);
+    decodeVal(col[1], rec->len[chan+1], val, rows);
+
+    return rows;
+}
+
+static void archFold(histStat *st, double *sum, float min, float max, double s, int count)
+{
+    if (!st->count) {
+        st->min = min;
+        st->max = max;
+    } else {
+        if (min < st->min) st->min = min;
+        if (max > st->max) st->max = max;
+    }
+    st->count += count;
+    *sum += s;
+}
+
+// Aggregate a channel into n equal buckets spanning [from, to) like histQuery().
+// Buckets of an hour or more are served by the chunks alone, where each chunk
+// counts in the bucket it starts in. Returns the number of non empty buckets.
+int archQuery(int chan, time_t from, time_t to, int n, histStat *out)
+{
+    static int64_t ts[ARCH_CHUNK];
+    static float val[ARCH_CHUNK];
+    double *sum;
+    double step;
+    int lo, hi;
+    int filled = 0;
+
+    if (n <= 0)
+        return 0;
+
+    for (int i = 0; i < n; i++) {
+        out[i].min = out[i].max = out[i].mean = NAN;
+        out[i].count = 0;
+    }
+
+    if (idxFd < 0 || chan < 0 || chan >= HIST_NCHAN || to <= from)
+        return 0;
+
+    if ((sum = calloc(n, sizeof(double))) == NULL)
+        return 0;
+
+    step = (double)(to - from) / n;
+
+    SDL_LockMutex(archLock);
+
+    // First chunk that ends after from
+    lo = 0, hi = nchunks;
+    while (lo < hi) {
+        int mid = (lo + hi)/2;
+        if (chunks[mid].start + ARCH_CHUNK <= from)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (int r = lo; r < nchunks && chunks[r].start < to; r++) {
+        const archIndex *rec = &chunks[r];
+
+        if (step >= ARCH_CHUNK) {
+            const archAgg *agg = &rec->agg[chan];
+            int b = (rec->start - from) / step;
+            if (rec->start < from || b >= n || agg->count == 0)
+                continue;
+            archFold(&out[b], &sum[b], agg->min, agg->max, agg->sum, agg->count);
+        } else {
+            int rows = archDecode(rec, chan, ts, val);
+            for (int i = 0; i < rows; i++) {
+                int b;
+                if (ts[i] < from || ts[i] >= to || isnan(val[i]))
+                    continue;
+                b = (ts[i] - from) / step;
+                if (b >= n) b = n-1;
+                archFold(&out[b], &sum[b], val[i], val[i], val[i], 1);
+            }
+        }
+    }
+
+    SDL_UnlockMutex(archLock);
+
+    for (int i = 0; i < n; i++) {
+        if (out[i].count) {
+            out[i].mean = sum[i] / out[i].count;
+            filled++;
+        }
+    }
+
+    free(sum);
+
+    return filled;
+}
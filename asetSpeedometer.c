@@ -0,0 +1,548 @@
+/*
+ * asetSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The asset cache. All images in the image directory are decoded by a few
+ * loader threads, in parallel and in the background, into surfaces in the
+ * format of the textures. The render thread only uploads them, a couple
+ * per frame, and keeps the textures for as long as the display is open,
+ * so a page is entered without touching the SD card. The images of the
+ * page about to be shown are decoded first, and if a page asks for one
+ * that is not done the render thread decodes it itself or waits for the
+ * loader already at it. Fonts are opened once per size and kept as well.
+ * Textures and fonts from here belong to the cache and are not destroyed
+ * by the pages.
+ * With an image pack (sdlSpeedometer -P dir, run by make install) the
+ * images are instead mapped from one file of raw pixels in the texture
+ * format and copied straight into the textures, nothing is decoded. Any
+ * image newer than the pack, or not in it, is decoded from its PNG.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include "sdlSpeedometer.h"
+
+#define ASET_MAX        64      // Images in the cache
+#define ASET_LOADERS    3       // Decoding threads, the render thread is the fourth
+#define ASET_UPLOADS    2       // Textures created per frame
+#define ASET_FONTS      16
+#define ASET_PACK       "images.pack"
+#define ASET_MAGIC      0x4b415041  // "APAK"
+#define ASET_VER        1
+#define ASET_ALIGN      64
+
+// The pack is a header, an index and the pixels of each image in ARGB8888
+typedef struct {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    count;
+    uint32_t    pad;
+} asetPackHead;
+
+typedef struct {
+    char        name[40];
+    int64_t     mtime;      // Of the PNG it was made from
+    int64_t     size;
+    uint32_t    w;
+    uint32_t    h;
+    uint32_t    pitch;
+    uint32_t    pad;
+    uint64_t    offset;
+} asetPackIndex;
+
+enum asetStates {
+    ASET_QUEUED = 0,
+    ASET_DECODING,
+    ASET_DECODED,
+    ASET_READY,
+    ASET_FAILED
+};
+
+typedef struct {
+    char        name[40];
+    int         state;
+    int         prio;       // Higher first
+    SDL_Surface *surf;
+    SDL_Texture *tex;
+    const void  *pixels;    // In the pack
+    int         w;
+    int         h;
+    int         pitch;
+} asetEntry;
+
+typedef struct {
+    char        path[PATH_MAX];
+    int         size;
+    TTF_Font    *font;
+} asetFontEntry;
+
+static asetEntry assets[ASET_MAX];
+static int nassets;
+static asetFontEntry fonts[ASET_FONTS];
+static int nfonts;
+static char asetDir[PATH_MAX];
+static SDL_Renderer *asetRenderer;
+static SDL_mutex *asetLock;
+static SDL_cond *asetDone;
+static SDL_Thread *loaders[ASET_LOADERS];
+static int asetStop;
+static int asetSeq;
+static void *asetPack;
+static size_t asetPackSize;
+
+// The next image to decode, with the lock held
+static asetEntry *asetNext(void)
+{
+    asetEntry *next = NULL;
+
+    for (int i = 0; i < nassets; i++) {
+        if (assets[i].state == ASET_QUEUED && (next == NULL || assets[i].prio > next->prio))
+            next = &assets[i];
+    }
+
+    return next;
+}
+
+// Decode with the lock held, which is released meanwhile
+static void asetDecode(asetEntry *as)
+{
+    char path[PATH_MAX+40];
+    SDL_Surface *img, *surf = NULL;
+
+    as->state = ASET_DECODING;
+    snprintf(path, sizeof(path), "%s%s", asetDir, as->name);
+
+    SDL_UnlockMutex(asetLock);
+
+    // Converted here so that the upload is a plain copy
+    if ((img = IMG_Load(path)) != NULL) {
+        surf = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(img);
+    }
+
+    if (surf == NULL)
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Image %s: %s", path, SDL_GetError());
+
+    SDL_LockMutex(asetLock);
+
+    as->surf = surf;
+    as->state = surf == NULL? ASET_FAILED : ASET_DECODED;
+    SDL_CondBroadcast(asetDone);
+}
+
+static int asetLoader(void *data)
+{
+    asetEntry *as;
+
+    (void)data;
+
+    SDL_LockMutex(asetLock);
+
+    while (!asetStop && (as = asetNext()) != NULL)
+        asetDecode(as);
+
+    SDL_UnlockMutex(asetLock);
+
+    return 0;
+}
+
+// Texture from a decoded image, in the render thread with the lock held
+static void asetUploadOne(asetEntry *as)
+{
+    SDL_Texture *tex;
+
+    if (as->pixels != NULL) {
+        if ((tex = SDL_CreateTexture(asetRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, as->w, as->h)) == NULL ||
+                SDL_UpdateTexture(tex, NULL, as->pixels, as->pitch)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Image %s: %s", as->name, SDL_GetError());
+            if (tex != NULL)
+                SDL_DestroyTexture(tex);
+            as->pixels = NULL;
+            as->state = ASET_QUEUED;    // Try the PNG
+            return;
+        }
+        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+        as->tex = tex;
+        as->state = ASET_READY;
+        return;
+    }
+
+    if ((tex = SDL_CreateTextureFromSurface(asetRenderer, as->surf)) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Image %s: %s", as->name, SDL_GetError());
+        as->state = ASET_FAILED;
+    } else {
+        as->tex = tex;
+        as->state = ASET_READY;
+    }
+
+    SDL_FreeSurface(as->surf);
+    as->surf = NULL;
+}
+
+static void asetScan(const char *dir)
+{
+    struct dirent *ent;
+    DIR *dp;
+
+    if ((dp = opendir(dir)) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Images in %s: %s", dir, strerror(errno));
+        return;
+    }
+
+    while ((ent = readdir(dp)) != NULL && nassets < ASET_MAX) {
+        size_t len = strlen(ent->d_name);
+        if (len > 4 && len < sizeof(assets[0].name) && !strcasecmp(ent->d_name + len - 4, ".png")
+                && strncmp(ent->d_name, "splash-", 7))
+            snprintf(assets[nassets++].name, sizeof(assets[0].name), "%s", ent->d_name);
+    }
+
+    closedir(dp);
+}
+
+// Map the pack and take the images that are still as their PNG
+static void asetMap(const char *dir)
+{
+    char path[PATH_MAX+40];
+    const asetPackHead *head;
+    const asetPackIndex *idx;
+    struct stat sb;
+    int fd, n = 0;
+
+    snprintf(path, sizeof(path), "%s%s", dir, ASET_PACK);
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+        return;
+
+    if (fstat(fd, &sb) || sb.st_size < (off_t)sizeof(asetPackHead) ||
+            (asetPack = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        asetPack = NULL;
+        close(fd);
+        return;
+    }
+
+    close(fd);
+    asetPackSize = sb.st_size;
+    head = asetPack;
+    idx = (const asetPackIndex*)(head + 1);
+
+    if (head->magic != ASET_MAGIC || head->version != ASET_VER ||
+            sizeof(asetPackHead) + head->count * sizeof(asetPackIndex) > asetPackSize) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Image pack %s is not usable", path);
+        munmap(asetPack, asetPackSize);
+        asetPack = NULL;
+        return;
+    }
+
+    (void)madvise(asetPack, asetPackSize, MADV_WILLNEED);
+
+    for (int i = 0; i < nassets; i++) {
+        asetEntry *as = &assets[i];
+
+        snprintf(path, sizeof(path), "%s%s", dir, as->name);
+        if (stat(path, &sb))
+            continue;
+
+        for (uint32_t j = 0; j < head->count; j++) {
+            if (strncmp(idx[j].name, as->name, sizeof(idx[j].name)))
+                continue;
+            if (idx[j].mtime == sb.st_mtime && idx[j].size == sb.st_size &&
+                    idx[j].offset + (uint64_t)idx[j].h * idx[j].pitch <= asetPackSize) {
+                as->pixels = (const char*)asetPack + idx[j].offset;
+                as->w = idx[j].w;
+                as->h = idx[j].h;
+                as->pitch = idx[j].pitch;
+                n++;
+            }
+            break;
+        }
+    }
+
+    SDL_Log("%d of %d images from %s%s", n, nassets, dir, ASET_PACK);
+}
+
+// Make the pack of all images in dir, at install
+int asetMakePack(const char *dir)
+{
+    char path[PATH_MAX+40], tmp[PATH_MAX+44];
+    asetPackHead head;
+    asetPackIndex *idx;
+    uint64_t offset;
+    struct stat sb;
+    FILE *fp;
+    int rval = 0;
+
+    nassets = 0;
+    asetScan(dir);
+
+    if ((idx = calloc(nassets, sizeof(asetPackIndex))) == NULL)
+        return -1;
+
+    snprintf(tmp, sizeof(tmp), "%s%s.tmp", dir, ASET_PACK);
+
+    if ((fp = fopen(tmp, "w")) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Image pack %s: %s", tmp, strerror(errno));
+        free(idx);
+        return -1;
+    }
+
+    memset(&head, 0, sizeof(head));
+    head.magic = ASET_MAGIC;
+    head.version = ASET_VER;
+    head.count = nassets;
+
+    offset = sizeof(head) + nassets * sizeof(asetPackIndex);
+
+    for (int i = 0; i < nassets && rval == 0; i++) {
+        SDL_Surface *img, *surf = NULL;
+
+        snprintf(path, sizeof(path), "%s%s", dir, assets[i].name);
+
+        if (stat(path, &sb) == 0 && (img = IMG_Load(path)) != NULL) {
+            surf = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_ARGB8888, 0);
+            SDL_FreeSurface(img);
+        }
+
+        if (surf == NULL) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Image %s: %s", path, SDL_GetError());
+            rval = -1;
+            break;
+        }
+
+        offset = (offset + ASET_ALIGN-1) & ~(uint64_t)(ASET_ALIGN-1);
+
+        snprintf(idx[i].name, sizeof(idx[i].name), "%s", assets[i].name);
+        idx[i].mtime = sb.st_mtime;
+        idx[i].size = sb.st_size;
+        idx[i].w = surf->w;
+        idx[i].h = surf->h;
+        idx[i].pitch = surf->pitch;
+        idx[i].offset = offset;
+
+        if (fseeko(fp, offset, SEEK_SET) || fwrite(surf->pixels, surf->pitch, surf->h, fp) != (size_t)surf->h)
+            rval = -1;
+
+        offset += (uint64_t)surf->pitch * surf->h;
+        SDL_FreeSurface(surf);
+    }
+
+    if (rval == 0 && (fseeko(fp, 0, SEEK_SET) || fwrite(&head, sizeof(head), 1, fp) != 1 ||
+            fwrite(idx, sizeof(asetPackIndex), nassets, fp) != (size_t)nassets))
+        rval = -1;
+
+    if (fclose(fp))
+        rval = -1;
+
+    snprintf(path, sizeof(path), "%s%s", dir, ASET_PACK);
+
+    if (rval == 0 && rename(tmp, path) == 0) {
+        SDL_Log("%d images packed into %s, %llu bytes", nassets, path, (unsigned long long)offset);
+    } else {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Image pack %s not made: %s", path, strerror(errno));
+        unlink(tmp);
+        rval = -1;
+    }
+
+    free(idx);
+    nassets = 0;
+
+    return rval;
+}
+
+// Start decoding all images in dir for the renderer
+int asetInit(SDL_Renderer *renderer, const char *dir)
+{
+    int i, n;
+
+    if (asetLock == NULL && ((asetLock = SDL_CreateMutex()) == NULL || (asetDone = SDL_CreateCond()) == NULL)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "asetInit: %s", SDL_GetError());
+        return -1;
+    }
+
+    if (IMG_Init(IMG_INIT_PNG) != IMG_INIT_PNG)
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "IMG_Init: %s", SDL_GetError());
+
+    asetRenderer = renderer;
+
+    if (nassets == 0) {
+        snprintf(asetDir, sizeof(asetDir), "%s", dir);
+        asetScan(dir);
+        asetMap(dir);
+    }
+
+    // All over again with a new renderer, what is in the pack is as good as decoded
+    for (i = n = 0; i < nassets; i++) {
+        assets[i].state = assets[i].pixels != NULL? ASET_DECODED : ASET_QUEUED;
+        n += assets[i].state == ASET_QUEUED;
+    }
+
+    asetStop = 0;
+
+    for (i = 0; i < ASET_LOADERS; i++) {
+        if ((loaders[i] = SDL_CreateThread(asetLoader, "asetLoader", NULL)) == NULL)
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "asetInit: %s", SDL_GetError());
+    }
+
+    SDL_Log("Decoding %d images with %d loaders", n, ASET_LOADERS);
+
+    return 0;
+}
+
+// Before the renderer goes away
+void asetClose(void)
+{
+    if (asetLock == NULL)
+        return;
+
+    SDL_LockMutex(asetLock);
+    asetStop = 1;
+    SDL_UnlockMutex(asetLock);
+
+    for (int i = 0; i < ASET_LOADERS; i++) {
+        if (loaders[i] != NULL)
+            SDL_WaitThread(loaders[i], NULL);
+        loaders[i] = NULL;
+    }
+
+    for (int i = 0; i < nassets; i++) {
+        if (assets[i].tex != NULL)
+            SDL_DestroyTexture(assets[i].tex);
+        if (assets[i].surf != NULL)
+            SDL_FreeSurface(assets[i].surf);
+        assets[i].tex = NULL;
+        assets[i].surf = NULL;
+    }
+
+    for (int i = 0; i < nfonts; i++)
+        TTF_CloseFont(fonts[i].font);
+    nfonts = 0;
+
+    asetRenderer = NULL;
+    IMG_Quit();
+}
+
+// The images of the page to come go first, names ends with NULL
+void asetWant(const char * const *names)
+{
+    if (asetLock == NULL || names == NULL)
+        return;
+
+    SDL_LockMutex(asetLock);
+
+    asetSeq++;
+    for (; *names != NULL; names++) {
+        for (int i = 0; i < nassets; i++) {
+            if (!strcmp(assets[i].name, *names))
+                assets[i].prio = asetSeq;
+        }
+    }
+
+    SDL_UnlockMutex(asetLock);
+}
+
+// The texture of an image, owned by the cache. NULL if it cannot be had.
+SDL_Texture *asetGet(const char *name)
+{
+    SDL_Texture *tex = NULL;
+    asetEntry *as = NULL;
+
+    if (asetRenderer == NULL)
+        return NULL;
+
+    SDL_LockMutex(asetLock);
+
+    for (int i = 0; i < nassets && as == NULL; i++) {
+        if (!strcmp(assets[i].name, name))
+            as = &assets[i];
+    }
+
+    if (as == NULL && nassets < ASET_MAX) {
+        as = &assets[nassets++];
+        snprintf(as->name, sizeof(as->name), "%s", name);
+    }
+
+    if (as != NULL) {
+        if (as->state == ASET_QUEUED)
+            asetDecode(as);
+
+        while (as->state == ASET_DECODING)
+            SDL_CondWait(asetDone, asetLock);
+
+        if (as->state == ASET_DECODED)
+            asetUploadOne(as);
+
+        tex = as->tex;
+    }
+
+    SDL_UnlockMutex(asetLock);
+
+    return tex;
+}
+
+// Upload a few decoded images, once a frame
+void asetUpload(void)
+{
+    asetEntry *as;
+
+    if (asetRenderer == NULL)
+        return;
+
+    TRCE_SCOPE("asetUpload");
+
+    SDL_LockMutex(asetLock);
+
+    for (int n = 0; n < ASET_UPLOADS; n++) {
+        as = NULL;
+        for (int i = 0; i < nassets; i++) {
+            if (assets[i].state == ASET_DECODED && (as == NULL || assets[i].prio > as->prio))
+                as = &assets[i];
+        }
+        if (as == NULL)
+            break;
+        asetUploadOne(as);
+    }
+
+    SDL_UnlockMutex(asetLock);
+}
+
+// A font of a size, owned by the cache
+TTF_Font *asetFont(const char *path, int size)
+{
+    TTF_Font *font;
+
+    for (int i = 0; i < nfonts; i++) {
+        if (fonts[i].size == size && !strcmp(fonts[i].path, path))
+            return fonts[i].font;
+    }
+
+    if ((font = TTF_OpenFont(path, size)) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Font %s: %s", path, SDL_GetError());
+        return NULL;
+    }
+
+    if (nfonts < ASET_FONTS) {
+        snprintf(fonts[nfonts].path, sizeof(fonts[0].path), "%s", path);
+        fonts[nfonts].size = size;
+        fonts[nfonts++].font = font;
+    }
+
+    return font;
+}
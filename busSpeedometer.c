@@ -0,0 +1,236 @@
+/*
+ * busSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The data bus. Collectors publish every channel update, with its time and
+ * source, into one broadcast ring and consumers subscribe to the channels
+ * they care about. The ring is lock-free: a publisher claims a sequence
+ * number and stamps its slot when the message is complete, and each
+ * subscriber reads at its own pace from its own cursor, so a slow consumer
+ * costs the others nothing and only loses its own oldest messages.
+ * A subscriber is woken either by an eventfd, for threads that wait with
+ * thrdWait(), or by an SDL user event for the render loop. The wake up is
+ * sent once until the subscriber has drained the ring again.
+ */
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define BUS_RING    1024    // Messages, a power of two
+#define BUS_MAXSUB  8
+
+typedef struct {
+    uint64_t    stamp;      // Sequence number + 1 when complete, 0 while written
+    busMsg      msg;
+} busSlot;
+
+struct busSub {
+    int         used;
+    uint32_t    mask;       // Channels of interest
+    uint64_t    next;       // Next sequence number to read
+    int         pending;    // A wake up is on its way
+    int         fd;         // eventfd, or -1
+    int         efd;        // The eventfd of the slot, open for its life once made
+    int         opened;
+    Uint32      event;      // SDL event type, or 0
+    unsigned    lost;
+};
+
+static busSlot ring[BUS_RING];
+static uint64_t busHead;
+static busSub subs[BUS_MAXSUB];
+
+static void busWake(busSub *sub)
+{
+    if (sub->fd >= 0) {
+        (void)eventfd_write(sub->fd, 1);
+    } else {
+        SDL_Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = sub->event;
+        SDL_PushEvent(&event);
+    }
+}
+
+void busPublish(int chan, int src, time_t ts, double val, double val2)
+{
+    uint64_t s = __atomic_fetch_add(&busHead, 1, __ATOMIC_ACQ_REL);
+    busSlot *slot = &ring[s % BUS_RING];
+    uint32_t bit = BUS_MASK(chan);
+
+    // Readers that see 0 or a changed stamp know the slot is being reused
+    __atomic_store_n(&slot->stamp, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->msg.ts = ts;
+    slot->msg.chan = chan;
+    slot->msg.src = src;
+    slot->msg.val = val;
+    slot->msg.val2 = val2;
+
+    __atomic_store_n(&slot->stamp, s + 1, __ATOMIC_RELEASE);
+
+    if (s == 0)
+        bootMark("First data");
+
+    for (int i = 0; i < BUS_MAXSUB; i++) {
+        busSub *sub = &subs[i];
+        if (__atomic_load_n(&sub->used, __ATOMIC_ACQUIRE) && (__atomic_load_n(&sub->mask, __ATOMIC_RELAXED) & bit) &&
+                !__atomic_exchange_n(&sub->pending, 1, __ATOMIC_ACQ_REL))
+            busWake(sub);
+    }
+}
+
+// Subscribe to the channels in mask. Wake up by SDL event if event != 0, else by eventfd.
+busSub *busSubscribe(uint32_t mask, Uint32 event)
+{
+    static SDL_SpinLock lock;
+    busSub *sub = NULL;
+
+    SDL_AtomicLock(&lock);
+
+    for (int i = 0; i < BUS_MAXSUB && sub == NULL; i++) {
+        if (!subs[i].used)
+            sub = &subs[i];
+    }
+
+    if (sub == NULL) {
+        SDL_AtomicUnlock(&lock);
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "busSubscribe: Too many subscribers");
+        return NULL;
+    }
+
+    if (event == 0) {
+        eventfd_t cnt;
+        if (!sub->opened) {
+            if ((sub->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+                SDL_AtomicUnlock(&lock);
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "busSubscribe: eventfd: %s", strerror(errno));
+                return NULL;
+            }
+            sub->opened = 1;
+        } else
+            (void)eventfd_read(sub->efd, &cnt);     // Late wake ups for the one before
+    }
+
+    sub->fd = event == 0? sub->efd : -1;
+    sub->event = event;
+
+    sub->mask = mask;
+    sub->pending = 0;
+    sub->lost = 0;
+    sub->next = __atomic_load_n(&busHead, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&sub->used, 1, __ATOMIC_RELEASE);
+
+    SDL_AtomicUnlock(&lock);
+
+    return sub;
+}
+
+void busUnsubscribe(busSub *sub)
+{
+    if (sub == NULL)
+        return;
+
+    // The eventfd is kept, a publisher that saw the slot in use may be about to write it
+    __atomic_store_n(&sub->used, 0, __ATOMIC_RELEASE);
+}
+
+// Change the channels of interest, i.e. when the page changes
+void busWatch(busSub *sub, uint32_t mask)
+{
+    if (sub != NULL)
+        __atomic_store_n(&sub->mask, mask, __ATOMIC_RELAXED);
+}
+
+int busFd(busSub *sub)
+{
+    return sub == NULL? -1 : sub->fd;
+}
+
+// Returns 1 with a message, 0 when drained and -1 if a publisher is halfway
+static int busNext(busSub *sub, busMsg *msg)
+{
+    uint64_t head = __atomic_load_n(&busHead, __ATOMIC_ACQUIRE);
+
+    while (sub->next < head) {
+        busSlot *slot;
+        uint64_t stamp;
+        busMsg copy;
+
+        if (head - sub->next > BUS_RING) {
+            sub->lost += head - sub->next - BUS_RING;
+            sub->next = head - BUS_RING;
+        }
+
+        slot = &ring[sub->next % BUS_RING];
+        stamp = __atomic_load_n(&slot->stamp, __ATOMIC_ACQUIRE);
+
+        if (stamp != 0 && stamp < sub->next + 1)
+            return -1;      // Claimed but not yet published
+
+        copy = slot->msg;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (stamp != sub->next + 1 || __atomic_load_n(&slot->stamp, __ATOMIC_RELAXED) != stamp) {
+            if (stamp == 0)
+                return -1;  // Being written, by this or a later publisher
+            sub->lost++;    // Overwritten
+            sub->next++;
+            continue;
+        }
+
+        sub->next++;
+
+        if (__atomic_load_n(&sub->mask, __ATOMIC_RELAXED) & BUS_MASK(copy.chan)) {
+            *msg = copy;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Next message for the subscriber. Returns 0 when drained.
+int busPoll(busSub *sub, busMsg *msg)
+{
+    int rval, spin = 0;
+
+    if (sub == NULL)
+        return 0;
+
+    for (;;) {
+        // A publisher is only a few stores from done
+        while ((rval = busNext(sub, msg)) < 0 && spin++ < 1000)
+            sched_yield();
+
+        if (rval > 0)
+            return 1;
+
+        if (sub->lost) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Data bus overrun, %u messages lost", sub->lost);
+            sub->lost = 0;
+        }
+
+        // Look once more if something was published while the wake up was armed
+        if (!__atomic_exchange_n(&sub->pending, 0, __ATOMIC_ACQ_REL))
+            return 0;
+
+        if (sub->fd >= 0) {
+            eventfd_t dummy;
+            (void)eventfd_read(sub->fd, &dummy);
+        }
+    }
+}
@@ -0,0 +1,136 @@
+/*
+ * confSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The configuration watcher. The directory of the configuration database
+ * is watched with inotify, and when a writer such as sdlSpeedometer-config
+ * has closed the database and it has been quiet for a moment, the changes
+ * are taken into use by reconfigureDb(). The sqlite3 command line tool
+ * opens the database for writing also for a SELECT, so the data version
+ * of our own connection tells if another connection has committed anything
+ * at all. Our own writes on that connection do not close the file and are
+ * not seen here.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define CONF_SETTLE 500     // ms of quiet after the last close before reading
+
+static int confFd = -1;
+static char confName[NAME_MAX+1];
+
+// Watch the directory, the database may also be replaced by a rename
+int confInit(const char *path)
+{
+    char dir[PATH_MAX];
+    const char *name = strrchr(path, '/');
+
+    if (name == NULL) {
+        strcpy(dir, ".");
+        name = path;
+    } else {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(name - path) + 1, path);
+        name++;
+    }
+
+    snprintf(confName, sizeof(confName), "%s", name);
+
+    if ((confFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0 || inotify_add_watch(confFd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Cannot watch %s for configuration changes: %s", dir, strerror(errno));
+        if (confFd >= 0)
+            close(confFd);
+        confFd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Returns the events on the database, if any
+static int confRead(void)
+{
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev;
+    ssize_t len;
+    int mask = 0;
+
+    while ((len = read(confFd, buf, sizeof(buf))) > 0) {
+        for (char *ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + ev->len) {
+            ev = (const struct inotify_event*)ptr;
+            if (ev->len && !strcmp(ev->name, confName))
+                mask |= ev->mask;
+        }
+    }
+
+    return mask;
+}
+
+// Committed to by another connection since last asked
+static int confChanged(sqlite3 *conn, int *version)
+{
+    sqlite3_stmt *res;
+    int v = *version;
+
+    if (conn == NULL || sqlite3_prepare_v2(conn, "PRAGMA data_version", -1, &res, NULL) != SQLITE_OK)
+        return 1;
+
+    if (sqlite3_step(res) == SQLITE_ROW)
+        v = sqlite3_column_int(res, 0);
+    sqlite3_finalize(res);
+
+    if (v == *version)
+        return 0;
+
+    *version = v;
+
+    return 1;
+}
+
+int threadConfig(void *conf)
+{
+    configuration *configParams = conf;
+    int rval, mask = 0, version = 0;
+
+    (void)confChanged(configParams->conn, &version);
+
+    SDL_Log("Watching %s for configuration changes", confName);
+
+    while (configParams->runCfg)
+    {
+        if ((rval = thrdWait(confFd, POLLIN, mask? CONF_SETTLE : 10000)) < 0)
+            break;
+
+        if (rval > 0) {
+            mask |= confRead();
+            continue;
+        }
+
+        // A new file has a data version of its own
+        if (mask && (confChanged(configParams->conn, &version) || (mask & IN_MOVED_TO))) {
+            SDL_Log("Configuration database changed");
+            (void)reconfigureDb(configParams);
+        }
+
+        mask = 0;
+    }
+
+    close(confFd);
+    confFd = -1;
+
+    return 0;
+}
@@ -0,0 +1,407 @@
+/*
+ * govSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The power governor. When the vessel is calm, i.e. at anchor or in port,
+ * and nobody has touched the screen for a while the display drops to one
+ * frame a second, the i2c sampling slows down and after another while the
+ * screen is blanked with DPMS where available. Alarm evaluation keeps its
+ * full rate. A touch or an alarm brings everything back at once since the
+ * page loops wait for events rather than sleep.
+ * The CPU time and wakeups of each idle period is logged against the
+ * preceding active period.
+ * When active the cost of each frame is measured and the frame period is
+ * stretched so that the 95th percentile cost stays within a CPU budget,
+ * which shrinks as the SoC gets hot. The resulting pace is smoothed and
+ * handed to the pages, which move their needles in bigger steps and
+ * capture fewer frames for VNC, so a hot or busy unit degrades gracefully
+ * rather than stutters.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <SDL2/SDL.h>
+#ifdef HAS_DPMS
+#include <X11/Xlib.h>
+#include <X11/extensions/dpms.h>
+#endif
+#include "sdlSpeedometer.h"
+
+#define GOV_IDLE_MS     1000    // Frame delay when idle
+#define GOV_BLANK_MS    5000    // Frame delay when blanked
+#define GOV_I2C_SLOW    4       // i2c delay factor when idle
+#define GOV_FRAMES      64      // Frame costs kept for the percentiles
+#define GOV_TEMP_WARN   70000   // m°C where the budget starts to shrink
+#define GOV_TEMP_MAX    80000   // m°C where the budget is at its lowest
+#define GOV_PACE_MAX    7.0     // Slowest pace relative to the pages' own rate
+#define GOV_DATA_MS     100     // Shortest frame woken up by new data, before pacing
+#define GOV_THERMAL     "/sys/class/thermal/thermal_zone0/temp"
+
+typedef struct {
+    time_t  start;
+    double  cpu;                // Seconds of CPU time at start
+    int     frames;
+    int     polls;              // i2c wakeups
+} govPeriod;
+
+static int govState = GOV_ACTIVE;
+static int govIdleTime;         // Seconds, 0 = never idle
+static time_t govTouched;
+static Uint32 govEvent;         // Wakes up the page loop
+static Uint32 govBusEvent;      // New data on the bus, 0 = none
+static govPeriod active, idle;
+static double activeCpu;        // CPU load of the last active period
+static double activeRate;       // Wakeups per second of the last active period
+static int govBudget;           // Percent of a core for rendering
+static float govCost[GOV_FRAMES];   // ms
+static int govNcost;
+static float govP50, govP95;
+static float govPaceNow = 1;    // Smoothed frame period stretch
+static volatile int govTemp;    // m°C, 0 = unknown
+static Uint64 govFrameStart;
+static trceSpan govFrame;        // Traced from frame start to the delay
+#ifdef HAS_DPMS
+static Display *dpy;
+#endif
+
+static double govCpu(void)
+{
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru))
+        return 0;
+
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec/1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec/1e6;
+}
+
+static void govBlank(int off)
+{
+#ifdef HAS_DPMS
+    int dummy;
+
+    if (dpy == NULL && (dpy = XOpenDisplay(NULL)) == NULL)
+        return;
+
+    if (!DPMSQueryExtension(dpy, &dummy, &dummy) || !DPMSCapable(dpy))
+        return;
+
+    DPMSEnable(dpy);
+    DPMSForceLevel(dpy, off? DPMSModeOff : DPMSModeOn);
+    XFlush(dpy);
+#else
+    (void)off;
+#endif
+}
+
+static void govPeriodStart(govPeriod *p, time_t ct)
+{
+    p->start = ct;
+    p->cpu = govCpu();
+    p->frames = p->polls = 0;
+}
+
+static void govSet(int state, time_t ct)
+{
+    int was = govState == GOV_CALM? GOV_ACTIVE : govState;
+
+    if (state == was) {
+        govState = state;
+        return;
+    }
+
+    if (was == GOV_ACTIVE) {
+        double secs = ct - active.start;
+        if (secs > 0) {
+            activeCpu = 100*(govCpu() - active.cpu)/secs;
+            activeRate = (active.frames + active.polls)/secs;
+        }
+        govPeriodStart(&idle, ct);
+        SDL_Log("Entering idle mode");
+    }
+
+    if (state == GOV_BLANK)
+        govBlank(1);
+    else if (was == GOV_BLANK)
+        govBlank(0);
+
+    if (state == GOV_ACTIVE) {
+        double secs = ct - idle.start;
+        if (secs > 0) {
+            SDL_Log("Idle for %.0f min: CPU %.1f%% (active %.1f%%), %.2f fps, %.1f wakeups/s (active %.1f)",
+                secs/60, 100*(govCpu() - idle.cpu)/secs, activeCpu, idle.frames/secs,
+                    (idle.frames + idle.polls)/secs, activeRate);
+        }
+        govPeriodStart(&active, ct);
+    }
+
+    govState = state;
+}
+
+void govInit(int idleTime, int budget)
+{
+    govIdleTime = idleTime;
+    govBudget = budget > 0 && budget <= 100? budget : 100;
+    govTouched = time(NULL);
+    govEvent = SDL_RegisterEvents(1);
+    govPeriodStart(&active, govTouched);
+}
+
+// The SDL event of the render loop's bus subscription
+void govBus(Uint32 event)
+{
+    govBusEvent = event;
+}
+
+// Anything else than a bus wake up in the queue
+static int govInput(void)
+{
+    if (govBusEvent == 0)
+        return SDL_HasEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+    return SDL_HasEvents(SDL_FIRSTEVENT, govBusEvent-1) || SDL_HasEvents(govBusEvent+1, SDL_LASTEVENT);
+}
+
+// Wait out the paced delay. Input ends it at once and new data, coalesced
+// into one wake up per frame, once the shortest paced data frame is over.
+static void govActiveDelay(int ms)
+{
+    Uint32 start = SDL_GetTicks();
+    int early = GOV_DATA_MS*govPaceNow;
+    int left;
+
+    if (early > ms)
+        early = ms;
+
+    while ((left = ms - (int)(SDL_GetTicks() - start)) > 0 && SDL_WaitEventTimeout(NULL, left)) {
+        if (govInput() || (int)(SDL_GetTicks() - start) >= early)
+            return;
+        // Too soon, the data is still there when the page drains the bus
+        SDL_FlushEvent(govBusEvent);
+        ms = early;
+    }
+}
+
+int govIdle(void)
+{
+    return govState;
+}
+
+// Screen touched, from the render thread
+void govTouch(void)
+{
+    govTouched = time(NULL);
+
+    if (govState != GOV_ACTIVE)
+        govSet(GOV_ACTIVE, govTouched);
+}
+
+// Wake up from any thread, i.e on an alarm
+void govWake(void)
+{
+    SDL_Event event;
+
+    govTouched = time(NULL);
+
+    if (govState == GOV_ACTIVE || govEvent == (Uint32)-1)
+        return;
+
+    memset(&event, 0, sizeof(event));
+    event.type = govEvent;
+    SDL_PushEvent(&event);
+}
+
+static void govThermal(time_t ct)
+{
+    static time_t read;
+    FILE *fd;
+    int temp;
+
+    if (ct - read < 5)
+        return;
+    read = ct;
+
+    if ((fd = fopen(GOV_THERMAL, "r")) == NULL)
+        return;
+
+    if (fscanf(fd, "%d", &temp) == 1)
+        govTemp = temp;
+
+    fclose(fd);
+}
+
+// Once a second with the verdict of the caller on vessel motion and alarms
+void govUpdate(time_t ct, int calm)
+{
+    govThermal(ct);
+
+    if (govIdleTime <= 0)
+        return;
+
+    if (!calm)
+        govTouched = ct;
+
+    if (govState == GOV_ACTIVE && ct - govTouched >= govIdleTime)
+        govState = GOV_CALM;        // The render thread takes it from here
+}
+
+static int govCmp(const void *a, const void *b)
+{
+    float x = *(const float*)a, y = *(const float*)b;
+
+    return (x > y) - (x < y);
+}
+
+// Stretch the delay so the p95 frame cost stays within the budget
+static int govThrottle(int ms)
+{
+    static time_t logged;
+    static float loggedPace = 1;
+    float budget = govBudget/100.0;
+    float cost, period;
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    if (govFrameStart == 0)
+        return ms;
+
+    cost = (now - govFrameStart)*1000.0/SDL_GetPerformanceFrequency();
+    govCost[govNcost++ % GOV_FRAMES] = cost;
+
+    if (govNcost % (GOV_FRAMES/4) == 0 && govNcost >= GOV_FRAMES) {
+        float sorted[GOV_FRAMES];
+        memcpy(sorted, govCost, sizeof(sorted));
+        qsort(sorted, GOV_FRAMES, sizeof(float), govCmp);
+        govP50 = sorted[GOV_FRAMES/2];
+        govP95 = sorted[GOV_FRAMES*95/100];
+    }
+
+    // A hot SoC gets down to a quarter of the budget
+    if (govTemp > GOV_TEMP_WARN) {
+        float hot = (float)(govTemp - GOV_TEMP_WARN)/(GOV_TEMP_MAX - GOV_TEMP_WARN);
+        budget *= 1 - 0.75*(hot > 1? 1 : hot);
+    }
+
+    period = govP95/budget;
+    if (period > cost + ms*GOV_PACE_MAX)
+        period = cost + ms*GOV_PACE_MAX;
+
+    // Smooth, or the pace would follow every spike
+    govPaceNow += 0.1*((period > cost + ms? period/(cost + ms) : 1) - govPaceNow);
+
+    if (fabsf(govPaceNow - loggedPace) > 0.5 && time(NULL) - logged > 60) {
+        SDL_Log("Frame governor: p50 %.1f ms p95 %.1f ms, %.1f C, pace %.1f", govP50, govP95, govTemp/1000.0, govPaceNow);
+        loggedPace = govPaceNow;
+        logged = time(NULL);
+    }
+
+    return (cost + ms)*govPaceNow - cost;
+}
+
+// Step factor for needle motion at the current pace
+float govPace(void)
+{
+    return govPaceNow;
+}
+
+// True on the frames that should be captured for VNC
+int govCapture(void)
+{
+    static float credit;
+
+    if ((credit += 1/govPaceNow) < 1)
+        return 0;
+
+    credit -= 1;
+
+    return 1;
+}
+
+// Delay between frames of a page. Returns early on input.
+void govFrameDelay(int ms)
+{
+    SDL_Event event;
+    trceSpan delay;
+
+    wdogFrame();
+
+    if (govFrameStart == 0)
+        bootMark("First frame");
+    else
+        metrFrame((SDL_GetPerformanceCounter() - govFrameStart)*1000.0/SDL_GetPerformanceFrequency());
+
+    trceEnd(&govFrame);
+    delay = trceBegin("frameDelay");
+
+    if (govState == GOV_CALM)
+        govSet(GOV_IDLE, time(NULL));
+
+    if (govState != GOV_ACTIVE && time(NULL) - govTouched < govIdleTime)
+        govSet(GOV_ACTIVE, time(NULL));
+
+    if (govState == GOV_IDLE && time(NULL) - govTouched >= 2*govIdleTime)
+        govSet(GOV_BLANK, time(NULL));
+
+    if (govState == GOV_ACTIVE) {
+        active.frames++;
+        ms = govThrottle(ms);
+    } else {
+        idle.frames++;
+        ms = govState == GOV_BLANK? GOV_BLANK_MS : GOV_IDLE_MS;
+    }
+
+    if (ms < 1)
+        ms = 1;
+
+    if (govState == GOV_ACTIVE) {
+        govActiveDelay(ms);
+        govFrameStart = SDL_GetPerformanceCounter();
+        trceEnd(&delay);
+        govFrame = trceBegin("frame");
+        return;
+    }
+
+    if (!SDL_WaitEventTimeout(NULL, ms)) {
+        govFrameStart = SDL_GetPerformanceCounter();
+        trceEnd(&delay);
+        govFrame = trceBegin("frame");
+        return;
+    }
+
+    // A touch on a blank screen only lights it up
+    if (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, SDL_MOUSEBUTTONDOWN, SDL_MOUSEBUTTONDOWN) > 0 ||
+            SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, SDL_FINGERDOWN, SDL_FINGERDOWN) > 0 ||
+                SDL_PeepEvents(&event, 1, SDL_GETEVENT, govEvent, govEvent) > 0) {
+        if (govState == GOV_BLANK) {
+            SDL_FlushEvents(SDL_MOUSEMOTION, SDL_MOUSEWHEEL);
+            SDL_FlushEvents(SDL_FINGERDOWN, SDL_FINGERMOTION);
+        }
+        govTouch();
+    }
+
+    govFrameStart = SDL_GetPerformanceCounter();
+    trceEnd(&delay);
+    govFrame = trceBegin("frame");
+}
+
+// Delay between i2c samples
+int govI2cDelay(int dt)
+{
+    if (govState <= GOV_CALM) {
+        active.polls++;
+        return dt;
+    }
+
+    idle.polls++;
+
+    return dt*GOV_I2C_SLOW;
+}
@@ -0,0 +1,337 @@
+/*
+ * histSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * A fixed size time-series store for all instrument channels sampled at 1 Hz.
+ * The store is a memory mapped file holding one column per channel where each
+ * second owns the slot (ts % HIST_SLOTS). Appends are plain memory writes and
+ * the kernel takes care of the write back, so the history survives a crash
+ * or a restart of the service.
+ * For long time spans a pyramid of min/max/sum aggregates at 10 s, 1 min, 10 min
+ * and 1 h resolution is maintained on each append. A query over any span then
+ * reads a bounded number of buckets per output point, so plotting 24 hours
+ * costs about the same as plotting 25 seconds.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>   // For the purpose of logging
+#include "sdlSpeedometer.h"
+
+#define HIST_MAGIC      "SDLHIST"
+#define HIST_VERSION    2
+#define HIST_SYNC       600     // Seconds between forced write backs
+#define HIST_LODS       4       // Aggregate levels above the 1 s raw data
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t nchan;
+    uint32_t slots;
+    uint32_t pad;
+    int64_t  first;             // Oldest sample written
+    int64_t  last;              // Newest sample written
+} histHeader;
+
+typedef struct {
+    float    min;
+    float    max;
+    float    sum;
+    uint32_t count;
+} histAgg;
+
+static const int lodWidth[HIST_LODS] = {10, 60, 600, 3600};   // Seconds per bucket
+
+static histHeader *hdr;
+static uint32_t *tsCol;         // Second that owns each slot
+static float *dataCol;          // HIST_NCHAN columns of HIST_SLOTS floats
+static uint32_t *lodKey[HIST_LODS]; // Bucket number that owns each bucket slot
+static histAgg *lodAgg[HIST_LODS];  // HIST_NCHAN aggregates per bucket slot
+static size_t mapSize;
+
+#define COLUMN(c)   (&dataCol[(size_t)(c)*HIST_SLOTS])
+#define LODSLOTS(l) (HIST_SLOTS/lodWidth[l])
+
+int histOpen(const char *path)
+{
+    struct stat sb;
+    int fd;
+    int fresh = 0;
+
+    mapSize = sizeof(histHeader) + sizeof(uint32_t)*HIST_SLOTS + sizeof(float)*HIST_SLOTS*HIST_NCHAN;
+    for (int l = 0; l < HIST_LODS; l++)
+        mapSize += (sizeof(uint32_t) + sizeof(histAgg)*HIST_NCHAN)*LODSLOTS(l);
+
+    if ((fd = open(path, O_RDWR | O_CREAT, (mode_t)0664)) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open history store %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if (fstat(fd, &sb) < 0 || sb.st_size != mapSize)
+        fresh = 1;
+
+    if (fresh) {
+        // A new or an incompatible store. The file is sparse until written.
+        if (ftruncate(fd, 0) < 0 || ftruncate(fd, mapSize) < 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to size history store %s: %s", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+
+    hdr = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (hdr == MAP_FAILED) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to map history store %s: %s", path, strerror(errno));
+        hdr = NULL;
+        return -1;
+    }
+
+    if (!fresh && (strcmp(hdr->magic, HIST_MAGIC) || hdr->version != HIST_VERSION ||
+            hdr->nchan != HIST_NCHAN || hdr->slots != HIST_SLOTS)) {
+        SDL_Log("History store %s has an old layout and will be reset", path);
+        memset(hdr, 0, sizeof(histHeader));
+        fresh = 1;
+    }
+
+    tsCol = (uint32_t*)(hdr + 1);
+    dataCol = (float*)(tsCol + HIST_SLOTS);
+
+    for (int l = 0; l < HIST_LODS; l++) {
+        lodKey[l] = l? (uint32_t*)(lodAgg[l-1] + (size_t)LODSLOTS(l-1)*HIST_NCHAN) : (uint32_t*)(dataCol + (size_t)HIST_SLOTS*HIST_NCHAN);
+        lodAgg[l] = (histAgg*)(lodKey[l] + LODSLOTS(l));
+        if (fresh)
+            memset(lodKey[l], 0, sizeof(uint32_t)*LODSLOTS(l));
+    }
+
+    if (fresh) {
+        memset(tsCol, 0, sizeof(uint32_t)*HIST_SLOTS);
+        hdr->version = HIST_VERSION;
+        hdr->nchan = HIST_NCHAN;
+        hdr->slots = HIST_SLOTS;
+        hdr->first = hdr->last = 0;
+        strcpy(hdr->magic, HIST_MAGIC);
+        SDL_Log("Created a new history store %s for %d days", path, HIST_SLOTS/(24*3600));
+    }
+
+    return 0;
+}
+
+void histClose(void)
+{
+    if (hdr == NULL)
+        return;
+
+    (void)msync(hdr, mapSize, MS_SYNC);
+    munmap(hdr, mapSize);
+    hdr = NULL;
+}
+
+// Add one row of HIST_NCHAN values (NAN = no data) for second ts.
+void histAppend(time_t ts, const float *row)
+{
+    static time_t synced;
+    uint32_t slot;
+
+    if (hdr == NULL)
+        return;
+
+    slot = ts % HIST_SLOTS;
+
+    for (int c = 0; c < HIST_NCHAN; c++)
+        COLUMN(c)[slot] = row[c];
+
+    // Publish the slot after its data
+    __sync_synchronize();
+    tsCol[slot] = (uint32_t)ts;
+
+    // Fold the row into the bucket of each aggregate level
+    for (int l = 0; l < HIST_LODS; l++) {
+        uint32_t bucket = ts / lodWidth[l];
+        uint32_t bslot = bucket % LODSLOTS(l);
+        histAgg *agg = &lodAgg[l][(size_t)bslot*HIST_NCHAN];
+
+        if (lodKey[l][bslot] != bucket) {
+            memset(agg, 0, sizeof(histAgg)*HIST_NCHAN);
+            __sync_synchronize();
+            lodKey[l][bslot] = bucket;
+        }
+
+        for (int c = 0; c < HIST_NCHAN; c++, agg++) {
+            if (isnan(row[c]))
+                continue;
+            if (!agg->count++) {
+                agg->min = agg->max = row[c];
+            } else {
+                if (row[c] < agg->min) agg->min = row[c];
+                if (row[c] > agg->max) agg->max = row[c];
+            }
+            agg->sum += row[c];
+        }
+    }
+
+    if (hdr->first == 0 || ts < hdr->first)
+        hdr->first = ts;
+    else if (ts - hdr->first >= HIST_SLOTS)
+        hdr->first = ts - HIST_SLOTS + 1;
+    hdr->last = ts;
+
+    // Bound the amount of data lost on a power failure
+    if (ts - synced > HIST_SYNC) {
+        (void)msync(hdr, mapSize, MS_ASYNC);
+        synced = ts;
+    }
+}
+
+time_t histLast(void)
+{
+    return hdr == NULL? 0 : hdr->last;
+}
+
+time_t histFirst(void)
+{
+    return hdr == NULL? 0 : hdr->first;
+}
+
+// Value of a channel at second ts or NAN if there is no such sample.
+float histGet(int chan, time_t ts)
+{
+    uint32_t slot;
+
+    if (hdr == NULL || chan < 0 || chan >= HIST_NCHAN || ts <= 0)
+        return NAN;
+
+    slot = ts % HIST_SLOTS;
+
+    if (tsCol[slot] != (uint32_t)ts)
+        return NAN;
+
+    return COLUMN(chan)[slot];
+}
+
+// Min, max and mean of a channel over [from, to]. Returns number of samples.
+int histStats(int chan, time_t from, time_t to, histStat *st)
+{
+    double sum = 0;
+
+    memset(st, 0, sizeof(histStat));
+    st->min = NAN;
+    st->max = NAN;
+    st->mean = NAN;
+
+    if (hdr == NULL || chan < 0 || chan >= HIST_NCHAN)
+        return 0;
+
+    if (to - from >= HIST_SLOTS)
+        from = to - HIST_SLOTS + 1;
+
+    for (time_t t = from; t <= to; t++) {
+        float v = histGet(chan, t);
+        if (isnan(v))
+            continue;
+        if (!st->count++) {
+            st->min = st->max = v;
+        } else {
+            if (v < st->min) st->min = v;
+            if (v > st->max) st->max = v;
+        }
+        sum += v;
+    }
+
+    if (st->count)
+        st->mean = sum / st->count;
+
+    return st->count;
+}
+
+// Aggregate a channel into n equal buckets spanning [from, to).
+// The level with the widest buckets that still fit in one output bucket is
+// used, so the cost is bounded by n times the ratio between two levels.
+// Empty output buckets are NAN. Returns the number of non empty buckets.
+int histQuery(int chan, time_t from, time_t to, int n, histStat *out)
+{
+    double step;
+    int level = -1;
+    int filled = 0;
+
+    if (n <= 0)
+        return 0;
+
+    for (int i = 0; i < n; i++) {
+        out[i].min = out[i].max = out[i].mean = NAN;
+        out[i].count = 0;
+    }
+
+    if (hdr == NULL || chan < 0 || chan >= HIST_NCHAN || to <= from)
+        return 0;
+
+    step = (double)(to - from) / n;
+
+    for (int l = 0; l < HIST_LODS; l++) {
+        if (lodWidth[l] <= step)
+            level = l;
+    }
+
+    for (int i = 0; i < n; i++) {
+        time_t t0 = from + (time_t)(i*step);
+        time_t t1 = i == n-1? to : from + (time_t)((i+1)*step);
+        histStat *st = &out[i];
+        double sum = 0;
+
+        if (level < 0) {
+            // Raw 1 s data
+            for (time_t t = t0; t < t1; t++) {
+                float v = histGet(chan, t);
+                if (isnan(v))
+                    continue;
+                if (!st->count++) {
+                    st->min = st->max = v;
+                } else {
+                    if (v < st->min) st->min = v;
+                    if (v > st->max) st->max = v;
+                }
+                sum += v;
+            }
+        } else {
+            // Buckets that start within [t0, t1)
+            int w = lodWidth[level];
+            for (time_t b = (t0 + w - 1) / w; b*w < t1; b++) {
+                uint32_t bslot = b % LODSLOTS(level);
+                histAgg *agg = &lodAgg[level][(size_t)bslot*HIST_NCHAN + chan];
+                if (lodKey[level][bslot] != (uint32_t)b || agg->count == 0)
+                    continue;
+                if (!st->count) {
+                    st->min = agg->min;
+                    st->max = agg->max;
+                } else {
+                    if (agg->min < st->min) st->min = agg->min;
+                    if (agg->max > st->max) st->max = agg->max;
+                }
+                st->count += agg->count;
+                sum += agg->sum;
+            }
+        }
+
+        if (st->count) {
+            st->mean = sum / st->count;
+            filled++;
+        }
+    }
+
+    return filled;
+}
@@ -61,7 +61,8 @@ static int readBlock(uint8_t command, uint8_t size, uint8_t *data, int file)
     int result = i2c_smbus_read_i2c_block_data(file, command, size, data);
     if (result != size)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read block from I2C %d - %s", command, strerror(errno));
+        metrAdd(METR_I2C_ERRORS, 1);
+        LOGG_LIMIT(LOGG_PERIOD, SDL_LOG_PRIORITY_ERROR, "Failed to read block from I2C %d - %s", command, strerror(errno));
         return -1;
     }
     return 0;
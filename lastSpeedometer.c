@@ -0,0 +1,211 @@
+/*
+ * lastSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The last known state: the latest value, time and source of every data
+ * bus channel, the needle positions and the current page. It is saved
+ * every few seconds to a small file, written aside and renamed into place
+ * so that a crash or a power cut leaves either the old or the new state,
+ * and mapped at startup so the pages have something to show, marked as
+ * stale, before the collectors have delivered anything.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define LAST_MAGIC  0x5453414c  // "LAST"
+#define LAST_VER    1
+
+typedef struct {
+    double      val;
+    double      val2;
+    time_t      ts;         // 0 = never seen
+    int         src;
+} lastChan;
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    size;
+    time_t      saved;
+    int         page;
+    float       needle[LAST_NNEEDLE];
+    lastChan    chan[BUS_NCHAN];
+    uint32_t    sum;        // Of everything above
+} lastState;
+
+static lastState state;
+static char lastPath[PATH_MAX];
+static SDL_mutex *lastLock;
+
+static uint32_t lastSum(const lastState *st)
+{
+    const uint8_t *p = (const uint8_t*)st;
+    uint32_t sum = 0;
+
+    for (size_t i = 0; i < offsetof(lastState, sum); i++)
+        sum = sum*31 + p[i];
+
+    return sum;
+}
+
+// Map the saved state. Returns 0 if there was one to restore.
+int lastOpen(const char *path)
+{
+    struct stat sb;
+    lastState *st;
+    int fd, rval = -1;
+
+    snprintf(lastPath, sizeof(lastPath), "%s", path);
+
+    if (lastLock == NULL && (lastLock = SDL_CreateMutex()) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "lastOpen: %s", SDL_GetError());
+        return -1;
+    }
+
+    memset(&state, 0, sizeof(state));
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+        return -1;
+
+    if (fstat(fd, &sb) == 0 && sb.st_size == sizeof(lastState) &&
+            (st = mmap(NULL, sizeof(lastState), PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED) {
+        if (st->magic == LAST_MAGIC && st->version == LAST_VER && st->size == sizeof(lastState) && st->sum == lastSum(st)) {
+            state = *st;
+            rval = 0;
+        } else
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Last known state in %s is not usable", path);
+        munmap(st, sizeof(lastState));
+    }
+
+    close(fd);
+
+    return rval;
+}
+
+// Save aside and rename into place
+int lastSave(void)
+{
+    char tmp[PATH_MAX+4];
+    lastState st;
+    int fd;
+
+    if (lastLock == NULL)
+        return -1;
+
+    SDL_LockMutex(lastLock);
+    st = state;
+    SDL_UnlockMutex(lastLock);
+
+    st.magic = LAST_MAGIC;
+    st.version = LAST_VER;
+    st.size = sizeof(lastState);
+    st.saved = time(NULL);
+    st.sum = lastSum(&st);
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", lastPath);
+
+    if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0664)) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "lastSave %s: %s", tmp, strerror(errno));
+        return -1;
+    }
+
+    if (write(fd, &st, sizeof(st)) != sizeof(st) || close(fd)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "lastSave %s: %s", tmp, strerror(errno));
+        close(fd);
+        unlink(tmp);
+        return -1;
+    }
+
+    if (rename(tmp, lastPath)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "lastSave %s: %s", lastPath, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Keep the latest of a channel from the bus
+void lastUpdate(const busMsg *msg)
+{
+    lastChan *ch;
+
+    if (lastLock == NULL || msg->chan < 0 || msg->chan >= BUS_NCHAN)
+        return;
+
+    ch = &state.chan[msg->chan];
+
+    SDL_LockMutex(lastLock);
+    ch->val = msg->val;
+    ch->val2 = msg->val2;
+    ch->ts = msg->ts;
+    ch->src = msg->src;
+    SDL_UnlockMutex(lastLock);
+}
+
+// The last known of a channel. Returns 0 if never seen.
+int lastGet(int chan, busMsg *msg)
+{
+    lastChan *ch;
+
+    if (chan < 0 || chan >= BUS_NCHAN || state.chan[chan].ts == 0)
+        return 0;
+
+    ch = &state.chan[chan];
+
+    SDL_LockMutex(lastLock);
+    msg->chan = chan;
+    msg->val = ch->val;
+    msg->val2 = ch->val2;
+    msg->ts = ch->ts;
+    msg->src = ch->src;
+    SDL_UnlockMutex(lastLock);
+
+    return 1;
+}
+
+// When the state was saved, 0 if there is none
+time_t lastSaved(void)
+{
+    return state.saved;
+}
+
+// Needle positions and page, from the render thread
+void lastSetNeedle(int n, float angle)
+{
+    if (n >= 0 && n < LAST_NNEEDLE)
+        state.needle[n] = angle;
+}
+
+float lastNeedle(int n)
+{
+    return n >= 0 && n < LAST_NNEEDLE? state.needle[n] : 0;
+}
+
+void lastSetPage(int page)
+{
+    state.page = page;
+}
+
+int lastPage(void)
+{
+    return state.page;
+}
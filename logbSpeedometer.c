@@ -0,0 +1,242 @@
+/*
+ * logbSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * An automatic logbook kept in its own sqlite database.
+ * Any thread may add periodic rows or events. They are put on a small queue
+ * and never touch the database. A single writer thread owns the connection,
+ * runs it in WAL mode and commits all queued entries in one transaction
+ * every LOGB_FLUSH seconds, so the SD card sees few and large writes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <limits.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define LOGB_QSIZE  256     // Queued entries before the oldest are dropped
+#define LOGB_FLUSH  300     // Seconds between commits
+
+static char logbPath[PATH_MAX];
+static SDL_mutex *logbLock;
+static SDL_cond *logbCond;
+static logbEntry logbQueue[LOGB_QSIZE];
+static int logbHead;        // Next entry to write
+static int logbCount;       // Entries in queue
+static int logbDropped;     // Overrun since last commit
+static int logbFlush;       // Commit as soon as possible
+
+int logbInit(const char *path)
+{
+    if (logbLock != NULL)
+        return 0;
+
+    snprintf(logbPath, sizeof(logbPath), "%s", path);
+
+    if ((logbLock = SDL_CreateMutex()) == NULL || (logbCond = SDL_CreateCond()) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "logbInit: %s", SDL_GetError());
+        return -1;
+    }
+
+    return 0;
+}
+
+// Queue an entry, never blocks on I/O
+void logbPut(const logbEntry *entry)
+{
+    if (logbLock == NULL)
+        return;
+
+    SDL_LockMutex(logbLock);
+
+    if (logbCount == LOGB_QSIZE) {
+        logbHead = (logbHead + 1) % LOGB_QSIZE;
+        logbCount--;
+        logbDropped++;
+    }
+
+    logbQueue[(logbHead + logbCount++) % LOGB_QSIZE] = *entry;
+
+    if (logbCount > LOGB_QSIZE/2) {
+        logbFlush = 1;
+        SDL_CondSignal(logbCond);
+    }
+
+    SDL_UnlockMutex(logbLock);
+}
+
+// Stop request from the supervisor, flush what is queued and leave
+static void logbWake(void)
+{
+    SDL_LockMutex(logbLock);
+    logbFlush = 1;
+    SDL_CondSignal(logbCond);
+    SDL_UnlockMutex(logbLock);
+}
+
+void logbEvent(const char *fmt, ...)
+{
+    logbEntry entry;
+    va_list ap;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.ts = time(NULL);
+    entry.kind = LOGB_EVENT;
+
+    va_start(ap, fmt);
+    vsnprintf(entry.text, sizeof(entry.text), fmt, ap);
+    va_end(ap);
+
+    logbPut(&entry);
+}
+
+static void logbBindReal(sqlite3_stmt *res, int col, double val)
+{
+    if (isnan(val))
+        sqlite3_bind_null(res, col);
+    else
+        sqlite3_bind_double(res, col, val);
+}
+
+// Write a batch of entries in one transaction
+static int logbCommit(sqlite3 *conn, sqlite3_stmt *rowRes, sqlite3_stmt *evRes, logbEntry *batch, int n)
+{
+    TRCE_SCOPE("logbCommit");
+    int rval = SQLITE_OK;
+
+    if (sqlite3_exec(conn, "BEGIN", NULL, NULL, NULL) != SQLITE_OK) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Logbook begin failed: %s", sqlite3_errmsg(conn));
+        return -1;
+    }
+
+    for (int i = 0; i < n && rval == SQLITE_OK; i++) {
+        logbEntry *e = &batch[i];
+        sqlite3_stmt *res;
+
+        if (e->kind == LOGB_EVENT) {
+            res = evRes;
+            sqlite3_bind_int64(res, 1, e->ts);
+            sqlite3_bind_text(res, 2, e->text, -1, SQLITE_STATIC);
+        } else {
+            res = rowRes;
+            sqlite3_bind_int64(res, 1, e->ts);
+            logbBindReal(res, 2, e->lat);
+            logbBindReal(res, 3, e->lon);
+            logbBindReal(res, 4, e->cog);
+            logbBindReal(res, 5, e->sog);
+            logbBindReal(res, 6, e->stw);
+            logbBindReal(res, 7, e->dbt);
+            logbBindReal(res, 8, e->awa);
+            logbBindReal(res, 9, e->aws);
+            logbBindReal(res, 10, e->volt);
+            logbBindReal(res, 11, e->curr);
+        }
+
+        if (sqlite3_step(res) != SQLITE_DONE) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Logbook insert failed: %s", sqlite3_errmsg(conn));
+            rval = SQLITE_ERROR;
+        }
+        sqlite3_reset(res);
+        sqlite3_clear_bindings(res);
+    }
+
+    if (sqlite3_exec(conn, rval == SQLITE_OK? "COMMIT" : "ROLLBACK", NULL, NULL, NULL) != SQLITE_OK) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Logbook commit failed: %s", sqlite3_errmsg(conn));
+        rval = SQLITE_ERROR;
+    }
+
+    return rval == SQLITE_OK? 0 : -1;
+}
+
+// The one and only writer of the logbook database
+int threadLogbook(void *conf)
+{
+    configuration *configParams = conf;
+    static logbEntry batch[LOGB_QSIZE];
+    sqlite3 *conn = NULL;
+    sqlite3_stmt *rowRes = NULL;
+    sqlite3_stmt *evRes = NULL;
+    time_t flushed = time(NULL);
+    int run = 1;
+
+    if (logbLock == NULL)
+        return 0;
+
+    if (sqlite3_open_v2(logbPath, &conn, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, 0)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open logbook %s: %s", logbPath, sqlite3_errmsg(conn));
+        (void)sqlite3_close(conn);
+        return 0;
+    }
+
+    if (sqlite3_exec(conn,
+            "PRAGMA journal_mode=WAL;"
+            "PRAGMA synchronous=NORMAL;"
+            "CREATE TABLE IF NOT EXISTS logbook (Id INTEGER PRIMARY KEY, ts INTEGER, lat REAL, lon REAL, cog REAL, sog REAL, stw REAL, dbt REAL, awa REAL, aws REAL, volt REAL, curr REAL);"
+            "CREATE TABLE IF NOT EXISTS events (Id INTEGER PRIMARY KEY, ts INTEGER, event TEXT);",
+            NULL, NULL, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(conn, "INSERT INTO logbook (ts,lat,lon,cog,sog,stw,dbt,awa,aws,volt,curr) VALUES (?,?,?,?,?,?,?,?,?,?,?)", -1, &rowRes, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(conn, "INSERT INTO events (ts,event) VALUES (?,?)", -1, &evRes, NULL) != SQLITE_OK) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to prepare logbook %s: %s", logbPath, sqlite3_errmsg(conn));
+            sqlite3_finalize(rowRes);
+            sqlite3_finalize(evRes);
+            (void)sqlite3_close(conn);
+            return 0;
+    }
+
+    SDL_Log("Starting up logbook writer");
+
+    thrdOnStop(logbWake);
+
+    while (run)
+    {
+        int n = 0, dropped;
+
+        SDL_LockMutex(logbLock);
+
+        if (!logbFlush)
+            SDL_CondWaitTimeout(logbCond, logbLock, 1000);
+
+        run = configParams->runLgb;
+
+        if (logbFlush || !run || time(NULL) - flushed >= LOGB_FLUSH) {
+            // Take the queue and release the producers before any I/O
+            while (logbCount) {
+                batch[n++] = logbQueue[logbHead];
+                logbHead = (logbHead + 1) % LOGB_QSIZE;
+                logbCount--;
+            }
+            flushed = time(NULL);
+            logbFlush = 0;
+        }
+
+        dropped = logbDropped;
+        logbDropped = 0;
+
+        SDL_UnlockMutex(logbLock);
+
+        if (dropped)
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Logbook queue overrun, %d entries lost", dropped);
+
+        if (n)
+            (void)logbCommit(conn, rowRes, evRes, batch, n);
+    }
+
+    sqlite3_finalize(rowRes);
+    sqlite3_finalize(evRes);
+    (void)sqlite3_close(conn);
+
+    SDL_Log("Logbook writer stopped");
+
+    return 0;
+}
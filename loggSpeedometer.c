@@ -0,0 +1,251 @@
+/*
+ * loggSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The log writer. SDL_Log() from any thread only copies the message into
+ * a slot of a lock-free ring and the writer thread does the syslog() or
+ * stdio, so a collector that logs while its server is gone is not held up
+ * by the log on top of it. A slot is claimed by a compare and swap of the
+ * head and handed over by its sequence number, and when the ring is full
+ * the message is counted and dropped rather than waited for.
+ * Messages that may repeat in a loop go through LOGG_LIMIT(), which lets
+ * one through per period from each call site and reports how many were
+ * suppressed in between, when the next one is let through or when the
+ * site has been quiet for a period.
+ * Before loggInit() and after loggClose() messages are written directly,
+ * as they are in a forked child after loggAfterFork().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define LOGG_RING   256     // Messages, a power of two
+#define LOGG_LEN    240
+#define LOGG_SWEEP  1000    // ms between looks at the suppressed sites
+
+typedef struct {
+    uint64_t    seq;        // Free for head == seq, ready for tail+1 == seq
+    int         prio;
+    char        text[LOGG_LEN];
+} loggSlot;
+
+static loggSlot ring[LOGG_RING];
+static uint64_t loggHead;
+static uint64_t loggTail;           // Only the writer moves it
+static unsigned loggDropped;
+static int loggIdle;                // The writer is about to sleep
+static int loggFd = -1;
+static int loggRun;
+static SDL_Thread *loggThread;
+static loggSite *loggSites;
+static void (*loggOut)(int prio, const char *text);
+
+// Into the ring, returns -1 when the caller has to write it itself
+int loggPut(int prio, const char *text)
+{
+    uint64_t pos;
+    loggSlot *slot;
+
+    if (!__atomic_load_n(&loggRun, __ATOMIC_ACQUIRE))
+        return -1;
+
+    pos = __atomic_load_n(&loggHead, __ATOMIC_RELAXED);
+
+    for (;;) {
+        uint64_t seq;
+
+        slot = &ring[pos % LOGG_RING];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == pos) {
+            if (__atomic_compare_exchange_n(&loggHead, &pos, pos + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (seq < pos) {
+            __atomic_add_fetch(&loggDropped, 1, __ATOMIC_RELAXED);
+            return 0;
+        } else
+            pos = __atomic_load_n(&loggHead, __ATOMIC_RELAXED);
+    }
+
+    slot->prio = prio;
+    snprintf(slot->text, sizeof(slot->text), "%s", text);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&loggIdle, 0, __ATOMIC_ACQ_REL))
+        (void)eventfd_write(loggFd, 1);
+
+    return 0;
+}
+
+static void loggSummary(loggSite *site, int n)
+{
+    char text[LOGG_LEN];
+
+    snprintf(text, sizeof(text), "%d repeated messages from %s:%d suppressed", n, site->file, site->line);
+    if (loggPut(site->prio, text))
+        loggOut(site->prio, text);
+}
+
+// One per period from a call site, see LOGG_LIMIT()
+int loggAllow(loggSite *site)
+{
+    Uint32 now = SDL_GetTicks();
+    int n;
+
+    if (__atomic_exchange_n(&site->linked, 1, __ATOMIC_ACQ_REL) == 0) {
+        site->next = __atomic_load_n(&loggSites, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&loggSites, &site->next, site, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            ;
+    } else if (!SDL_TICKS_PASSED(now, __atomic_load_n(&site->until, __ATOMIC_RELAXED))) {
+        __atomic_add_fetch(&site->suppressed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    __atomic_store_n(&site->until, now + site->period, __ATOMIC_RELAXED);
+
+    if ((n = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED)))
+        loggSummary(site, n);
+
+    return 1;
+}
+
+// Report the sites that have gone quiet with something suppressed
+static void loggSweep(void)
+{
+    Uint32 now = SDL_GetTicks();
+    int n;
+
+    for (loggSite *site = __atomic_load_n(&loggSites, __ATOMIC_ACQUIRE); site != NULL; site = site->next) {
+        if (SDL_TICKS_PASSED(now, __atomic_load_n(&site->until, __ATOMIC_RELAXED)) &&
+                (n = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED)))
+            loggSummary(site, n);
+    }
+}
+
+static int loggDrain(void)
+{
+    int n = 0;
+    unsigned dropped;
+
+    for (;;) {
+        loggSlot *slot = &ring[loggTail % LOGG_RING];
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != loggTail + 1)
+            break;
+
+        loggOut(slot->prio, slot->text);
+        __atomic_store_n(&slot->seq, loggTail + LOGG_RING, __ATOMIC_RELEASE);
+        loggTail++;
+        n++;
+    }
+
+    if ((dropped = __atomic_exchange_n(&loggDropped, 0, __ATOMIC_RELAXED))) {
+        char text[64];
+        snprintf(text, sizeof(text), "%u log messages dropped", dropped);
+        loggOut(SDL_LOG_PRIORITY_ERROR, text);
+    }
+
+    return n;
+}
+
+static int threadLogg(void *data)
+{
+    struct pollfd pfd = { .fd = loggFd, .events = POLLIN };
+    Uint32 sweep = SDL_GetTicks() + LOGG_SWEEP;
+    eventfd_t cnt;
+
+    while (__atomic_load_n(&loggRun, __ATOMIC_ACQUIRE))
+    {
+        loggDrain();
+
+        if (SDL_TICKS_PASSED(SDL_GetTicks(), sweep)) {
+            loggSweep();
+            sweep = SDL_GetTicks() + LOGG_SWEEP;
+        }
+
+        // Look again once idle is seen by the producers
+        __atomic_store_n(&loggIdle, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (loggDrain()) {
+            __atomic_store_n(&loggIdle, 0, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        if (poll(&pfd, 1, LOGG_SWEEP) > 0)
+            (void)eventfd_read(loggFd, &cnt);
+    }
+
+    loggDrain();
+
+    return 0;
+}
+
+// Start the writer, out does the actual writing
+int loggInit(void (*out)(int prio, const char *text))
+{
+    loggOut = out;
+
+    for (int i = 0; i < LOGG_RING; i++)
+        ring[i].seq = i;
+    loggHead = loggTail = 0;
+
+    if ((loggFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "loggInit: eventfd: %s", strerror(errno));
+        return -1;
+    }
+
+    __atomic_store_n(&loggRun, 1, __ATOMIC_RELEASE);
+
+    if ((loggThread = SDL_CreateThread(threadLogg, "threadLogg", NULL)) == NULL) {
+        __atomic_store_n(&loggRun, 0, __ATOMIC_RELEASE);
+        close(loggFd);
+        loggFd = -1;
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "loggInit: %s", SDL_GetError());
+        return -1;
+    }
+
+    atexit(loggClose);
+
+    return 0;
+}
+
+// In a forked child, which has the ring but not the writer thread
+void loggAfterFork(void)
+{
+    __atomic_store_n(&loggRun, 0, __ATOMIC_RELEASE);
+    loggThread = NULL;
+    if (loggFd >= 0)
+        close(loggFd);
+    loggFd = -1;
+}
+
+// Write what is left and go back to direct writes
+void loggClose(void)
+{
+    if (loggThread == NULL)
+        return;
+
+    __atomic_store_n(&loggRun, 0, __ATOMIC_RELEASE);
+    (void)eventfd_write(loggFd, 1);
+    SDL_WaitThread(loggThread, NULL);
+    loggThread = NULL;
+
+    loggSweep();
+    close(loggFd);
+    loggFd = -1;
+}
@@ -0,0 +1,367 @@
+/*
+ * metrSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * Metrics for a fleet of displays. With -M [address:]port a small HTTP
+ * listener, localhost unless an address is given, serves the counters in
+ * the Prometheus text format: NMEA sentences per source and type, checksum
+ * errors, reconnects, the age of every data channel, frame times per page,
+ * VNC clients, bytes and capture time, I2C errors and samples, alarms and
+ * the memory and CPU of the process.
+ * The counters are bumped with relaxed atomic adds where things happen and
+ * only read here, on the metrics thread, so a scrape costs the collectors
+ * and the render loop nothing. The channel ages come from the data bus.
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define METR_PORT   "9100"
+#define METR_SRCS   (BUS_SRC_I2C+1)
+#define METR_PAGES  (TRKPAGE+1)
+#define METR_OUT    32768
+
+static const char *metrTypes[] = {
+    "RMC", "GLL", "VTG", "HDG", "HDT", "HDM", "VHW", "DPT",
+    "DBT", "MTW", "MWV", "VWR", "ENV", "other"
+};
+#define METR_NTYPE  (sizeof(metrTypes)/sizeof(metrTypes[0]))
+
+static const char *srcNames[METR_SRCS] = { "net", "gps", "i2c" };
+
+static const char *chanNames[BUS_NCHAN] = {
+    "SOG", "STW", "DBT", "MTW", "HDM", "ROLL", "AWA", "AWS",
+    "TWA", "TWS", "VOLT", "CURR", "TEMP", "POWER", "POS"
+};
+
+static const char *pageNames[METR_PAGES] = {
+    "none", "cog", "sog", "dpt", "wnd", "gps", "cal", "pwr", "tsk", "wtr", "trk"
+};
+
+// Upper bounds of the frame time buckets, ms
+static const int frameBounds[] = { 5, 10, 20, 50, 100, 200, 500, 1000 };
+#define METR_NBUCKET (sizeof(frameBounds)/sizeof(frameBounds[0]))
+
+static uint64_t counters[METR_NCOUNT];
+static uint64_t sentences[METR_SRCS][METR_NTYPE];
+static uint64_t checksums[METR_SRCS];
+static uint64_t frames[METR_PAGES][METR_NBUCKET+1];
+static uint64_t frameUsec[METR_PAGES];
+static int metrPageNow;
+static time_t chanTs[BUS_NCHAN];
+
+static inline void metrInc(uint64_t *c, uint64_t n)
+{
+    __atomic_fetch_add(c, n, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t metrGet(const uint64_t *c)
+{
+    return __atomic_load_n(c, __ATOMIC_RELAXED);
+}
+
+void metrAdd(int counter, uint64_t n)
+{
+    if (counter >= 0 && counter < METR_NCOUNT)
+        metrInc(&counters[counter], n);
+}
+
+void metrSet(int counter, uint64_t val)
+{
+    if (counter >= 0 && counter < METR_NCOUNT)
+        __atomic_store_n(&counters[counter], val, __ATOMIC_RELAXED);
+}
+
+// A validated sentence, or one that failed the checksum
+void metrSentence(int src, const char *str, int bad)
+{
+    size_t t;
+
+    if (src < 0 || src >= METR_SRCS)
+        return;
+
+    if (bad) {
+        metrInc(&checksums[src], 1);
+        return;
+    }
+
+    for (t = 0; t < METR_NTYPE-1; t++) {
+        if (strnlen(str, 6) == 6 && !strncmp(&str[3], metrTypes[t], 3))
+            break;
+    }
+
+    metrInc(&sentences[src][t], 1);
+}
+
+// Page of the frames to come, from the render loop
+void metrPage(int page)
+{
+    metrPageNow = page > 0 && page < METR_PAGES? page : 0;
+}
+
+// Time to render a frame, from the render loop
+void metrFrame(float ms)
+{
+    size_t b;
+
+    for (b = 0; b < METR_NBUCKET && ms > frameBounds[b]; b++)
+        ;
+
+    metrInc(&frames[metrPageNow][b], 1);
+    metrInc(&frameUsec[metrPageNow], ms*1000);
+}
+
+static int metrPrintf(char *buf, int len, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    if (len >= METR_OUT)
+        return len;
+
+    va_start(ap, fmt);
+    n = vsnprintf(buf + len, METR_OUT - len, fmt, ap);
+    va_end(ap);
+
+    return n < 0? len : len + n;
+}
+
+static void metrHelp(char *buf, int *len, const char *name, const char *type, const char *help)
+{
+    *len = metrPrintf(buf, *len, "# HELP sdlspeedometer_%s %s\n# TYPE sdlspeedometer_%s %s\n", name, help, name, type);
+}
+
+static void metrCounter(char *buf, int *len, int c, const char *name, const char *help)
+{
+    metrHelp(buf, len, name, "counter", help);
+    *len = metrPrintf(buf, *len, "sdlspeedometer_%s %llu\n", name, (unsigned long long)metrGet(&counters[c]));
+}
+
+// Resident set and CPU time of the whole process
+static void metrProcess(char *buf, int *len)
+{
+    struct rusage ru;
+    long pages = 0;
+    FILE *fp;
+
+    if ((fp = fopen("/proc/self/statm", "r")) != NULL) {
+        if (fscanf(fp, "%*d %ld", &pages) != 1)
+            pages = 0;
+        fclose(fp);
+    }
+
+    *len = metrPrintf(buf, *len, "# HELP process_resident_memory_bytes Resident memory size in bytes.\n"
+        "# TYPE process_resident_memory_bytes gauge\nprocess_resident_memory_bytes %ld\n", pages * sysconf(_SC_PAGESIZE));
+
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        double cpu = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec)/1e6;
+        *len = metrPrintf(buf, *len, "# HELP process_cpu_seconds_total Total user and system CPU time spent in seconds.\n"
+            "# TYPE process_cpu_seconds_total counter\nprocess_cpu_seconds_total %.2f\n", cpu);
+    }
+}
+
+static int metrRender(char *buf, const configuration *configParams)
+{
+    time_t now = time(NULL);
+    int len = 0;
+
+    metrHelp(buf, &len, "nmea_sentences_total", "counter", "Valid NMEA sentences by source and type.");
+    for (int s = 0; s < METR_SRCS; s++) {
+        for (size_t t = 0; t < METR_NTYPE; t++) {
+            uint64_t n = metrGet(&sentences[s][t]);
+            if (n)
+                len = metrPrintf(buf, len, "sdlspeedometer_nmea_sentences_total{source=\"%s\",type=\"%s\"} %llu\n",
+                    srcNames[s], metrTypes[t], (unsigned long long)n);
+        }
+    }
+
+    metrHelp(buf, &len, "nmea_checksum_errors_total", "counter", "NMEA sentences with a bad checksum by source.");
+    for (int s = 0; s < BUS_SRC_I2C; s++)
+        len = metrPrintf(buf, len, "sdlspeedometer_nmea_checksum_errors_total{source=\"%s\"} %llu\n",
+            srcNames[s], (unsigned long long)metrGet(&checksums[s]));
+
+    metrCounter(buf, &len, METR_RECONNECT, "net_reconnects_total", "Connections made to the NMEA server.");
+
+    metrHelp(buf, &len, "channel_age_seconds", "gauge", "Seconds since a data channel was last updated.");
+    for (int c = 0; c < BUS_NCHAN; c++) {
+        if (chanTs[c])
+            len = metrPrintf(buf, len, "sdlspeedometer_channel_age_seconds{channel=\"%s\"} %ld\n", chanNames[c], (long)(now - chanTs[c]));
+    }
+
+    metrHelp(buf, &len, "frame_seconds", "histogram", "Time to render a frame by page.");
+    for (int p = 1; p < METR_PAGES; p++) {
+        uint64_t cum = 0;
+
+        for (size_t b = 0; b <= METR_NBUCKET; b++) {
+            cum += metrGet(&frames[p][b]);
+            if (b < METR_NBUCKET)
+                len = metrPrintf(buf, len, "sdlspeedometer_frame_seconds_bucket{page=\"%s\",le=\"%g\"} %llu\n",
+                    pageNames[p], frameBounds[b]/1000.0, (unsigned long long)cum);
+            else
+                len = metrPrintf(buf, len, "sdlspeedometer_frame_seconds_bucket{page=\"%s\",le=\"+Inf\"} %llu\n",
+                    pageNames[p], (unsigned long long)cum);
+        }
+        len = metrPrintf(buf, len, "sdlspeedometer_frame_seconds_sum{page=\"%s\"} %.6f\n", pageNames[p], metrGet(&frameUsec[p])/1e6);
+        len = metrPrintf(buf, len, "sdlspeedometer_frame_seconds_count{page=\"%s\"} %llu\n", pageNames[p], (unsigned long long)cum);
+    }
+
+    metrHelp(buf, &len, "vnc_clients", "gauge", "Connected VNC clients.");
+    len = metrPrintf(buf, len, "sdlspeedometer_vnc_clients %d\n", __atomic_load_n(&configParams->vncClients, __ATOMIC_RELAXED));
+    metrCounter(buf, &len, METR_VNC_BYTES, "vnc_sent_bytes_total", "Bytes sent to VNC clients.");
+    metrHelp(buf, &len, "vnc_capture_seconds", "summary", "Time to read back and convert a frame for VNC.");
+    len = metrPrintf(buf, len, "sdlspeedometer_vnc_capture_seconds_sum %.6f\nsdlspeedometer_vnc_capture_seconds_count %llu\n",
+        metrGet(&counters[METR_VNC_USEC])/1e6, (unsigned long long)metrGet(&counters[METR_VNC_FRAMES]));
+
+    metrCounter(buf, &len, METR_I2C_ERRORS, "i2c_read_errors_total", "Failed I2C reads.");
+    metrCounter(buf, &len, METR_I2C_SAMPLES, "i2c_samples_total", "Heading and roll samples read over I2C.");
+    metrCounter(buf, &len, METR_ALARMS, "alarms_total", "Alarms raised.");
+
+    metrProcess(buf, &len);
+
+    return len < METR_OUT? len : METR_OUT-1;
+}
+
+// Listening socket for [address:]port, localhost when there is no address
+static int metrListen(const char *spec)
+{
+    struct addrinfo hints, *res, *ai;
+    char host[100];
+    const char *port, *colon;
+    int fd = -1, on = 1;
+
+    if ((colon = strrchr(spec, ':')) != NULL) {
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - spec), spec);
+        port = colon + 1;
+    } else {
+        snprintf(host, sizeof(host), "127.0.0.1");
+        port = *spec? spec : METR_PORT;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    if (getaddrinfo(*host? host : NULL, port, &hints, &res)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Metrics: cannot resolve %s", spec);
+        return -1;
+    }
+
+    for (ai = res; ai != NULL; ai = ai->ai_next) {
+        if ((fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) < 0)
+            continue;
+        (void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 4) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(res);
+
+    if (fd < 0)
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Metrics: cannot listen on %s: %s", spec, strerror(errno));
+    else
+        SDL_Log("Metrics on http://%s:%s/metrics", *host? host : "*", port);
+
+    return fd;
+}
+
+// One request per connection, whatever the path
+static void metrServe(int cfd, char *out, const configuration *configParams)
+{
+    char req[1024], head[160];
+    int n, len;
+
+    if (thrdWait(cfd, POLLIN, 2000) <= 0 || (n = recv(cfd, req, sizeof(req)-1, 0)) <= 0)
+        return;
+
+    req[n] = '\0';
+
+    if (strncmp(req, "GET ", 4)) {
+        n = snprintf(head, sizeof(head), "HTTP/1.0 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        (void)send(cfd, head, n, MSG_NOSIGNAL);
+        return;
+    }
+
+    len = metrRender(out, configParams);
+    n = snprintf(head, sizeof(head), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: %d\r\nConnection: close\r\n\r\n", len);
+
+    if (send(cfd, head, n, MSG_NOSIGNAL) != n)
+        return;
+
+    for (int off = 0; off < len; off += n) {
+        if ((n = send(cfd, out + off, len - off, MSG_NOSIGNAL)) <= 0)
+            break;
+    }
+}
+
+int threadMetrics(void *conf)
+{
+    configuration *configParams = conf;
+    busSub *bus;
+    busMsg msg;
+    struct timeval tmo = { 2, 0 };
+    char *out;
+    int lfd, cfd;
+
+    if ((lfd = metrListen(configParams->metrics)) < 0)
+        return 0;
+
+    if ((out = malloc(METR_OUT)) == NULL || (bus = busSubscribe(BUS_MASK(BUS_NCHAN)-1, 0)) == NULL) {
+        free(out);
+        close(lfd);
+        return 0;
+    }
+
+    while (configParams->runMtr)
+    {
+        int rval = thrdWait(lfd, POLLIN, 1000);
+
+        if (rval < 0)
+            break;
+
+        // Only the latest of each channel matters, drained often enough not to overrun
+        while (busPoll(bus, &msg)) {
+            if (msg.ts > chanTs[msg.chan])
+                chanTs[msg.chan] = msg.ts;
+        }
+
+        if (rval == 0 || (cfd = accept(lfd, NULL, NULL)) < 0)
+            continue;
+
+        // A stuck scraper holds up no more than this thread, and not for long
+        (void)setsockopt(cfd, SOL_SOCKET, SO_SNDTIMEO, &tmo, sizeof(tmo));
+
+        metrServe(cfd, out, configParams);
+        close(cfd);
+    }
+
+    busUnsubscribe(bus);
+    free(out);
+    close(lfd);
+
+    SDL_Log("Metrics stopped");
+
+    return 0;
+}
@@ -0,0 +1,319 @@
+/*
+ * plotSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * A small plotting engine for the depth and power charts.
+ * Points are kept in buffers allocated once by plotInit() and drawn with
+ * SDL_RenderDrawLinesF() and, for the min/max envelope, SDL_RenderGeometry().
+ * Axes, grid and labels are rendered once into a target texture that is
+ * only rebuilt when the axis ranges or captions change. A renderer without
+ * target textures gets the same layer drawn by a software renderer.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include "sdlSpeedometer.h"
+
+#define PLOT_FONTSIZE   12
+#define PLOT_MLEFT      40      // Margin for y-axis labels
+#define PLOT_MBOTTOM    30      // Margin for x-axis labels
+#define PLOT_MTOP       16      // Margin for the y-axis caption
+#define PLOT_MRIGHT     12
+
+#define GRAPH_W(p)  ((p)->area.w - PLOT_MLEFT - PLOT_MRIGHT)
+#define GRAPH_H(p)  ((p)->area.h - PLOT_MTOP - PLOT_MBOTTOM)
+
+int plotInit(plotParams *p, SDL_Renderer *renderer, const char *fontPath, int x, int y, int w, int h, int maxpoints)
+{
+    memset(p, 0, sizeof(plotParams));
+
+    p->renderer = renderer;
+    p->fontPath = fontPath;
+    p->area.x = x;
+    p->area.y = y;
+    p->area.w = w;
+    p->area.h = h;
+    p->max_x = p->max_y = 1;
+    p->scale_x = p->scale_y = 1;
+    p->caption_x = p->caption_y = "";
+    p->maxpoints = maxpoints;
+
+    p->data = malloc(sizeof(float)*4*maxpoints);
+    p->line = malloc(sizeof(SDL_FPoint)*maxpoints);
+#if SDL_VERSION_ATLEAST(2,0,18)
+    p->verts = malloc(sizeof(SDL_Vertex)*2*maxpoints);
+    p->indices = malloc(sizeof(int)*6*maxpoints);
+    if (p->verts == NULL || p->indices == NULL)
+        p->maxpoints = 0;
+#endif
+
+    if (p->data == NULL || p->line == NULL)
+        p->maxpoints = 0;
+
+    if (p->maxpoints == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "plotInit: Out of memory");
+        plotClose(p);
+        return -1;
+    }
+
+    return 0;
+}
+
+void plotClose(plotParams *p)
+{
+    if (p->layer != NULL)
+        SDL_DestroyTexture(p->layer);
+
+    free(p->data);
+    free(p->line);
+#if SDL_VERSION_ATLEAST(2,0,18)
+    free(p->verts);
+    free(p->indices);
+#endif
+    memset(p, 0, sizeof(plotParams));
+}
+
+void plotClear(plotParams *p)
+{
+    p->npoints = 0;
+}
+
+// Add a point with its envelope. NAN values leave a gap.
+void plotAdd(plotParams *p, float x, float y, float lo, float hi)
+{
+    float *d;
+
+    if (p->npoints >= p->maxpoints)
+        return;
+
+    d = &p->data[4*p->npoints++];
+    d[0] = x;
+    d[1] = y;
+    d[2] = lo;
+    d[3] = hi;
+}
+
+static inline float plotX(plotParams *p, float x)
+{
+    return p->area.x + PLOT_MLEFT + (x/p->max_x) * GRAPH_W(p);
+}
+
+static inline float plotY(plotParams *p, float y)
+{
+    if (y > p->max_y) y = p->max_y;
+    if (y < 0) y = 0;
+
+    return p->area.y + PLOT_MTOP + GRAPH_H(p) - (y/p->max_y) * GRAPH_H(p);
+}
+
+static void plotLabel(plotParams *p, TTF_Font *font, const char *text, int x, int y, int center)
+{
+    SDL_Color color = {0, 0, 0, 255};
+    SDL_Surface *surface;
+    SDL_Texture *texture;
+    SDL_Rect rect;
+
+    if (font == NULL || *text == '\0' || (surface = TTF_RenderText_Blended(font, text, color)) == NULL)
+        return;
+
+    rect.w = surface->w;
+    rect.h = surface->h;
+    rect.x = center? x - rect.w/2 : x;
+    rect.y = y;
+
+    if ((texture = SDL_CreateTextureFromSurface(p->renderer, surface)) != NULL) {
+        SDL_RenderCopy(p->renderer, texture, NULL, &rect);
+        SDL_DestroyTexture(texture);
+    }
+
+    SDL_FreeSurface(surface);
+}
+
+// Grid, axes and labels relative to the current render target at (ox, oy)
+static void plotAxes(plotParams *p, int ox, int oy)
+{
+    TTF_Font *font = asetFont(p->fontPath, PLOT_FONTSIZE);
+    SDL_Rect area = p->area;
+    char txt[20];
+
+    // Draw as if at screen position, then shift into the target
+    p->area.x = ox;
+    p->area.y = oy;
+
+    SDL_SetRenderDrawColor(p->renderer, 190, 190, 190, 255);
+
+    for (float x = 0; x <= p->max_x + 0.001; x += p->scale_x) {
+        SDL_RenderDrawLineF(p->renderer, plotX(p, x), plotY(p, 0), plotX(p, x), plotY(p, p->max_y));
+        snprintf(txt, sizeof(txt), "%g", x);
+        plotLabel(p, font, txt, plotX(p, x), plotY(p, 0) + 4, 1);
+    }
+
+    for (float y = 0; y <= p->max_y + 0.001; y += p->scale_y) {
+        SDL_SetRenderDrawColor(p->renderer, 190, 190, 190, 255);
+        SDL_RenderDrawLineF(p->renderer, plotX(p, 0), plotY(p, y), plotX(p, p->max_x), plotY(p, y));
+        snprintf(txt, sizeof(txt), "%g", y);
+        plotLabel(p, font, txt, ox + 2, plotY(p, y) - PLOT_FONTSIZE/2, 0);
+    }
+
+    SDL_SetRenderDrawColor(p->renderer, 0, 0, 0, 255);
+    SDL_RenderDrawLineF(p->renderer, plotX(p, 0), plotY(p, 0), plotX(p, p->max_x), plotY(p, 0));
+    SDL_RenderDrawLineF(p->renderer, plotX(p, 0), plotY(p, 0), plotX(p, 0), plotY(p, p->max_y));
+
+    plotLabel(p, font, p->caption_x, plotX(p, p->max_x/2), plotY(p, 0) + PLOT_FONTSIZE + 4, 1);
+    plotLabel(p, font, p->caption_y, ox + 2, oy, 0);
+
+    p->area = area;
+}
+
+// Draw the layer into a surface and upload it. Returns -1 on failure.
+static int plotSoftLayer(plotParams *p)
+{
+    SDL_Renderer *renderer = p->renderer;
+    SDL_Renderer *soft;
+    SDL_Surface *surface;
+
+    if ((surface = SDL_CreateRGBSurfaceWithFormat(0, p->area.w, p->area.h, 32, SDL_PIXELFORMAT_ARGB8888)) == NULL)
+        return -1;
+
+    if ((soft = SDL_CreateSoftwareRenderer(surface)) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "plotLayer: SDL_CreateSoftwareRenderer failed: %s", SDL_GetError());
+        SDL_FreeSurface(surface);
+        return -1;
+    }
+
+    SDL_SetRenderDrawColor(soft, 0, 0, 0, 0);
+    SDL_RenderClear(soft);
+    p->renderer = soft;
+    plotAxes(p, 0, 0);
+    p->renderer = renderer;
+    SDL_DestroyRenderer(soft);
+
+    if (p->layer != NULL)
+        SDL_DestroyTexture(p->layer);
+    if ((p->layer = SDL_CreateTextureFromSurface(renderer, surface)) != NULL)
+        SDL_SetTextureBlendMode(p->layer, SDL_BLENDMODE_BLEND);
+
+    SDL_FreeSurface(surface);
+
+    return p->layer == NULL? -1 : 0;
+}
+
+// Render the static layer again if the axes has changed since last frame
+static void plotLayer(plotParams *p)
+{
+    SDL_Texture *target;
+
+    if (p->layer != NULL && p->lmax_x == p->max_x && p->lmax_y == p->max_y &&
+            p->lscale_x == p->scale_x && p->lscale_y == p->scale_y &&
+                p->lcaption_x == p->caption_x && p->lcaption_y == p->caption_y)
+        return;
+
+    if (p->layer == NULL && !p->soft && SDL_RenderTargetSupported(p->renderer)) {
+        p->layer = SDL_CreateTexture(p->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, p->area.w, p->area.h);
+        if (p->layer == NULL)
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "plotLayer: SDL_CreateTexture failed: %s", SDL_GetError());
+        else
+            SDL_SetTextureBlendMode(p->layer, SDL_BLENDMODE_BLEND);
+    }
+
+    p->soft = p->layer == NULL || p->soft;
+
+    if (!p->soft) {
+        target = SDL_GetRenderTarget(p->renderer);
+        SDL_SetRenderTarget(p->renderer, p->layer);
+        SDL_SetRenderDrawColor(p->renderer, 0, 0, 0, 0);
+        SDL_RenderClear(p->renderer);
+        plotAxes(p, 0, 0);
+        SDL_SetRenderTarget(p->renderer, target);
+    } else if (plotSoftLayer(p)) {
+        return;
+    }
+
+    p->lmax_x = p->max_x;
+    p->lmax_y = p->max_y;
+    p->lscale_x = p->scale_x;
+    p->lscale_y = p->scale_y;
+    p->lcaption_x = p->caption_x;
+    p->lcaption_y = p->caption_y;
+}
+
+void plotDraw(plotParams *p, Uint32 color)
+{
+    Uint8 r = (color >> 16) & 0xff;
+    Uint8 g = (color >> 8) & 0xff;
+    Uint8 b = color & 0xff;
+    int n = 0;
+
+    if (p->maxpoints == 0 || p->max_x <= 0 || p->max_y <= 0 || p->scale_x <= 0 || p->scale_y <= 0)
+        return;
+
+    plotLayer(p);
+
+    if (p->layer != NULL)
+        SDL_RenderCopy(p->renderer, p->layer, NULL, &p->area);
+    else
+        plotAxes(p, p->area.x, p->area.y);
+
+#if SDL_VERSION_ATLEAST(2,0,18)
+    {
+        SDL_Color fill = {r, g, b, 96};
+        int nidx = 0;
+
+        // Min/max envelope as a strip of quads between valid neighbours
+        for (int i = 0; i < p->npoints; i++) {
+            float *d = &p->data[4*i];
+            SDL_Vertex *v = &p->verts[2*i];
+
+            v[0].position.x = v[1].position.x = plotX(p, d[0]);
+            v[0].position.y = plotY(p, isnan(d[2])? 0 : d[2]);
+            v[1].position.y = plotY(p, isnan(d[3])? 0 : d[3]);
+            v[0].color = v[1].color = fill;
+            v[0].tex_coord.x = v[0].tex_coord.y = v[1].tex_coord.x = v[1].tex_coord.y = 0;
+
+            if (i && !isnan(d[2]) && !isnan(d[-2])) {
+                int *ix = &p->indices[nidx];
+                int a = 2*(i-1);
+                ix[0] = a;   ix[1] = a+1; ix[2] = a+2;
+                ix[3] = a+1; ix[4] = a+3; ix[5] = a+2;
+                nidx += 6;
+            }
+        }
+
+        if (nidx) {
+            SDL_SetRenderDrawBlendMode(p->renderer, SDL_BLENDMODE_BLEND);
+            SDL_RenderGeometry(p->renderer, NULL, p->verts, 2*p->npoints, p->indices, nidx);
+            SDL_SetRenderDrawBlendMode(p->renderer, SDL_BLENDMODE_NONE);
+        }
+    }
+#endif
+
+    // The mean as polylines broken at gaps
+    SDL_SetRenderDrawColor(p->renderer, r, g, b, 255);
+
+    for (int i = 0; i <= p->npoints; i++) {
+        float *d = &p->data[4*i];
+
+        if (i == p->npoints || isnan(d[1])) {
+            if (n > 1)
+                SDL_RenderDrawLinesF(p->renderer, p->line, n);
+            else if (n == 1)
+                SDL_RenderDrawPointF(p->renderer, p->line[0].x, p->line[0].y);
+            n = 0;
+            continue;
+        }
+
+        p->line[n].x = plotX(p, d[0]);
+        p->line[n].y = plotY(p, d[1]);
+        n++;
+    }
+}
@@ -23,7 +23,6 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
-#include <SDL2/SDL_net.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -36,6 +35,10 @@
 #include <time.h>
 #include <syslog.h>
 #include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
 
 #include "sdlSpeedometer.h"
 
@@ -47,9 +50,22 @@
 
 #define S_TIMEOUT   4       // Invalidate current sentences after # seconds without a refresh from talker.
 #define TRGPS       2.5     // Min speed to be trusted as real movement from GPS RMC
+#define PLOT_POINTS  760    // Max buckets in a plot, one per pixel
+#define LOGB_PERIOD  60     // Seconds between periodic logbook rows
+#define IDLE_TIME    10     // Default minutes without touch before idle mode
+#define CPU_BUDGET   40     // Default percent of a core for rendering
+#define CALM_SOG     0.5    // Max SOG over 10 minutes for idle mode
+#define CALM_HDM     30     // Max heading deviation over 10 minutes for idle mode
+#define CALM_DBT     1.5    // Max depth variation over 10 minutes for idle mode
+#define LAST_PERIOD  10     // Seconds between saves of the last known state
+#define LAST_HOLD    60     // Max seconds to show a last known value without live data
+#define STALE_AGE    (S_TIMEOUT/2+1) // Age given to last known values, valid but not fresh
 #define NMPARSE(str, nsent) !strncmp(nsent, &str[3], strlen(nsent))
 
 #define DEFAULT_SCREEN_SIZE     "800x480"   // Default screen size
+#define XORG_WAIT               10000       // ms to wait for Xorg at startup
+#define XWM_WAIT                5000        // ms to wait for the window manager
+#define DEVILSPIE               "/usr/bin/devilspie2"
 #define DEFAULT_SCREEN_SCALE    1.0
 
 #define DEFAULT_FONT        "/usr/share/fonts/truetype/dejavu/DejaVuSansMono-Bold.ttf";
@@ -68,11 +84,23 @@
 #define SOUND_PATH  "./sounds/"
 #define IMAGE_PATH  "./img/"
 #define SQLDBPATH   "speedometer.db"
+#define HISTPATH    "history.dat"
+#define LOGBPATH    "logbook.db"
+#define TRCKPATH    "track.dat"
+#define ARCHPATH    "archive"
+#define LASTPATH    "last.dat"
+#define SNAPDIR     "./"
 #define SPAWNCMD    "./spawnSubtask"
 #else
 #define SOUND_PATH  "/usr/local/share/sounds/"
 #define IMAGE_PATH  "/usr/local/share/images/"
 #define SQLDBPATH   "/usr/local/etc/speedometer/speedometer.db"
+#define HISTPATH    "/usr/local/etc/speedometer/history.dat"
+#define LOGBPATH    "/usr/local/etc/speedometer/logbook.db"
+#define TRCKPATH    "/usr/local/etc/speedometer/track.dat"
+#define ARCHPATH    "/usr/local/etc/speedometer/archive"
+#define LASTPATH    "/usr/local/etc/speedometer/last.dat"
+#define SNAPDIR     "/usr/local/etc/speedometer/"
 #define SPAWNCMD    "/usr/local/bin/spawnSubtask"
 #endif
 
@@ -81,6 +109,8 @@
 #define BLACK   1
 #define WHITE   2
 #define RED     3
+#define GREY    4   // Last known, not live
+#define PLOT_GREY 0x808080  // Plot line while the live value is stale
 #define DWRN    10  // Turn RED at depth < 10
 
 static int useSyslog = 0;
@@ -89,20 +119,42 @@ static SDL_Texture* Background_Tx;
 
 static collected_nmea cnmea;
 
+static uint32_t staleMask;          // Channels showing the last known state
+static int staleSrc[BUS_NCHAN];
+static time_t staleSince;
+
 static warnings warn;
+static SDL_mutex *configLock;   // warn, tty and server as reloaded by threadConfig
 
-void logCallBack(char *userdata, int category, SDL_LogPriority priority, const char *message)
+static char *logName;
+static int noGps, noNet;        // Collectors disabled on the command line
+static int calibReload;         // The database has changed, read the calibration again
+static int subtaskReload;       // ... and the subtasks, on the render thread
+static int vncRun;              // threadVNC keeps serving
+static SDL_mutex *vncLock;      // The screen is not captured while the server is rebound
+
+static void logWrite(int priority, const char *message)
 {
     FILE *out = priority == SDL_LOG_PRIORITY_ERROR? stderr : stdout;
 
     if (useSyslog)
-        syslog (LOG_NOTICE, message, getuid ());
+        syslog (LOG_NOTICE, "%s", message);
     else
-        fprintf(out, "[%s] %s\n", basename(userdata), message);
+        fprintf(out, "[%s] %s\n", logName, message);
+}
+
+// Handed to the log writer thread once it runs
+void logCallBack(char *userdata, int category, SDL_LogPriority priority, const char *message)
+{
+    if (logName == NULL)
+        logName = basename(userdata);
+
+    if (loggPut(priority, message))
+        logWrite(priority, message);
 }
 
 // The configuration database
-int  configureDb(configuration *configParams)
+int  configureDb(configuration *configParams, warnings *warn)
 {
     sqlite3 *conn;
     sqlite3_stmt *res;
@@ -225,9 +277,9 @@ int  configureDb(configuration *configParams)
     // Fetch warnings
     rval = sqlite3_prepare_v2(conn, "select depthw,lowvoltw,highcurrw from warnings", -1, &res, &tail);        
     if (rval == SQLITE_OK && sqlite3_step(res) == SQLITE_ROW) {
-        warn.depthw    = sqlite3_column_double(res, 0);
-        warn.lowvoltw  = sqlite3_column_double(res, 1);
-        warn.highcurrw = sqlite3_column_double(res, 2);
+        warn->depthw    = sqlite3_column_double(res, 0);
+        warn->lowvoltw  = sqlite3_column_double(res, 1);
+        warn->highcurrw = sqlite3_column_double(res, 2);
     } else {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to fetch warning values from database: %s", (char*)sqlite3_errmsg(conn));
     }
@@ -249,6 +301,18 @@ int  configureDb(configuration *configParams)
     return rval;
 }
 
+// The depth warning as last reloaded
+static float warnDepth(void)
+{
+    float depthw;
+
+    SDL_LockMutex(configLock);
+    depthw = warn.depthw;
+    SDL_UnlockMutex(configLock);
+
+    return depthw;
+}
+
  // Extract an item from an NMEA sentence
 static char *getf(int pos, char *str)
 {
@@ -343,8 +407,8 @@ static int portConfigure(int fd, configuration *configParams)
     return 0;
 }
 
-// Validate an NMEA sentence
-static int nmeaChecksum(char * str_p1, char * str_p2, int cnt)
+// Validate an NMEA sentence, and count it for the metrics
+static int nmeaChecksum(int src, char * str_p1, char * str_p2, int cnt)
 {
     uint8_t checksum;
     int i, cs;
@@ -376,8 +440,10 @@ static int nmeaChecksum(char * str_p1, char * str_p2, int cnt)
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Checksum error in nmea sentence: 0x%02x/0x%02x - '%s'/'%s', pos %d", \
                 checksum, (uint8_t)strtol(&str_p1[cs], NULL, 16), str_p1, &str_p1[cs], cs);
         }
+        metrSentence(src, str_p1, 1);
         return 1;
     }
+    metrSentence(src, str_p1, 0);
     return 0;
 }
 
@@ -446,6 +512,56 @@ float dms2dd(float coordinates, const char *val)
    return c;
 }
 
+// The current value of a channel from what is collected
+static double cnmeaValue(int chan)
+{
+    switch (chan) {
+        case HIST_SOG:      return cnmea.rmc;
+        case HIST_STW:      return cnmea.stw;
+        case HIST_DBT:      return cnmea.dbt;
+        case HIST_MTW:      return cnmea.mtw;
+        case HIST_HDM:      return cnmea.hdm;
+        case HIST_ROLL:     return cnmea.roll;
+        case HIST_AWA:      return cnmea.vwrd == 1? 360 - cnmea.vwra : cnmea.vwra;
+        case HIST_AWS:      return cnmea.vwrs;
+        case HIST_TWA:      return cnmea.vwta;
+        case HIST_TWS:      return cnmea.vwts;
+        case HIST_VOLT:     return cnmea.volt;
+        case HIST_CURR:     return cnmea.curr;
+        case HIST_TEMP:     return cnmea.temp;
+        case HIST_POWER:    return cnmea.volt * cnmea.curr;
+    }
+
+    return NAN;
+}
+
+// Tell the bus subscribers about the channels just collected
+static void publish(uint32_t mask, int src, time_t ts)
+{
+    for (int c = 0; c < HIST_NCHAN; c++) {
+        if (mask & BUS_MASK(c))
+            busPublish(c, src, ts, cnmeaValue(c), 0);
+    }
+}
+
+// Hand the current position over to the track recorder and the bus
+static void trackFix(time_t ts, int src)
+{
+    trckFix fix;
+
+    if (!strlen(cnmea.gll) || !strlen(cnmea.glo))
+        return;
+
+    fix.ts  = ts;
+    fix.lat = dms2dd(atof(cnmea.gll),"m") * (cnmea.glns[0] == 'S'? -1 : 1);
+    fix.lon = dms2dd(atof(cnmea.glo),"m") * (cnmea.glne[0] == 'W'? -1 : 1);
+    fix.sog = cnmea.rmc;
+    fix.cog = ts - cnmea.cog_ts > S_TIMEOUT? 0 : cnmea.cog;
+
+    trckAdd(&fix);
+    busPublish(BUS_POS, src, ts, fix.lat, fix.lon);
+}
+
 // Collect serial GPS sentences
 static int threadSerial(void *conf)
 {
@@ -467,8 +583,6 @@ static int threadSerial(void *conf)
 
     tcflush(fd, TCIOFLUSH);
 
-    configParams->numThreads++;
-
     while(configParams->runGps)
     {
         time_t ct;
@@ -477,22 +591,27 @@ static int threadSerial(void *conf)
 
         // The vessels network has precedence
         if (!(time(NULL) - cnmea.net_ts > S_TIMEOUT)) {
-            SDL_Delay(1000);
+            thrdSleep(1000);
             continue;
         }            
 
+        if (thrdWait(fd, POLLIN, 1000) <= 0)
+            continue;
+
         memset(buffer, 0, sizeof(buffer));
 
-        if ((cnt=read(fd, buffer, sizeof(buffer))) <0) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not read GPS device %s %s %d", configParams->tty, strerror(errno), errno);
-            SDL_Delay(40);
+        if ((cnt=read(fd, buffer, sizeof(buffer)-1)) <= 0) {
+            if (cnt < 0)
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not read GPS device %s %s %d", configParams->tty, strerror(errno), errno);
+            thrdSleep(40);
             continue;
         }
 
+        TRCE_SCOPE("nmeaGps");
         buffer[strlen(buffer)-1] = '\0';
         if (!strlen(buffer)) continue;
 
-        if(nmeaChecksum(buffer, NULL, strlen(buffer))) continue;
+        if(nmeaChecksum(BUS_SRC_GPS, buffer, NULL, strlen(buffer))) continue;
 
         ct = time(NULL);    // Get a timestamp for this turn 
 
@@ -504,6 +623,8 @@ static int threadSerial(void *conf)
                 if ((hdm=atof(getf(8, buffer))) != 0)  {   // Track made good
                     cnmea.hdm=hdm;
                     cnmea.hdm_ts = ct;
+                    cnmea.cog = hdm;
+                    cnmea.cog_ts = ct;
                 }
             }
             strcpy(cnmea.gll, getf(3, buffer));
@@ -515,8 +636,11 @@ static int threadSerial(void *conf)
                 strcpy(cnmea.date, getf(9, buffer));
                 cnmea.rmc_tm_set = 1;
             }
-            if(strlen(cnmea.gll))
+            if(strlen(cnmea.gll)) {
                 cnmea.gll_ts = ct;
+                trackFix(ct, BUS_SRC_GPS);
+            }
+            publish(BUS_MASK(HIST_SOG) | (cnmea.hdm_ts == ct? BUS_MASK(HIST_HDM) : 0), BUS_SRC_GPS, ct);
             continue;
         }
 
@@ -528,6 +652,7 @@ static int threadSerial(void *conf)
                 strcpy(cnmea.glns, getf(2, buffer));
                 strcpy(cnmea.glne, getf(4, buffer));
                 cnmea.gll_ts = ct;
+                trackFix(ct, BUS_SRC_GPS);
                 continue;
             }
         }
@@ -540,8 +665,11 @@ static int threadSerial(void *conf)
                     if ((hdm=atof(getf(1, buffer))) != 0) { // Track made good
                         cnmea.hdm=hdm;
                         cnmea.hdm_ts = ct;
+                        cnmea.cog = hdm;
+                        cnmea.cog_ts = ct;
                     }
                 }
+                publish(BUS_MASK(HIST_SOG) | (cnmea.hdm_ts == ct? BUS_MASK(HIST_HDM) : 0), BUS_SRC_GPS, ct);
                 continue;
             }
         }
@@ -551,12 +679,14 @@ static int threadSerial(void *conf)
             if (NMPARSE(buffer, "HDG")) {
                 cnmea.hdm=atof(getf(1, buffer));
                 cnmea.hdm_ts = ct;
+                publish(BUS_MASK(HIST_HDM), BUS_SRC_GPS, ct);
                 continue;
             }
             // HDT - Heading - True (obsoleted)
             if (NMPARSE(buffer, "HDT")) {
                 cnmea.hdm=atof(getf(1, buffer));
                 cnmea.hdm_ts = ct;
+                publish(BUS_MASK(HIST_HDM), BUS_SRC_GPS, ct);
                 continue;
             }
 
@@ -564,6 +694,7 @@ static int threadSerial(void *conf)
             if (NMPARSE(buffer, "HDM")) {
                 cnmea.hdm=atof(getf(1, buffer));
                 cnmea.hdm_ts = ct;
+                publish(BUS_MASK(HIST_HDM), BUS_SRC_GPS, ct);
                 continue;
             }
         }
@@ -573,8 +704,6 @@ static int threadSerial(void *conf)
 
     SDL_Log("threadSerial stopped");
 
-    configParams->numThreads--;
-
     return 0;
 }
 
@@ -604,19 +733,23 @@ static int i2cCollector(void *conf)
 
     SDL_Log("Starting up i2c collector");
 
-    configParams->numThreads++;
-
     while(configParams->runi2c)
     {
         time_t ct;
         float hdm;
 
-        SDL_Delay(dt);
+        if (thrdSleep(govI2cDelay(dt)))
+            break;
+
+        TRCE_SCOPE("i2cSample");
 
         if (configParams->conn && connOk) {
             if (update++ > dt / 10) {
+                TRCE_SCOPE("i2cCalibration");
+                if (__atomic_exchange_n(&calibReload, 0, __ATOMIC_RELAXED))
+                    doUpdate = 1;
                 if (!stat(SQLCONFIG, &sb)) {
-                    SDL_Delay(600);
+                    thrdSleep(600);
                     char sqlbuf[150];
                     memset(sqlbuf, 0, sizeof(sqlbuf));
                     SDL_Log("Got new calibration:");
@@ -685,121 +818,103 @@ static int i2cCollector(void *conf)
 
         cnmea.roll_i2cts = ct;
         cnmea.roll = i2cReadRoll(configParams->i2cFile, dt, &calib);
+        metrAdd(METR_I2C_SAMPLES, 1);
 
         // Take over if no NMEA
         if (ct - cnmea.hdm_ts > S_TIMEOUT) {
             cnmea.hdm = hdm;
             cnmea.hdm_i2cts = ct;
         }
-    }
-
 
-    if (configParams->conn) {
-        rval = SQLITE_BUSY;
-        while(rval == SQLITE_BUSY) { // make sure ! busy ! db locked 
-            rval = SQLITE_OK;
-            sqlite3_stmt * res = sqlite3_next_stmt(configParams->conn, NULL);
-            if (res != NULL) {
-                rval = sqlite3_finalize(res);
-                if (rval == SQLITE_OK) {
-                    rval = sqlite3_close(configParams->conn);
-                }
-            }
-        }
-        (void)sqlite3_close(configParams->conn);
+        publish(BUS_MASK(HIST_ROLL) | (cnmea.hdm_i2cts == ct? BUS_MASK(HIST_HDM) : 0), BUS_SRC_I2C, ct);
     }
 
     close(configParams->i2cFile);
     configParams->i2cFile = 0;
-    configParams->conn = NULL;
 
     SDL_Log("i2cCollector stopped");
 
-    configParams->numThreads--;
-
     return 0;
 }
 
+// Connect to the NMEA server without blocking a stop request. Returns the socket or -1.
+static int netConnect(struct addrinfo *ai)
+{
+    int sock, err = 0;
+    socklen_t len = sizeof(err);
+
+    if ((sock = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0)
+        return -1;
+
+    if (connect(sock, ai->ai_addr, ai->ai_addrlen) == 0)
+        return sock;
+
+    if (errno == EINPROGRESS && thrdWait(sock, POLLOUT, 5000) > 0 &&
+            getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0)
+        return sock;
+
+    errno = err? err : ETIMEDOUT;
+    close(sock);
+
+    return -1;
+}
+
 // Optionally collect data fron NMEA network server
 static int nmeaNetCollector(void* conf)
 {
     configuration *configParams = conf;
-    int hostResolved = 0;
-    IPaddress serverIP;                     // The IP we will connect to
-    TCPsocket clientSocket = NULL;          // The socket to use
-    SDLNet_SocketSet socketSet = NULL;
+    struct addrinfo hints, *serverIP = NULL;    // The IP we will connect to
+    int clientSocket = -1;                      // The socket to use
+    char port[12];
+    char host[INET6_ADDRSTRLEN];
 
     SDL_Log("Starting up NMEA net collector");
 
     cnmea.net_ts = time(NULL);
 
     configParams->netStat = 0;
-  
-     // Initialise SDL_net
-    if (SDLNet_Init() < 0) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Cannot  Initialise SDL_net!");
-        return 0;
-    }
 
-    if ((hostResolved = SDLNet_ResolveHost(&serverIP, configParams->server, configParams->port)) < 0) {
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    sprintf(port, "%d", configParams->port);
+
+    if (getaddrinfo(configParams->server, port, &hints, &serverIP) || serverIP == NULL) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to resolve the NMEA TCP Server @ %s:%d!", configParams->server, configParams->port);
         return 0;
     }
-    Uint8 * dotQuad = (Uint8*)&serverIP.host;
-    SDL_Log("Successfully resolved host %s to IP: %d.%d.%d.%d : port %d\n",configParams->server, dotQuad[0],dotQuad[1],dotQuad[2],dotQuad[3], configParams->port);
-
-    int sretry = 0;
-
-    configParams->numThreads++;
+    (void)getnameinfo(serverIP->ai_addr, serverIP->ai_addrlen, host, sizeof(host), NULL, 0, NI_NUMERICHOST);
+    SDL_Log("Successfully resolved host %s to IP: %s : port %d\n",configParams->server, host, configParams->port);
 
-    while(1)
+    while(configParams->runNet)
     {
         int retry = 0;
         int rretry = 0;
-        int activeSockets;
 
         // Join a socket server whenever found.
-        while (!(clientSocket = SDLNet_TCP_Open(&serverIP))) {
-            if (retry ++ < 3) {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Try to open socket to server %s %s!", configParams->server, SDLNet_GetError());
-            } else if (retry == 4) {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Supressing message 'Try to open socket to ...' for now");
-            }
-            if (!configParams->runNet)
+        while ((clientSocket = netConnect(serverIP)) < 0) {
+            LOGG_LIMIT(LOGG_PERIOD, SDL_LOG_PRIORITY_ERROR, "Try to open socket to server %s %s!", configParams->server, strerror(errno));
+            if (!configParams->runNet || thrdSleep(10000))
                 break;
-            SDL_Delay(10000);
-        }
-
-        // Create the socket set with enough space to store our desired number of connections (i.e. sockets)
-        socketSet = SDLNet_AllocSocketSet(1);
-        if (socketSet == NULL) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate the socket set!");
-            break;
         }
 
-        if (!configParams->runNet)
+        if (clientSocket < 0 || !configParams->runNet)
             break;
 
-        // Add our socket to the socket set for polling
-        SDLNet_TCP_AddSocket(socketSet, clientSocket);
-        activeSockets = SDLNet_CheckSockets(socketSet, 5000);
-
-        if (activeSockets <1) {
-            SDLNet_TCP_DelSocket(socketSet, clientSocket);
-            SDLNet_TCP_Close(clientSocket);
-            SDLNet_FreeSocketSet(socketSet);
-            if (sretry ++ < 3) {
-                SDL_Log("There is no socket with data at the moment");
-            } else if (sretry == 4) {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Supressing message 'There is no socket ...' for now");
-            } 
-            SDL_Delay(5000);
+        if (thrdWait(clientSocket, POLLIN, 5000) <= 0) {
+            close(clientSocket);
+            clientSocket = -1;
+            if (!configParams->runNet)
+                break;
+            LOGG_LIMIT(LOGG_PERIOD, SDL_LOG_PRIORITY_INFO, "There is no socket with data at the moment");
+            thrdSleep(5000);
             continue;
         }
 
-        SDL_Log("There are %d socket(s) with data at the moment", activeSockets);
+        SDL_Log("Server %s has data at the moment", configParams->server);
+        metrAdd(METR_RECONNECT, 1);
 
-        retry = sretry = rretry = 0;
+        retry = rretry = 0;
 
         // Now start collect data
         while (configParams->runNet)
@@ -816,7 +931,7 @@ static int nmeaNetCollector(void* conf)
             ts = time(NULL);        // Get a timestamp for this turn
 
             // Check if we got an NMEA response from the server
-            if (SDLNet_CheckSockets(socketSet, 3000) > 0)
+            if (*nmeastr_p2 || (cnt = thrdWait(clientSocket, POLLIN, 3000)) > 0)
             {
                 memset(nmeastr_p1, 0, sizeof(nmeastr_p1));
 
@@ -824,16 +939,17 @@ static int nmeaNetCollector(void* conf)
                     memcpy(nmeastr_p1, nmeastr_p2, sizeof(nmeastr_p1));
                     memset(nmeastr_p2, 0, sizeof(nmeastr_p2));
                 } else {
-                    if ((cnt = SDLNet_TCP_Recv(clientSocket, nmeastr_p1, sizeof(nmeastr_p1))) <= 0) {
-                        SDL_Delay(30);
+                    if ((cnt = recv(clientSocket, nmeastr_p1, sizeof(nmeastr_p1)-1, 0)) <= 0) {
+                        thrdSleep(30);
                         continue;
                     }
                 }
 
+                TRCE_SCOPE("nmeaNet");
                 retry = 0;
                 configParams->netStat = 1;
 
-                if (nmeaChecksum(nmeastr_p1, nmeastr_p2, cnt)) continue;
+                if (nmeaChecksum(BUS_SRC_NET, nmeastr_p1, nmeastr_p2, cnt)) continue;
 
                 // RMC - Recommended minimum specific GPS/Transit data
                 if (NMPARSE(nmeastr_p1, "RMC")) {
@@ -843,6 +959,8 @@ static int nmeaNetCollector(void* conf)
                         if ((hdm=atof(getf(8, nmeastr_p1))) != 0)  {   // Track made good
                             cnmea.hdm=hdm;
                             cnmea.hdm_ts = ts;
+                            cnmea.cog = hdm;
+                            cnmea.cog_ts = ts;
                         }
                     }
                     strcpy(cnmea.gll, getf(3, nmeastr_p1));
@@ -855,6 +973,8 @@ static int nmeaNetCollector(void* conf)
                         cnmea.rmc_tm_set = 1;
                     }
                     cnmea.net_ts = cnmea.gll_ts = ts;
+                    trackFix(ts, BUS_SRC_NET);
+                    publish(BUS_MASK(HIST_SOG) | (cnmea.hdm_ts == ts? BUS_MASK(HIST_HDM) : 0), BUS_SRC_NET, ts);
                     continue;
                 }
 
@@ -866,6 +986,7 @@ static int nmeaNetCollector(void* conf)
                         strcpy(cnmea.glns, getf(2, nmeastr_p1));
                         strcpy(cnmea.glne, getf(4, nmeastr_p1));
                         cnmea.net_ts = cnmea.gll_ts = ts;
+                        trackFix(ts, BUS_SRC_NET);
                         continue;
                     }
                 }
@@ -878,8 +999,11 @@ static int nmeaNetCollector(void* conf)
                             if ((hdm=atof(getf(1, nmeastr_p1))) != 0) { // Track made good
                                 cnmea.hdm=hdm;
                                 cnmea.hdm_ts = ts;
+                                cnmea.cog = hdm;
+                                cnmea.cog_ts = ts;
                             }
                         }
+                        publish(BUS_MASK(HIST_SOG) | (cnmea.hdm_ts == ts? BUS_MASK(HIST_HDM) : 0), BUS_SRC_NET, ts);
                         continue;
                     }
                 }
@@ -890,12 +1014,14 @@ static int nmeaNetCollector(void* conf)
                         cnmea.hdm=atof(getf(1, nmeastr_p1));
                         cnmea.hdm += atof(getf(4, nmeastr_p1));
                         cnmea.hdm_ts = ts;
+                        publish(BUS_MASK(HIST_HDM), BUS_SRC_NET, ts);
                         continue;
                     }
                     // HDT - Heading - True (obsoleted)
                     if (NMPARSE(nmeastr_p1, "HDT")) {
                         cnmea.hdm=atof(getf(1, nmeastr_p1));
                         cnmea.hdm_ts = ts;
+                        publish(BUS_MASK(HIST_HDM), BUS_SRC_NET, ts);
                         continue;
                     }
 
@@ -903,6 +1029,7 @@ static int nmeaNetCollector(void* conf)
                     if (NMPARSE(nmeastr_p1, "HDM")) {
                         cnmea.hdm=atof(getf(1, nmeastr_p1));
                         cnmea.hdm_ts = ts;
+                        publish(BUS_MASK(HIST_HDM), BUS_SRC_NET, ts);
                         continue;
                     }
                 }
@@ -911,6 +1038,7 @@ static int nmeaNetCollector(void* conf)
                 if(NMPARSE(nmeastr_p1, "VHW")) {
                     if ((cnmea.stw=atof(getf(5, nmeastr_p1))) != 0)
                         cnmea.stw_ts = ts;
+                    publish(BUS_MASK(HIST_STW), BUS_SRC_NET, ts);
                     continue;
                 }
 
@@ -918,6 +1046,7 @@ static int nmeaNetCollector(void* conf)
                 if (NMPARSE(nmeastr_p1, "DPT")) {
                     cnmea.dbt=atof(getf(1, nmeastr_p1))+atof(getf(2, nmeastr_p1));
                     cnmea.dbt_ts = ts;
+                    publish(BUS_MASK(HIST_DBT), BUS_SRC_NET, ts);
                     continue;
                 }
 
@@ -926,6 +1055,7 @@ static int nmeaNetCollector(void* conf)
                     if (NMPARSE(nmeastr_p1, "DBT")) {
                         cnmea.dbt=atof(getf(3, nmeastr_p1));
                         cnmea.dbt_ts = ts;
+                        publish(BUS_MASK(HIST_DBT), BUS_SRC_NET, ts);
                         continue;
                     }
                 }
@@ -934,6 +1064,7 @@ static int nmeaNetCollector(void* conf)
                 if (NMPARSE(nmeastr_p1, "MTW")) {
                     cnmea.mtw=atof(getf(1, nmeastr_p1));
                     cnmea.mtw_ts = ts;
+                    publish(BUS_MASK(HIST_MTW), BUS_SRC_NET, ts);
                     continue;
                 }
 
@@ -957,6 +1088,7 @@ static int nmeaNetCollector(void* conf)
                             cnmea.vwts=trueWindSpeed(cnmea.stw, cnmea.vwrs, cnmea.vwra);
                             cnmea.vwt_ts = ts;
                     }
+                    publish(BUS_MASK(HIST_AWA) | BUS_MASK(HIST_AWS) | (cnmea.vwt_ts == ts? BUS_MASK(HIST_TWA) | BUS_MASK(HIST_TWS) : 0), BUS_SRC_NET, ts);
                     continue;
                 }
 
@@ -972,6 +1104,7 @@ static int nmeaNetCollector(void* conf)
                             cnmea.vwts=trueWindSpeed(cnmea.stw, cnmea.vwrs, cnmea.vwra);
                             cnmea.vwt_ts = ts;
                         }
+                        publish(BUS_MASK(HIST_AWA) | BUS_MASK(HIST_AWS) | (cnmea.vwt_ts == ts? BUS_MASK(HIST_TWA) | BUS_MASK(HIST_TWS) : 0), BUS_SRC_NET, ts);
                         continue;
                     }
                 }
@@ -994,37 +1127,35 @@ static int nmeaNetCollector(void* conf)
                     cnmea.kWhp=         atof(getf(7, nmeastr_p1));
                     cnmea.kWhn=         atof(getf(8, nmeastr_p1));
                     cnmea.startTime=    atol(getf(9, nmeastr_p1));
+                    publish(BUS_MASK(HIST_VOLT) | BUS_MASK(HIST_CURR) | BUS_MASK(HIST_TEMP) | BUS_MASK(HIST_POWER), BUS_SRC_NET, ts);
                     continue;
                 }
 
             } else {
                 configParams->netStat = 0;
-                if (rretry++ > 10)
+                if (cnt < 0 || rretry++ > 10)
                     break;
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Retry to read socket from server %s %s!", configParams->server, SDLNet_GetError());
-                SDL_Delay(1000);
+                LOGG_LIMIT(LOGG_PERIOD, SDL_LOG_PRIORITY_ERROR, "Retry to read socket from server %s!", configParams->server);
+                thrdSleep(1000);
             }
         }
         // Server possibly gone, try to redo all this
-        SDLNet_TCP_DelSocket(socketSet, clientSocket);
-        SDLNet_TCP_Close(clientSocket);
-        SDLNet_FreeSocketSet(socketSet);
+        close(clientSocket);
+        clientSocket = -1;
         configParams->netStat = 0;
 
         if (configParams->runNet != 0)
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Server %s possibly gone, awaiting its return", configParams->server);
     }
 
-    if (clientSocket && socketSet) {
-        SDLNet_TCP_DelSocket(socketSet, clientSocket);
-        SDLNet_TCP_Close(clientSocket);
-        SDLNet_FreeSocketSet(socketSet);
-    }
+    if (clientSocket >= 0)
+        close(clientSocket);
+
+    freeaddrinfo(serverIP);
 
     configParams->netStat = 0;
 
     SDL_Log("nmeaNetCollector stopped");
-    configParams->numThreads--;
 
     return 0;
 }
@@ -1065,13 +1196,30 @@ static void vncClientTouch(int buttonMask, int x, int y, rfbClientPtr cl)
     }    
 }
 
+static uint64_t vncGoneBytes;   // Sent to clients that are gone
+
 // RFB client gone
 static void vncClientGone(rfbClientPtr cl)
 {
     sdl2_app *sdlApp = cl->screen->screenData;
+    vncGoneBytes += rfbStatGetSentBytes(cl);
     sdlApp->conf->vncClients--; 
 }
 
+// Bytes sent to all clients so far, for the metrics
+static void vncCount(rfbScreenInfoPtr server)
+{
+    rfbClientIteratorPtr iter = rfbGetClientIterator(server);
+    uint64_t bytes = vncGoneBytes;
+    rfbClientPtr cl;
+
+    while ((cl = rfbClientIteratorNext(iter)) != NULL)
+        bytes += rfbStatGetSentBytes(cl);
+
+    rfbReleaseClientIterator(iter);
+    metrSet(METR_VNC_BYTES, bytes);
+}
+
 // New RFB Client
 static enum rfbNewClientAction vncNewclient(rfbClientPtr cl)
 {
@@ -1099,10 +1247,13 @@ static int threadVnc(void *conf)
     rfbInitServer(sdlApp->conf->vncServer);           
 
     // Loop, processing clients
-    while (rfbIsActive(sdlApp->conf->vncServer))
+    while (vncRun && rfbIsActive(sdlApp->conf->vncServer))
     {
+        TRCE_SCOPE("rfbProcessEvents");
         usec = sdlApp->conf->vncServer->deferUpdateTime*1000;
         rfbProcessEvents(sdlApp->conf->vncServer, usec);
+        if (sdlApp->conf->vncClients)
+            vncCount(sdlApp->conf->vncServer);
     }
 
     SDL_Log("RFB serivice stopped");
@@ -1132,6 +1283,7 @@ inline static void get_text_and_rect(SDL_Renderer *renderer, int x, int y, int l
         case BLACK: textColor.r = textColor.g = textColor.b = 0; break;
         case WHITE: textColor.r = textColor.g = textColor.b = 255; break;
         case RED:   textColor.r = 255; textColor.g = textColor.b = 0; break;
+        case GREY:  textColor.r = textColor.g = textColor.b = 128; break;
     }
 
     surface = TTF_RenderText_Solid(font, text, textColor);
@@ -1152,6 +1304,106 @@ inline static void get_text_and_rect(SDL_Renderer *renderer, int x, int y, int l
     rect->h = text_height;
 }
 
+// As get_text_and_rect() for a value of the channels in chans, greyed out
+// while any of them shows the last known state
+inline static void get_value_and_rect(SDL_Renderer *renderer, int x, int y, int l, char *text,
+        TTF_Font *font, SDL_Texture **texture, SDL_Rect *rect, int color, uint32_t chans)
+{
+    if ((staleMask & chans) && color != RED)
+        color = GREY;
+
+    get_text_and_rect(renderer, x, y, l, text, font, texture, rect, color);
+}
+
+// Selectable time spans for the depth and power plots
+static const struct {
+    int     span;       // Seconds
+    int     unit;       // Seconds per x-axis unit
+    float   scale;      // X-axis grid
+    char    *caption;
+} plotSpans[] = {
+    { 25,       1,      1,  "Time (s)"   },
+    { 600,      60,     1,  "Time (min)" },
+    { 3600,     60,     5,  "Time (min)" },
+    { 6*3600,   3600,   1,  "Time (h)"   },
+    { 24*3600,  3600,   2,  "Time (h)"   },
+    { 7*86400,  86400,  1,  "Time (d)"   },
+    { 30*86400, 86400,  5,  "Time (d)"   }
+};
+
+// Populate a plot with the min/max envelope of a channel over the current span.
+// Returns the largest absolute value plotted.
+static float plotHistory(sdl2_app *sdlApp, plotParams *plot, int chan, time_t ct)
+{
+    static histStat buckets[PLOT_POINTS];
+    static histStat older[PLOT_POINTS];
+    int span = plotSpans[sdlApp->plotSpan].span;
+    int unit = plotSpans[sdlApp->plotSpan].unit;
+    int n = span < plot->maxpoints? span : plot->maxpoints;
+    // Only an archive older than the history store has anything to fill in
+    int fill = ct-span+1 < histFirst() && archFirst() != 0 && archFirst() < histFirst();
+    float step, peak = 0;
+
+    if (n > PLOT_POINTS) n = PLOT_POINTS;
+
+    // Hourly buckets when the archive has to fill in, the coarsest the store has itself
+    if (fill && span >= 3600 && n > span/3600)
+        n = span/3600;
+
+    if (n < 1) n = 1;
+
+    plot->max_x = span / unit;
+    plot->scale_x = plotSpans[sdlApp->plotSpan].scale;
+    plot->caption_x = plotSpans[sdlApp->plotSpan].caption;
+
+    plotClear(plot);
+
+    (void)histQuery(chan, ct-span+1, ct+1, n, buckets);
+
+    // Whatever has left the history store is read from the archive
+    if (fill && archQuery(chan, ct-span+1, ct+1, n, older)) {
+        for (int i = 0; i < n; i++) {
+            if (buckets[i].count == 0)
+                buckets[i] = older[i];
+        }
+    }
+
+    step = (float)span/n;
+
+    // Newest to the left
+    for (int i = n-1; i >= 0; i--)
+    {
+        float x = (n-1-i)*step/unit;
+        float lo = fabsf(buckets[i].min);
+        float hi = fabsf(buckets[i].max);
+
+        if (buckets[i].min < 0 && buckets[i].max > 0) {
+            hi = lo > hi? lo : hi;
+            lo = 0;
+        } else if (lo > hi) {
+            float t = lo; lo = hi; hi = t;
+        }
+
+        plotAdd(plot, x, fabsf(buckets[i].mean), lo, hi);
+
+        if (hi > peak) peak = hi;
+    }
+
+    return peak;
+}
+
+// New data on these channels wakes up the page loop, 0 = none
+static void pageWatch(sdl2_app *sdlApp, uint32_t mask)
+{
+    busMsg msg;
+
+    // Stay at one frame a second when idle
+    busWatch(sdlApp->bus, govIdle() == GOV_ACTIVE? mask : 0);
+
+    while (busPoll(sdlApp->bus, &msg))
+        ;
+}
+
 static int pageSelect(sdl2_app *sdlApp, SDL_Event *event)
 {
     // A simple event handler for touch screen buttons at fixed menu bar localtions
@@ -1160,6 +1412,14 @@ static int pageSelect(sdl2_app *sdlApp, SDL_Event *event)
 
     static time_t c;
 
+    govTouch();
+
+    // Three fingers down dumps the trace
+    if (event->type == SDL_FINGERDOWN && SDL_GetNumTouchFingers(event->tfinger.touchId) >= 3) {
+        trceRequest();
+        return 0;
+    }
+
     if (!(time(NULL) > c+1))
         return 0;
 
@@ -1182,7 +1442,27 @@ static int pageSelect(sdl2_app *sdlApp, SDL_Event *event)
 
     if (sdlApp->conf->runWrn && y > 15  && y < 50 &&  x > 65 && x < 100)
     {
-            sdlApp->conf->muted = !sdlApp->conf->muted;
+            // Acknowledge the alarms, or else toggle mute
+            if (sdlApp->conf->muted == 0 && alrmUnacked()) {
+                alrmAck();
+                sndStop();
+            } else
+                sndMute(sdlApp->conf->muted = !sdlApp->conf->muted);
+            return 0;
+    }
+
+    // Tap on a plot to cycle its time span
+    if ((sdlApp->curPage == DPTPAGE && sdlApp->plotMode && y > 40 && y < 390) ||
+            (sdlApp->curPage == PWRPAGE && sdlApp->conf->i2cFile == 0 && y > 190 && y < 390))
+    {
+            sdlApp->plotSpan = (sdlApp->plotSpan +1) % (sizeof(plotSpans)/sizeof(plotSpans[0]));
+            return 0;
+    }
+
+    // Tap on the track to zoom out, and in again from the widest
+    if (sdlApp->curPage == TRKPAGE && y > 50 && y < 390)
+    {
+            sdlApp->trackZoom = (sdlApp->trackZoom +1) % TRCK_ZOOMS;
             return 0;
     }
 
@@ -1208,7 +1488,7 @@ static int pageSelect(sdl2_app *sdlApp, SDL_Event *event)
         if (x > 605 && x < 652)
             return WNDPAGE;
         if (x > 662 && x < 708)
-           return GPSPAGE;
+           return sdlApp->curPage == GPSPAGE? TRKPAGE : GPSPAGE;
         if (x > 718 && x < 765) {
 #ifdef DIGIFLOW
         if (sdlApp->curPage == PWRPAGE)
@@ -1217,7 +1497,7 @@ static int pageSelect(sdl2_app *sdlApp, SDL_Event *event)
          return PWRPAGE;
 
         }
-        if (sdlApp->subAppsCmd[sdlApp->curPage][0] != NULL && event->user.code != 1 ) {
+        if (sdlApp->curPage < TSKPAGE && sdlApp->subAppsCmd[sdlApp->curPage][0] != NULL && event->user.code != 1 ) {
             if (x > 30 && x < 80)
                 return TSKPAGE;
         }
@@ -1232,6 +1512,14 @@ inline static void addMenuItems(sdl2_app *sdlApp, TTF_Font *font)
 
     static SDL_Rect M1_rect;
 
+    if (staleMask) {
+        char msg_stl[40];
+        time_t saved = lastSaved();
+        strftime(msg_stl, sizeof(msg_stl), "Last known values %H:%M", localtime(&saved));
+        get_text_and_rect(sdlApp->renderer, 440, 392, 0, msg_stl, font, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &M1_rect, GREY);
+        SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &M1_rect);
+    }
+
     get_text_and_rect(sdlApp->renderer, 440, 416, 0, "COG", font, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &M1_rect, BLACK);
     SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &M1_rect);
 
@@ -1244,7 +1532,7 @@ inline static void addMenuItems(sdl2_app *sdlApp, TTF_Font *font)
     get_text_and_rect(sdlApp->renderer, 610, 416, 0, "WND", font, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &M1_rect, BLACK);
     SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &M1_rect);
 
-    get_text_and_rect(sdlApp->renderer, 668, 416, 0, "GPS", font, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &M1_rect, BLACK);
+    get_text_and_rect(sdlApp->renderer, 668, 416, 0, sdlApp->curPage == GPSPAGE? "TRK" : "GPS", font, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &M1_rect, BLACK);
     SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &M1_rect);
     
     if (sdlApp->conf->i2cFile == 0) {
@@ -1387,80 +1675,327 @@ inline static void doRGBconv(sdl2_app *sdlApp)
     SDL_UnlockSurface(sdlApp->conf->vncPixelBuffer);
 }
 
-// Play audible warning message
-static void playWarnSound(char *wavFile)
+// Read the pixels from the current render target and save them onto the surface
+// This will slow down the application a bit.
+static void vncCapture(sdl2_app *sdlApp)
 {
+    TRCE_SCOPE("vncCapture");
+    Uint64 start = SDL_GetPerformanceCounter();
 
-    SDL_AudioSpec wavSpec;
-    Uint32 wavLength;
-    Uint8 *wavBuffer;
-    SDL_AudioDeviceID deviceId;
-    char soundPath[4096];
-    strcpy(soundPath, SOUND_PATH);
-    strncat(soundPath, wavFile, sizeof(soundPath)-1);
-
-    // load WAV file
-    if (SDL_LoadWAV(soundPath, &wavSpec, &wavBuffer, &wavLength) == NULL)
+    if (SDL_TryLockMutex(vncLock))
         return;
-    
-    // open audio device
-    if ((deviceId = SDL_OpenAudioDevice(NULL, 0, &wavSpec, NULL, 0)) == 0)
-        return;
-    
-    // play audio
-    if (SDL_QueueAudio(deviceId, wavBuffer, wavLength) == 0) {
-        SDL_PauseAudioDevice(deviceId, 0);
-        SDL_Delay(2200);
-    }
 
-    // Clean up
-    SDL_CloseAudioDevice(deviceId);
-    SDL_FreeWAV(wavBuffer);
+    SDL_RenderReadPixels(sdlApp->renderer, NULL, SDL_GetWindowPixelFormat(sdlApp->window),
+        sdlApp->conf->vncPixelBuffer->pixels, sdlApp->conf->vncPixelBuffer->pitch);
+    doRGBconv(sdlApp);
+    rfbMarkRectAsModified(sdlApp->conf->vncServer, 0, 0, sdlApp->conf->window_w, sdlApp->conf->window_h);
+
+    SDL_UnlockMutex(vncLock);
+
+    metrAdd(METR_VNC_USEC, (SDL_GetPerformanceCounter() - start)*1000000/SDL_GetPerformanceFrequency());
+    metrAdd(METR_VNC_FRAMES, 1);
 }
 
-// Check for warnings and play sound file periodically
+// Sound the alarms until they are acknowledged or cleared
 static int threadWarn(void *conf)
 {
     configuration *configParams = conf;
-    time_t ct;
+    alrmSound sounds[4];
+    int n;
 
-    SDL_Log("Sound Server started");
+    if (sndInit(SOUND_PATH))
+        return 0;
 
-    configParams->numThreads++;
+    SDL_Log("Sound Server started");
 
-    SDL_Init(SDL_INIT_AUDIO);
+    sndMute(configParams->muted);
 
     while(configParams->runWrn) {
 
-        if (configParams->muted == 1) {
-            SDL_Delay(1000);
+        if (configParams->muted == 0 && (n = alrmSounding(sounds, 4)) > 0) {
+            govWake();
+            for (int i = 0; i < n && i < 4; i++)
+                (void)sndPlay(sounds[i].sound, sounds[i].severity);
+        } else
+            sndIdle();
+
+        // Again after a pause, or at once when an alarm is raised
+        if (alrmWait(2000) < 0)
+            break;
+    }
+
+    sndClose();
+
+    SDL_Log("Sound Server stopped");
+
+    return 0;
+}
+
+// Where the collectors keep the time of a channel
+static time_t *cnmeaStamp(int chan, int src)
+{
+    switch (chan) {
+        case HIST_SOG:      return src == BUS_SRC_GPS? &cnmea.rmc_gps_ts : &cnmea.rmc_ts;
+        case HIST_STW:      return &cnmea.stw_ts;
+        case HIST_DBT:      return &cnmea.dbt_ts;
+        case HIST_MTW:      return &cnmea.mtw_ts;
+        case HIST_HDM:      return src == BUS_SRC_I2C? &cnmea.hdm_i2cts : &cnmea.hdm_ts;
+        case HIST_ROLL:     return &cnmea.roll_i2cts;
+        case HIST_AWA:
+        case HIST_AWS:      return &cnmea.vwr_ts;
+        case HIST_TWA:
+        case HIST_TWS:      return &cnmea.vwt_ts;
+        case HIST_VOLT:     return &cnmea.volt_ts;
+        case HIST_CURR:     return &cnmea.curr_ts;
+        case HIST_TEMP:     return &cnmea.temp_ts;
+        case BUS_POS:       return &cnmea.gll_ts;
+    }
+
+    return NULL;    // Derived
+}
+
+// Put the last known state back where the collectors would have put it
+static void lastRestore(time_t ct)
+{
+    busMsg msg;
+    double deg;
+
+    if (lastOpen(LASTPATH))
+        return;
+
+    for (int c = 0; c < BUS_NCHAN; c++) {
+        if (cnmeaStamp(c, 0) == NULL || !lastGet(c, &msg))
             continue;
+
+        switch (c) {
+            case HIST_SOG:  cnmea.rmc = msg.val; break;
+            case HIST_STW:  cnmea.stw = msg.val; break;
+            case HIST_DBT:  cnmea.dbt = msg.val; break;
+            case HIST_MTW:  cnmea.mtw = msg.val; break;
+            case HIST_HDM:  cnmea.hdm = msg.val; break;
+            case HIST_ROLL: cnmea.roll = msg.val; break;
+            case HIST_AWA:
+                cnmea.vwrd = msg.val > 180;
+                cnmea.vwra = cnmea.vwrd? 360 - msg.val : msg.val;
+                break;
+            case HIST_AWS:  cnmea.vwrs = msg.val; break;
+            case HIST_TWA:  cnmea.vwta = msg.val; break;
+            case HIST_TWS:  cnmea.vwts = msg.val; break;
+            case HIST_VOLT: cnmea.volt = msg.val; break;
+            case HIST_CURR: cnmea.curr = msg.val; break;
+            case HIST_TEMP: cnmea.temp = msg.val; break;
+            case BUS_POS:
+                // Back to ddmm.mmmm as in the sentences
+                deg = fabs(msg.val);
+                snprintf(cnmea.gll, sizeof(cnmea.gll), "%02d%07.4f", (int)deg, (deg - (int)deg) * 60);
+                strcpy(cnmea.glns, msg.val < 0? "S" : "N");
+                deg = fabs(msg.val2);
+                snprintf(cnmea.glo, sizeof(cnmea.glo), "%03d%07.4f", (int)deg, (deg - (int)deg) * 60);
+                strcpy(cnmea.glne, msg.val2 < 0? "W" : "E");
+                break;
         }
 
-        ct = time(NULL);    // Get a timestamp for this turn
+        *cnmeaStamp(c, msg.src) = ct - STALE_AGE;
+        staleSrc[c] = msg.src;
+        staleMask |= BUS_MASK(c);
+    }
 
-        if (!(ct - cnmea.dbt_ts > S_TIMEOUT) && cnmea.dbt <= warn.depthw) {
-            playWarnSound("shallow-water.wav");
-            SDL_Delay(3000);
-        }
+    if (staleMask) {
+        time_t saved = lastSaved();
+        staleSince = ct;
+        SDL_Log("Showing the last known values from %.24s until live data arrives", ctime(&saved));
+    }
+}
 
-        if (!(ct - cnmea.curr_ts > S_TIMEOUT) && cnmea.curr <= -warn.highcurrw && configParams->runWrn) { 
-            playWarnSound("current-high.wav");
-            SDL_Delay(2000);
-        }
+// Keep the restored channels on display until they are replaced or too old
+static void lastKeep(busSub *bus, time_t ct)
+{
+    busMsg msg;
+    uint32_t live = 0;
+
+    while (busPoll(bus, &msg)) {
+        lastUpdate(&msg);
+        live |= BUS_MASK(msg.chan);
+    }
+
+    if (staleMask == 0)
+        return;
+
+    if (ct - staleSince > LAST_HOLD) {
+        SDL_Log("Last known values dropped, no live data for them in %d seconds", LAST_HOLD);
+        live = staleMask;
+    }
+
+    // Wind angle and speed come together, as does the position
+    if (live & BUS_MASK(HIST_AWA)) live |= BUS_MASK(HIST_AWS);
+    if (live & BUS_MASK(HIST_AWS)) live |= BUS_MASK(HIST_AWA);
+    if (live & BUS_MASK(HIST_TWA)) live |= BUS_MASK(HIST_TWS);
+    if (live & BUS_MASK(HIST_TWS)) live |= BUS_MASK(HIST_TWA);
+
+    staleMask &= ~live;
+
+    for (int c = 0; c < BUS_NCHAN; c++) {
+        if (staleMask & BUS_MASK(c))
+            *cnmeaStamp(c, staleSrc[c]) = ct - STALE_AGE;
+    }
+}
+
+// Collect one history row from current data (NAN = no valid data)
+static void historyRow(float *row, time_t ct)
+{
+    #define HVAL(ts, val) (!(ct - (ts) > S_TIMEOUT)? (float)(val) : NAN)
+
+    row[HIST_SOG]   = HVAL(cnmea.rmc_ts > cnmea.rmc_gps_ts? cnmea.rmc_ts : cnmea.rmc_gps_ts, cnmeaValue(HIST_SOG));
+    row[HIST_STW]   = HVAL(cnmea.stw_ts, cnmeaValue(HIST_STW));
+    row[HIST_DBT]   = cnmea.dbt == 0? NAN : HVAL(cnmea.dbt_ts, cnmeaValue(HIST_DBT));
+    row[HIST_MTW]   = HVAL(cnmea.mtw_ts, cnmeaValue(HIST_MTW));
+    row[HIST_HDM]   = HVAL(cnmea.hdm_ts > cnmea.hdm_i2cts? cnmea.hdm_ts : cnmea.hdm_i2cts, cnmeaValue(HIST_HDM));
+    row[HIST_ROLL]  = HVAL(cnmea.roll_i2cts, cnmeaValue(HIST_ROLL));
+    row[HIST_AWA]   = HVAL(cnmea.vwr_ts, cnmeaValue(HIST_AWA));
+    row[HIST_AWS]   = HVAL(cnmea.vwr_ts, cnmeaValue(HIST_AWS));
+    row[HIST_TWA]   = HVAL(cnmea.vwt_ts, cnmeaValue(HIST_TWA));
+    row[HIST_TWS]   = HVAL(cnmea.vwt_ts, cnmeaValue(HIST_TWS));
+    row[HIST_VOLT]  = HVAL(cnmea.volt_ts, cnmeaValue(HIST_VOLT));
+    row[HIST_CURR]  = HVAL(cnmea.curr_ts, cnmeaValue(HIST_CURR));
+    row[HIST_TEMP]  = HVAL(cnmea.temp_ts, cnmeaValue(HIST_TEMP));
+    row[HIST_POWER] = HVAL(cnmea.volt_ts > cnmea.curr_ts? cnmea.curr_ts : cnmea.volt_ts, cnmeaValue(HIST_POWER));
+
+    // The last known state is for display only
+    for (int c = 0; c < HIST_NCHAN; c++) {
+        if (staleMask & BUS_MASK(c))
+            row[c] = NAN;
+    }
+    if (staleMask & (BUS_MASK(HIST_VOLT) | BUS_MASK(HIST_CURR)))
+        row[HIST_POWER] = NAN;
+
+    #undef HVAL
+}
+
+// Queue a periodic logbook row from the current history row
+static void logbookRow(const float *row, time_t ct)
+{
+    logbEntry entry;
+    int posOk = !(ct - cnmea.gll_ts > S_TIMEOUT) && !(staleMask & BUS_MASK(BUS_POS));
+
+    memset(&entry, 0, sizeof(entry));
+    entry.ts = ct;
+    entry.kind = LOGB_ROW;
+    entry.lat = entry.lon = NAN;
+
+    if (posOk) {
+        entry.lat = dms2dd(atof(cnmea.gll),"m") * (cnmea.glns[0] == 'S'? -1 : 1);
+        entry.lon = dms2dd(atof(cnmea.glo),"m") * (cnmea.glne[0] == 'W'? -1 : 1);
+    }
 
-        if (!(ct - cnmea.volt_ts > S_TIMEOUT) && cnmea.volt <= warn.lowvoltw && configParams->runWrn) { 
-            playWarnSound("low-voltage.wav");
-            SDL_Delay(2000);
+    // Track made good, not the heading
+    entry.cog   = posOk && !(ct - cnmea.cog_ts > S_TIMEOUT)? cnmea.cog : NAN;
+    entry.sog   = row[HIST_SOG];
+    entry.stw   = row[HIST_STW];
+    entry.dbt   = row[HIST_DBT];
+    entry.awa   = row[HIST_AWA];
+    entry.aws   = row[HIST_AWS];
+    entry.volt  = row[HIST_VOLT];
+    entry.curr  = row[HIST_CURR];
+
+    logbPut(&entry);
+}
+
+// Log data source changes as they happen
+static void logbookEvents(configuration *configParams, const float *row, time_t ct)
+{
+    static int netStat = -1, hdmSrc = -1, posOk = -1;
+    int state;
+
+    if (configParams->netStat != netStat) {
+        if (netStat != -1 || configParams->netStat) {
+            char server[sizeof(configParams->server)];
+            SDL_LockMutex(configLock);
+            strcpy(server, configParams->server);
+            SDL_UnlockMutex(configLock);
+            logbEvent(configParams->netStat? "NMEA server %s connected" : "NMEA server %s lost", server);
         }
+        netStat = configParams->netStat;
+    }
 
-        if (configParams->runWrn) SDL_Delay(2000);
+    state = staleMask & BUS_MASK(HIST_HDM)? 0 : !(ct - cnmea.hdm_i2cts > S_TIMEOUT)? 1 : !(ct - cnmea.hdm_ts > S_TIMEOUT)? 2 : 0;
+    if (state != hdmSrc) {
+        if (hdmSrc != -1 || state)
+            logbEvent("Heading source: %s", state == 1? "Compass" : state == 2? "NMEA" : "None");
+        hdmSrc = state;
+    }
 
+    state = !(ct - cnmea.gll_ts > S_TIMEOUT) && !(staleMask & BUS_MASK(BUS_POS));
+    if (state != posOk) {
+        if (posOk != -1 || state)
+            logbEvent(state? "Position acquired" : "Position lost");
+        posOk = state;
     }
+}
 
-    SDL_Log("Sound Server stopped");
+// At anchor or in port and no alarms, the power governor may go idle
+static int vesselCalm(const float *row)
+{
+    statValue st;
+
+    if (alrmActive())
+        return 0;
+
+    if (statGet(HIST_SOG, STAT_10MIN, &st) && st.max > CALM_SOG)
+        return 0;
 
-    configParams->numThreads--;
+    if (statGet(HIST_HDM, STAT_10MIN, &st) && st.stddev > CALM_HDM)
+        return 0;
+
+    if (statGet(HIST_DBT, STAT_10MIN, &st) && st.max - st.min > CALM_DBT)
+        return 0;
+
+    return 1;
+}
+
+// Sample all channels into the history store at 1 Hz
+static int threadHistory(void *conf)
+{
+    configuration *configParams = conf;
+    float row[HIST_NCHAN];
+    busSub *bus = busSubscribe(BUS_MASK(BUS_NCHAN)-1, 0);
+    int rolling = 0;
+
+    SDL_Log("Starting up history sampler");
+
+    while(configParams->runHst)
+    {
+        struct timeval tv;
+        time_t ct;
+
+        // Sample at the start of each second
+        gettimeofday(&tv, NULL);
+        if (thrdSleep(1000 - tv.tv_usec/1000))
+            break;
+
+        ct = time(NULL);
+        lastKeep(bus, ct);
+        historyRow(row, ct);
+        histAppend(ct, row);
+        statAdd(ct, row);
+        govUpdate(ct, vesselCalm(row));
+
+        // Roll completed hours into the archive, a backlog one hour a second
+        if (rolling || ct % 60 == 30)
+            rolling = archRoll(ct) > 0;
+
+        if (ct % LAST_PERIOD == 0)
+            (void)lastSave();
+
+        if (configParams->runLgb) {
+            logbookEvents(configParams, row, ct);
+            if (ct % LOGB_PERIOD == 0)
+                logbookRow(row, ct);
+        }
+    }
+
+    busUnsubscribe(bus);
+
+    SDL_Log("History sampler stopped");
 
     return 0;
 }
@@ -1470,22 +2005,22 @@ static int doCompass(sdl2_app *sdlApp)
 {
     SDL_Event event;
     SDL_Rect compassR, outerRingR, clinoMeterR, windDirR, menuBarR, subTaskbarR, netStatbarR, noNetStatbarR, mutebarR, unmutebarR, calbarR, textBoxR;
-    TTF_Font* fontCog = TTF_OpenFont(sdlApp->fontPath, 42);
-    TTF_Font* fontRoll = TTF_OpenFont(sdlApp->fontPath, 22);
-    TTF_Font* fontSrc = TTF_OpenFont(sdlApp->fontPath, 14);
-    TTF_Font* fontTod = TTF_OpenFont(sdlApp->fontPath, 12);
-
-    SDL_Texture* compassRose = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "compassRose.png");
-    SDL_Texture* outerRing = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "outerRing.png");
-    SDL_Texture* clinoMeter = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "clinometer.png");
-    SDL_Texture* windDir = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "windDir.png");
-    SDL_Texture* menuBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "menuBar.png");
-    SDL_Texture* netStatBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "netStat.png");
-    SDL_Texture* noNetStatbar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "noNetStat.png");
-    SDL_Texture* muteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "mute.png");
-    SDL_Texture* calBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "cal.png");
-    SDL_Texture* unmuteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "unmute.png");
-    SDL_Texture* textBox = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "textBox.png");
+    TTF_Font* fontCog = asetFont(sdlApp->fontPath, 42);
+    TTF_Font* fontRoll = asetFont(sdlApp->fontPath, 22);
+    TTF_Font* fontSrc = asetFont(sdlApp->fontPath, 14);
+    TTF_Font* fontTod = asetFont(sdlApp->fontPath, 12);
+
+    SDL_Texture* compassRose = asetGet("compassRose.png");
+    SDL_Texture* outerRing = asetGet("outerRing.png");
+    SDL_Texture* clinoMeter = asetGet("clinometer.png");
+    SDL_Texture* windDir = asetGet("windDir.png");
+    SDL_Texture* menuBar = asetGet("menuBar.png");
+    SDL_Texture* netStatBar = asetGet("netStat.png");
+    SDL_Texture* noNetStatbar = asetGet("noNetStat.png");
+    SDL_Texture* muteBar = asetGet("mute.png");
+    SDL_Texture* calBar = asetGet("cal.png");
+    SDL_Texture* unmuteBar = asetGet("unmute.png");
+    SDL_Texture* textBox = asetGet("textBox.png");
 
     SDL_Texture* subTaskbar = NULL;
 
@@ -1551,11 +2086,11 @@ static int doCompass(sdl2_app *sdlApp)
 
     SDL_Rect textField_rect;
 
-    float t_angle = 0;
+    float t_angle = staleMask? remainderf(lastNeedle(LAST_COG), 360) : 0;
     float angle = 0;
     float t_angle_a = 0;
     float angle_a = 0;
-    float t_roll = 0;
+    float t_roll = staleMask? lastNeedle(LAST_ROLL) : 0;
     float roll = 0;
     int res = 1;
     int res_a = 1;
@@ -1643,11 +2178,13 @@ static int doCompass(sdl2_app *sdlApp)
         angle = rotate(roundf(cnmea.hdm), res); res=0;
 
         // Run needle and roll with smooth acceleration
-        if (angle > t_angle) t_angle += 0.8 * (fabsf(angle -t_angle) / 24);
-        else if (angle < t_angle) t_angle -= 0.8 * (fabsf(angle -t_angle) / 24);
+        if (angle > t_angle) t_angle += 0.8*govPace() * (fabsf(angle -t_angle) / 24);
+        else if (angle < t_angle) t_angle -= 0.8*govPace() * (fabsf(angle -t_angle) / 24);
 
-        if (roll > t_roll) t_roll += 0.8 * (fabsf(roll -t_roll) / 10);
-        else if (roll < t_roll) t_roll -= 0.8 * (fabsf(roll -t_roll) / 10);
+        if (roll > t_roll) t_roll += 0.8*govPace() * (fabsf(roll -t_roll) / 10);
+        else if (roll < t_roll) t_roll -= 0.8*govPace() * (fabsf(roll -t_roll) / 10);
+        lastSetNeedle(LAST_COG, t_angle);
+        lastSetNeedle(LAST_ROLL, t_roll);
 
         angle_a = cnmea.vwra; // 0-180
 
@@ -1657,8 +2194,8 @@ static int doCompass(sdl2_app *sdlApp)
         t_angle_a = rotate_a(angle_a, res_a); res_a=0;
 
         // Run needle with smooth acceleration
-//        if (angle_a > t_angle_a) t_angle_a += 3.2 * (fabsf(angle_a -t_angle_a) / 24) ;
-//        else if (angle_a < t_angle_a) t_angle_a -= 3.2 * (fabsf(angle_a -t_angle_a) / 24);
+//        if (angle_a > t_angle_a) t_angle_a += 3.2*govPace() * (fabsf(angle_a -t_angle_a) / 24) ;
+//        else if (angle_a < t_angle_a) t_angle_a -= 3.2*govPace() * (fabsf(angle_a -t_angle_a) / 24);
 
         SDL_RenderCopy(sdlApp->renderer, Background_Tx, NULL, NULL);
         SDL_RenderCopyEx(sdlApp->renderer, outerRing, NULL, &outerRingR, 0, NULL, SDL_FLIP_NONE);
@@ -1673,30 +2210,30 @@ static int doCompass(sdl2_app *sdlApp)
         get_text_and_rect(sdlApp->renderer, 226, 180, 3, msg_src, fontSrc, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
     
-        get_text_and_rect(sdlApp->renderer, 200, 200, 3, msg_hdm, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+        get_value_and_rect(sdlApp->renderer, 200, 200, 3, msg_hdm, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_HDM));
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
        
 
-        get_text_and_rect(sdlApp->renderer, 224, 248, 2, msg_rll, fontRoll, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+        get_value_and_rect(sdlApp->renderer, 224, 248, 2, msg_rll, fontRoll, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_ROLL));
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
         if (!(ct - cnmea.stw_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_stw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_stw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_STW));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
         if (!(ct - cnmea.rmc_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_sog, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_sog, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_SOG));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
         if (!(ct - cnmea.dbt_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_dbt, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <DWRN? RED : WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_dbt, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <DWRN? RED : WHITE, BUS_MASK(HIST_DBT));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
         if (!(ct - cnmea.vwr_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_mtw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_mtw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_MTW));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
@@ -1735,20 +2272,19 @@ static int doCompass(sdl2_app *sdlApp)
 
         SDL_RenderPresent(sdlApp->renderer);
 
-        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && (toggle = !toggle)) {
-            // Read the pixels from the current render target and save them onto the surface
-            // This will slow down the application a bit.
-            SDL_RenderReadPixels(sdlApp->renderer, NULL, SDL_GetWindowPixelFormat(sdlApp->window),
-                sdlApp->conf->vncPixelBuffer->pixels, sdlApp->conf->vncPixelBuffer->pitch);
-            doRGBconv(sdlApp);
-            rfbMarkRectAsModified(sdlApp->conf->vncServer, 0, 0, sdlApp->conf->window_w, sdlApp->conf->window_h);
+        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && govCapture() && (toggle = !toggle)) {
+            vncCapture(sdlApp);
         }
 
+        if (!staleMask)
+            snapTake(sdlApp->renderer, sdlApp->curPage);
+        asetUpload();
+
         // Reduce CPU load if only short scale movements
         dynUpd = (1/fabsf(angle -t_angle))*200;
         dynUpd = dynUpd > 200? 200:dynUpd;
 
-        SDL_Delay(30+(int)dynUpd);
+        govFrameDelay(30+(int)dynUpd);
         
         sdlApp->textFieldArrIndx--;
         do {
@@ -1761,22 +2297,6 @@ static int doCompass(sdl2_app *sdlApp)
         SDL_DestroyTexture(subTaskbar);
     }
 
-    SDL_DestroyTexture(compassRose);
-    SDL_DestroyTexture(outerRing);
-    SDL_DestroyTexture(clinoMeter);
-    SDL_DestroyTexture(windDir);
-    SDL_DestroyTexture(menuBar);
-    SDL_DestroyTexture(netStatBar);
-    SDL_DestroyTexture(muteBar);
-    SDL_DestroyTexture(unmuteBar);
-    SDL_DestroyTexture(calBar);
-    SDL_DestroyTexture(textBox);
-    TTF_CloseFont(fontCog);
-    TTF_CloseFont(fontRoll);
-    TTF_CloseFont(fontSrc);
-    TTF_CloseFont(fontTod);
-    IMG_Quit();
-
     return event.type;
 }
 
@@ -1785,11 +2305,11 @@ static int doSumlog(sdl2_app *sdlApp)
 {
     SDL_Event event;
     SDL_Rect gaugeR, needleR, menuBarR, subTaskbarR, netStatbarR, noNetStatbarR, mutebarR, unmutebarR, textBoxR;
-    TTF_Font* fontLarge =  TTF_OpenFont(sdlApp->fontPath, 46);
-    TTF_Font* fontSmall =  TTF_OpenFont(sdlApp->fontPath, 20);
-    TTF_Font* fontCog = TTF_OpenFont(sdlApp->fontPath, 42);
-    TTF_Font* fontSrc = TTF_OpenFont(sdlApp->fontPath, 14);
-    TTF_Font* fontTod = TTF_OpenFont(sdlApp->fontPath, 12);
+    TTF_Font* fontLarge =  asetFont(sdlApp->fontPath, 46);
+    TTF_Font* fontSmall =  asetFont(sdlApp->fontPath, 20);
+    TTF_Font* fontCog = asetFont(sdlApp->fontPath, 42);
+    TTF_Font* fontSrc = asetFont(sdlApp->fontPath, 14);
+    TTF_Font* fontTod = asetFont(sdlApp->fontPath, 12);
 
     gaugeR.w = 440;
     gaugeR.h = 440;
@@ -1826,14 +2346,14 @@ static int doSumlog(sdl2_app *sdlApp)
     textBoxR.x = 470;
     textBoxR.y = 106;
 
-    SDL_Texture* gaugeSumlog = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "sumlog.png");
-    SDL_Texture* gaugeNeedleApp = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "needle.png");
-    SDL_Texture* menuBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "menuBar.png");
-    SDL_Texture* netStatBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "netStat.png");
-    SDL_Texture* noNetStatbar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "noNetStat.png");
-    SDL_Texture* textBox = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "textBox.png");
-    SDL_Texture* muteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "mute.png");
-    SDL_Texture* unmuteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "unmute.png");
+    SDL_Texture* gaugeSumlog = asetGet("sumlog.png");
+    SDL_Texture* gaugeNeedleApp = asetGet("needle.png");
+    SDL_Texture* menuBar = asetGet("menuBar.png");
+    SDL_Texture* netStatBar = asetGet("netStat.png");
+    SDL_Texture* noNetStatbar = asetGet("noNetStat.png");
+    SDL_Texture* textBox = asetGet("textBox.png");
+    SDL_Texture* muteBar = asetGet("mute.png");
+    SDL_Texture* unmuteBar = asetGet("unmute.png");
 
     SDL_Texture* subTaskbar = NULL;
 
@@ -1848,7 +2368,7 @@ static int doSumlog(sdl2_app *sdlApp)
 
     SDL_Rect textField_rect;
 
-    float t_angle = 0;
+    float t_angle = staleMask? lastNeedle(LAST_SOG) : 0;
     float angle = 0;
     int boxItems[] = {120,170,220};
     int toggle = 1;
@@ -1932,8 +2452,9 @@ static int doSumlog(sdl2_app *sdlApp)
         angle = roundf(speed+minangle);
 
         // Run needle with smooth acceleration
-        if (angle > t_angle) t_angle += 3.2 * (fabsf(angle -t_angle) / 24) ;
-        else if (angle < t_angle) t_angle -= 3.2 * (fabsf(angle -t_angle) / 24);
+        if (angle > t_angle) t_angle += 3.2*govPace() * (fabsf(angle -t_angle) / 24) ;
+        else if (angle < t_angle) t_angle -= 3.2*govPace() * (fabsf(angle -t_angle) / 24);
+        lastSetNeedle(LAST_SOG, t_angle);
 
         SDL_RenderCopy(sdlApp->renderer, Background_Tx, NULL, NULL);
        
@@ -1942,21 +2463,21 @@ static int doSumlog(sdl2_app *sdlApp)
         if (wspeed)
             SDL_RenderCopyEx(sdlApp->renderer, gaugeNeedleApp, NULL, &needleR, t_angle, NULL, SDL_FLIP_NONE);
 
-        get_text_and_rect(sdlApp->renderer, 182, 300, 4, msg_stw, fontLarge, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+        get_value_and_rect(sdlApp->renderer, 182, 300, 4, msg_stw, fontLarge, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_STW) | BUS_MASK(HIST_SOG));
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
         if (!(ct - cnmea.hdm_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_hdm, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_hdm, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_HDM));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
         if (!(ct - cnmea.dbt_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_dbt, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <DWRN? RED : WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_dbt, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <DWRN? RED : WHITE, BUS_MASK(HIST_DBT));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
         if (!(ct - cnmea.vwr_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_mtw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_mtw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_MTW));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
@@ -1967,7 +2488,7 @@ static int doSumlog(sdl2_app *sdlApp)
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
          if (stw) {
-            get_text_and_rect(sdlApp->renderer, 186, 366, 8, msg_sog, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);       
+            get_value_and_rect(sdlApp->renderer, 186, 366, 8, msg_sog, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_SOG));       
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
@@ -1996,19 +2517,18 @@ static int doSumlog(sdl2_app *sdlApp)
 
         SDL_RenderPresent(sdlApp->renderer); 
 
-        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && (toggle = !toggle)) {
-            // Read the pixels from the current render target and save them onto the surface
-            // This will slow down the application a bit.
-            SDL_RenderReadPixels(sdlApp->renderer, NULL, SDL_GetWindowPixelFormat(sdlApp->window),
-                sdlApp->conf->vncPixelBuffer->pixels, sdlApp->conf->vncPixelBuffer->pitch);
-            doRGBconv(sdlApp);
-            rfbMarkRectAsModified(sdlApp->conf->vncServer, 0, 0, sdlApp->conf->window_w, sdlApp->conf->window_h);
+        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && govCapture() && (toggle = !toggle)) {
+            vncCapture(sdlApp);
         }
+
+        if (!staleMask)
+            snapTake(sdlApp->renderer, sdlApp->curPage);
+        asetUpload();
         // Reduce CPU load if only short scale movements
         dynUpd = (1/fabsf(angle -t_angle))*200;
         dynUpd = dynUpd > 200? 200:dynUpd;
 
-        SDL_Delay(30+(int)dynUpd);
+        govFrameDelay(30+(int)dynUpd);
 
         sdlApp->textFieldArrIndx--;
         do {
@@ -2020,20 +2540,6 @@ static int doSumlog(sdl2_app *sdlApp)
         SDL_DestroyTexture(subTaskbar);
     }
 
-    SDL_DestroyTexture(gaugeSumlog);
-    SDL_DestroyTexture(gaugeNeedleApp);
-    SDL_DestroyTexture(menuBar);
-    SDL_DestroyTexture(netStatBar);
-    SDL_DestroyTexture(muteBar);
-    SDL_DestroyTexture(unmuteBar);
-    SDL_DestroyTexture(textBox);
-    TTF_CloseFont(fontLarge);
-    TTF_CloseFont(fontSmall); 
-    TTF_CloseFont(fontCog);
-    TTF_CloseFont(fontSrc);
-    TTF_CloseFont(fontTod);
-    IMG_Quit();
-
     return event.type;
 }
 
@@ -2043,25 +2549,26 @@ static int doGps(sdl2_app *sdlApp)
     SDL_Event event;
     SDL_Rect gaugeR, menuBarR, subTaskbarR, netStatbarR, noNetStatbarR, mutebarR, unmutebarR, textBoxR;
 
-    TTF_Font* fontHD =  TTF_OpenFont(sdlApp->fontPath, 40);
-    TTF_Font* fontLA =  TTF_OpenFont(sdlApp->fontPath, 30);
-    TTF_Font* fontLO =  TTF_OpenFont(sdlApp->fontPath, 30);
-    TTF_Font* fontMG =  TTF_OpenFont(sdlApp->fontPath, 14);
-    TTF_Font* fontCog = TTF_OpenFont(sdlApp->fontPath, 42);
-    TTF_Font* fontSrc = TTF_OpenFont(sdlApp->fontPath, 14);
-    TTF_Font* fontTod = TTF_OpenFont(sdlApp->fontPath, 12);
-
-    SDL_Texture* gaugeGps = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "gps.png");
-    SDL_Texture* menuBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "menuBar.png");
-    SDL_Texture* netStatBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "netStat.png");
-    SDL_Texture* noNetStatbar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "noNetStat.png");
-    SDL_Texture* muteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "mute.png");
-    SDL_Texture* unmuteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "unmute.png");
-    SDL_Texture* textBox = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "textBox.png");
+    TTF_Font* fontHD =  asetFont(sdlApp->fontPath, 40);
+    TTF_Font* fontLA =  asetFont(sdlApp->fontPath, 30);
+    TTF_Font* fontLO =  asetFont(sdlApp->fontPath, 30);
+    TTF_Font* fontMG =  asetFont(sdlApp->fontPath, 14);
+    TTF_Font* fontCog = asetFont(sdlApp->fontPath, 42);
+    TTF_Font* fontSrc = asetFont(sdlApp->fontPath, 14);
+    TTF_Font* fontTod = asetFont(sdlApp->fontPath, 12);
+
+    SDL_Texture* gaugeGps = asetGet("gps.png");
+    SDL_Texture* menuBar = asetGet("menuBar.png");
+    SDL_Texture* netStatBar = asetGet("netStat.png");
+    SDL_Texture* noNetStatbar = asetGet("noNetStat.png");
+    SDL_Texture* muteBar = asetGet("mute.png");
+    SDL_Texture* unmuteBar = asetGet("unmute.png");
+    SDL_Texture* textBox = asetGet("textBox.png");
         
     SDL_Texture* subTaskbar = NULL;
 
     sdlApp->curPage = GPSPAGE;
+    pageWatch(sdlApp, BUS_MASK(BUS_POS) | BUS_MASK(HIST_SOG) | BUS_MASK(HIST_HDM));
 
     if (sdlApp->subAppsCmd[sdlApp->curPage][0] != NULL) {
         char icon[PATH_MAX];
@@ -2136,6 +2643,8 @@ static int doGps(sdl2_app *sdlApp)
             }
         }
         if (doBreak == 1) break;
+
+        pageWatch(sdlApp, BUS_MASK(BUS_POS) | BUS_MASK(HIST_SOG) | BUS_MASK(HIST_HDM));
         
         ct = time(NULL);    // Get a timestamp for this turn 
         strftime(msg_tod, sizeof(msg_tod),TIMEDATFMT, gmtime(&ct)); // Here we expose GMT/UTC time
@@ -2179,35 +2688,35 @@ static int doGps(sdl2_app *sdlApp)
        
         SDL_RenderCopyEx(sdlApp->renderer, gaugeGps, NULL, &gaugeR, 0, NULL, SDL_FLIP_NONE);
 
-        get_text_and_rect(sdlApp->renderer, 196, 142, 3, msg_hdm, fontHD, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+        get_value_and_rect(sdlApp->renderer, 196, 142, 3, msg_hdm, fontHD, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_HDM));
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
         get_text_and_rect(sdlApp->renderer, 290, 168, 1, msg_src, fontMG, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
-        get_text_and_rect(sdlApp->renderer, 148, 222, 9, msg_lat, fontLA, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+        get_value_and_rect(sdlApp->renderer, 148, 222, 9, msg_lat, fontLA, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(BUS_POS));
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
-        get_text_and_rect(sdlApp->renderer, 148, 292, 9, msg_lot, fontLO, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+        get_value_and_rect(sdlApp->renderer, 148, 292, 9, msg_lot, fontLO, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(BUS_POS));
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
        
         if (!(ct - cnmea.stw_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_stw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_stw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_STW));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
          if (!(ct - cnmea.rmc_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_sog, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_sog, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_SOG));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
          if (!(ct - cnmea.dbt_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_dbt, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <DWRN? RED : WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_dbt, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <DWRN? RED : WHITE, BUS_MASK(HIST_DBT));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
          if (!(ct - cnmea.vwr_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_mtw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_mtw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_MTW));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
@@ -2242,109 +2751,263 @@ static int doGps(sdl2_app *sdlApp)
 
         SDL_RenderPresent(sdlApp->renderer); 
 
-        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer) {
-            // Read the pixels from the current render target and save them onto the surface
-            // This will slow down the application a bit.
-            SDL_RenderReadPixels(sdlApp->renderer, NULL, SDL_GetWindowPixelFormat(sdlApp->window),
-                sdlApp->conf->vncPixelBuffer->pixels, sdlApp->conf->vncPixelBuffer->pitch);
-            doRGBconv(sdlApp);
-            rfbMarkRectAsModified(sdlApp->conf->vncServer, 0, 0, sdlApp->conf->window_w, sdlApp->conf->window_h);
+        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && govCapture()) {
+            vncCapture(sdlApp);
         }
 
+        if (!staleMask)
+            snapTake(sdlApp->renderer, sdlApp->curPage);
+        asetUpload();
+
         sdlApp->textFieldArrIndx--;
         do {
             SDL_DestroyTexture(sdlApp->textFieldArr[sdlApp->textFieldArrIndx]);
         } while (sdlApp->textFieldArrIndx-- >0);
 
-        SDL_Delay(200);
+        govFrameDelay(200);
     }
 
     if (subTaskbar != NULL) {
         SDL_DestroyTexture(subTaskbar);
     }
-    SDL_DestroyTexture(gaugeGps);
-    SDL_DestroyTexture(menuBar);
-    SDL_DestroyTexture(netStatBar);
-    SDL_DestroyTexture(muteBar);
-    SDL_DestroyTexture(unmuteBar);
-    SDL_DestroyTexture(textBox);
-    TTF_CloseFont(fontHD);
-    TTF_CloseFont(fontLA);
-    TTF_CloseFont(fontLO);
-    TTF_CloseFont(fontMG);
-    TTF_CloseFont(fontCog);
-    TTF_CloseFont(fontSrc);
-    TTF_CloseFont(fontTod);
-    IMG_Quit();
+
+    pageWatch(sdlApp, 0);
 
     return event.type;
 }
 
-// Present Depth data (NMEA net only)
-static int doDepth(sdl2_app *sdlApp)
+// Present the recent track around the vessel
+static int doTrack(sdl2_app *sdlApp)
 {
     SDL_Event event;
-    SDL_Rect gaugeR, needleR, menuBarR, subTaskbarR, netStatbarR, noNetStatbarR, mutebarR, unmutebarR, textBoxR;
-    TTF_Font* fontLarge =  TTF_OpenFont(sdlApp->fontPath, 46);
-    TTF_Font* fontSmall =  TTF_OpenFont(sdlApp->fontPath, 18);
-    TTF_Font* fontMedium =  TTF_OpenFont(sdlApp->fontPath, 24);
-    TTF_Font* fontCog = TTF_OpenFont(sdlApp->fontPath, 42);
-    TTF_Font* fontSrc = TTF_OpenFont(sdlApp->fontPath, 14);
-    TTF_Font* fontTod = TTF_OpenFont(sdlApp->fontPath, 12);
-
-    SDL_Texture* gaugeDepthW = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "depthw.png");
-    SDL_Texture* gaugeDepth = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "depth.png");
-    SDL_Texture* gaugeDepthx10 = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "depthx10.png");
-    SDL_Texture* menuBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "menuBar.png");
-    SDL_Texture* netStatBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "netStat.png");
-    SDL_Texture* noNetStatbar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "noNetStat.png");
-    SDL_Texture* gaugeNeedleApp = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "needle.png");
-    SDL_Texture* muteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "mute.png");
-    SDL_Texture* unmuteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "unmute.png");
-    SDL_Texture* textBox = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "textBox.png");
+    SDL_Rect menuBarR, netStatbarR, noNetStatbarR, mutebarR, trackR;
 
-    SDL_Texture* gauge;
-    SDL_Texture* subTaskbar = NULL;
-    
-    SDL_Rect textField_rect;
+    TTF_Font* fontSrc = asetFont(sdlApp->fontPath, 14);
+    TTF_Font* fontTod = asetFont(sdlApp->fontPath, 12);
+    TTF_Font* fontInf = asetFont(sdlApp->fontPath, 18);
 
-    gaugeR.w = 440;
-    gaugeR.h = 440;
-    gaugeR.x = 19;
-    gaugeR.y = 18;
+    SDL_Texture* menuBar = asetGet("menuBar.png");
+    SDL_Texture* netStatBar = asetGet("netStat.png");
+    SDL_Texture* noNetStatbar = asetGet("noNetStat.png");
+    SDL_Texture* muteBar = asetGet("mute.png");
+    SDL_Texture* unmuteBar = asetGet("unmute.png");
 
-    needleR.w = 240;
-    needleR.h = 240;
-    needleR.x = 120;
-    needleR.y = 122;
+    sdlApp->curPage = TRKPAGE;
+    pageWatch(sdlApp, BUS_MASK(BUS_POS));
+
+    SDL_Rect textField_rect;
+
+    trackR.w = 740;
+    trackR.h = 340;
+    trackR.x = 20;
+    trackR.y = 50;
 
     menuBarR.w = 340;
     menuBarR.h = 50;
     menuBarR.x = 430;
     menuBarR.y = 400;
 
-    subTaskbarR.w = 50;
-    subTaskbarR.h = 50;
-    subTaskbarR.x = 30;
-    subTaskbarR.y = 400;
-
-    netStatbarR.w = 25;
     netStatbarR.w = noNetStatbarR.w = 25;
     netStatbarR.h = noNetStatbarR.h = 25;
     netStatbarR.x = noNetStatbarR.x = 20;
     netStatbarR.y = noNetStatbarR.y = 20;
 
-    mutebarR.w = unmutebarR.w = 25;
-    mutebarR.h = unmutebarR.h = 25;
-    mutebarR.x = unmutebarR.x = 70;
-    mutebarR.y = unmutebarR.y = 20;
-
-    textBoxR.w = 290;
-    textBoxR.h = 42;
-    textBoxR.x = 470;
-    textBoxR.y = 106;
+    mutebarR.w = 25;
+    mutebarR.h = 25;
+    mutebarR.x = 70;
+    mutebarR.y = 20;
 
-    int boxItems[] = {120,170,220,270};
+    while (1) {
+        sdlApp->textFieldArrIndx = 0;
+        char msg_tod[40];
+        char msg_inf[80];
+        char msg_scl[40];
+        float scale = trckViewScale(sdlApp->trackZoom);
+        int fixes;
+        time_t ct;
+
+        int doBreak = 0;
+
+        while (SDL_PollEvent(&event)) {
+
+            if(event.type == SDL_QUIT ) {
+                doBreak = 1;
+                break;
+            }
+
+            if(event.type == SDL_FINGERDOWN || event.type == SDL_MOUSEBUTTONDOWN)
+            {
+                if ((event.type=pageSelect(sdlApp, &event))) {
+                    doBreak = 1;
+                    break;
+                }
+            }
+        }
+        if (doBreak == 1) break;
+
+        pageWatch(sdlApp, BUS_MASK(BUS_POS));
+
+        ct = time(NULL);    // Get a timestamp for this turn
+        strftime(msg_tod, sizeof(msg_tod),TIMEDATFMT, gmtime(&ct)); // Here we expose GMT/UTC time
+
+        fixes = trckViewUpdate();
+
+        if (fixes < 0)
+            sprintf(msg_inf, "No track recorded");
+        else if (ct - cnmea.gll_ts > S_TIMEOUT)
+            sprintf(msg_inf, "No position");
+        else if (!(ct - cnmea.cog_ts > S_TIMEOUT))
+            sprintf(msg_inf, "SOG: %.1f  COG: %.0f", cnmea.rmc, cnmea.cog);
+        else if (!(ct - cnmea.rmc_ts > S_TIMEOUT))
+            sprintf(msg_inf, "SOG: %.1f", cnmea.rmc);
+        else
+            msg_inf[0] = '\0';
+
+        // The width of 100 pixels
+        if (scale*100 >= 1852)
+            sprintf(msg_scl, "|-- %.1f nm --|", scale*100/1852);
+        else
+            sprintf(msg_scl, "|-- %.0f m --|", scale*100);
+
+        SDL_RenderCopy(sdlApp->renderer, Background_Tx, NULL, NULL);
+
+        SDL_SetRenderDrawColor(sdlApp->renderer, 235, 235, 225, 255);
+        SDL_RenderFillRect(sdlApp->renderer, &trackR);
+
+        if (fixes > 0) {
+            int cx = trackR.x + trackR.w/2, cy = trackR.y + trackR.h/2;
+
+            (void)trckViewDraw(sdlApp->renderer, &trackR, sdlApp->trackZoom, 0x0000A0);
+
+            // The vessel
+            SDL_SetRenderDrawColor(sdlApp->renderer, 200, 0, 0, 255);
+            if (!(ct - cnmea.rmc_ts > S_TIMEOUT) && cnmea.rmc > 0.3) {
+                float a = cnmea.hdm * M_PI/180;
+                SDL_RenderDrawLine(sdlApp->renderer, cx + 14*sin(a), cy - 14*cos(a), cx + 7*sin(a+2.6), cy - 7*cos(a+2.6));
+                SDL_RenderDrawLine(sdlApp->renderer, cx + 14*sin(a), cy - 14*cos(a), cx + 7*sin(a-2.6), cy - 7*cos(a-2.6));
+                SDL_RenderDrawLine(sdlApp->renderer, cx + 7*sin(a+2.6), cy - 7*cos(a+2.6), cx + 7*sin(a-2.6), cy - 7*cos(a-2.6));
+            } else {
+                SDL_RenderDrawLine(sdlApp->renderer, cx - 6, cy, cx + 6, cy);
+                SDL_RenderDrawLine(sdlApp->renderer, cx, cy - 6, cx, cy + 6);
+            }
+        }
+
+        get_text_and_rect(sdlApp->renderer, 30, 360, 0, msg_scl, fontSrc, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+        SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
+
+        if (msg_inf[0]) {
+            get_value_and_rect(sdlApp->renderer, 30, 58, 0, msg_inf, fontInf, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_SOG) | BUS_MASK(BUS_POS));
+            SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
+        }
+
+        SDL_RenderCopyEx(sdlApp->renderer, menuBar, NULL, &menuBarR, 0, NULL, SDL_FLIP_NONE);
+        addMenuItems(sdlApp, fontSrc);
+
+        get_text_and_rect(sdlApp->renderer, 620, 10, 0, msg_tod, fontTod, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+        SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
+
+        if (sdlApp->conf->netStat == 1) {
+           SDL_RenderCopyEx(sdlApp->renderer, netStatBar, NULL, &netStatbarR, 0, NULL, SDL_FLIP_NONE);
+        } else {
+            SDL_RenderCopyEx(sdlApp->renderer, noNetStatbar, NULL, &noNetStatbarR, 0, NULL, SDL_FLIP_NONE);
+        }
+
+        if (sdlApp->conf->runWrn) {
+            if (sdlApp->conf->muted == 0) {
+                SDL_RenderCopyEx(sdlApp->renderer, muteBar, NULL, &mutebarR, 0, NULL, SDL_FLIP_NONE);
+            } else {
+                SDL_RenderCopyEx(sdlApp->renderer, unmuteBar, NULL, &mutebarR, 0, NULL, SDL_FLIP_NONE);
+            }
+        }
+
+        SDL_RenderPresent(sdlApp->renderer);
+
+        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && govCapture()) {
+            vncCapture(sdlApp);
+        }
+
+        if (!staleMask)
+            snapTake(sdlApp->renderer, sdlApp->curPage);
+        asetUpload();
+
+        sdlApp->textFieldArrIndx--;
+        do {
+            SDL_DestroyTexture(sdlApp->textFieldArr[sdlApp->textFieldArrIndx]);
+        } while (sdlApp->textFieldArrIndx-- >0);
+
+        govFrameDelay(200);
+    }
+
+    pageWatch(sdlApp, 0);
+
+    return event.type;
+}
+
+// Present Depth data (NMEA net only)
+static int doDepth(sdl2_app *sdlApp)
+{
+    SDL_Event event;
+    SDL_Rect gaugeR, needleR, menuBarR, subTaskbarR, netStatbarR, noNetStatbarR, mutebarR, unmutebarR, textBoxR;
+    TTF_Font* fontLarge =  asetFont(sdlApp->fontPath, 46);
+    TTF_Font* fontSmall =  asetFont(sdlApp->fontPath, 18);
+    TTF_Font* fontMedium =  asetFont(sdlApp->fontPath, 24);
+    TTF_Font* fontCog = asetFont(sdlApp->fontPath, 42);
+    TTF_Font* fontSrc = asetFont(sdlApp->fontPath, 14);
+    TTF_Font* fontTod = asetFont(sdlApp->fontPath, 12);
+
+    SDL_Texture* gaugeDepthW = asetGet("depthw.png");
+    SDL_Texture* gaugeDepth = asetGet("depth.png");
+    SDL_Texture* gaugeDepthx10 = asetGet("depthx10.png");
+    SDL_Texture* menuBar = asetGet("menuBar.png");
+    SDL_Texture* netStatBar = asetGet("netStat.png");
+    SDL_Texture* noNetStatbar = asetGet("noNetStat.png");
+    SDL_Texture* gaugeNeedleApp = asetGet("needle.png");
+    SDL_Texture* muteBar = asetGet("mute.png");
+    SDL_Texture* unmuteBar = asetGet("unmute.png");
+    SDL_Texture* textBox = asetGet("textBox.png");
+
+    SDL_Texture* gauge;
+    SDL_Texture* subTaskbar = NULL;
+    
+    SDL_Rect textField_rect;
+
+    gaugeR.w = 440;
+    gaugeR.h = 440;
+    gaugeR.x = 19;
+    gaugeR.y = 18;
+
+    needleR.w = 240;
+    needleR.h = 240;
+    needleR.x = 120;
+    needleR.y = 122;
+
+    menuBarR.w = 340;
+    menuBarR.h = 50;
+    menuBarR.x = 430;
+    menuBarR.y = 400;
+
+    subTaskbarR.w = 50;
+    subTaskbarR.h = 50;
+    subTaskbarR.x = 30;
+    subTaskbarR.y = 400;
+
+    netStatbarR.w = 25;
+    netStatbarR.w = noNetStatbarR.w = 25;
+    netStatbarR.h = noNetStatbarR.h = 25;
+    netStatbarR.x = noNetStatbarR.x = 20;
+    netStatbarR.y = noNetStatbarR.y = 20;
+
+    mutebarR.w = unmutebarR.w = 25;
+    mutebarR.h = unmutebarR.h = 25;
+    mutebarR.x = unmutebarR.x = 70;
+    mutebarR.y = unmutebarR.y = 20;
+
+    textBoxR.w = 290;
+    textBoxR.h = 42;
+    textBoxR.x = 470;
+    textBoxR.y = 106;
+
+    int boxItems[] = {120,170,220,270,320};
 
     sdlApp->curPage = DPTPAGE;
 
@@ -2355,34 +3018,17 @@ static int doDepth(sdl2_app *sdlApp)
             subTaskbar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "tool.png");           
     }
 
-    float t_angle = 0;
+    float t_angle = staleMask? lastNeedle(LAST_DPT) : 0;
     float angle = 0;
 
     int toggle = 1;
 
     float dynUpd;
 
-#ifdef PLOTSDL
-    static float depthBuf[25];
-    static plot_params params;
-
-    params.screen_width=760;
-    params.screen_heigth=350;
-    params.font_text_path=DEFAULT_FONT;
-    params.font_text_size=12;
-    params.hide_backgroud = 1;
-    params.hide_caption = 1;
-    params.caption_text_x="Time (s)";
-    params.caption_text_y="Depth (m)";
-    params.scale_x = 1;
-    params.max_x = sizeof(depthBuf)/sizeof(float);
-    params.screen = sdlApp->window;
-    params.renderer = sdlApp->renderer;
-    params.offset_x = 0;
-    params.offset_y = 40;
-    for (int i=0; i< sizeof(depthBuf)/sizeof(float); i++)
-        depthBuf[i]= cnmea.dbt_ts > S_TIMEOUT? cnmea.dbt : 0.0;
-#endif
+    plotParams plot;
+
+    (void)plotInit(&plot, sdlApp->renderer, sdlApp->fontPath, 0, 40, 760, 350, PLOT_POINTS);
+    plot.caption_y = "Depth (m)";
 
     while (1) {
         int boxItem = 0;
@@ -2396,8 +3042,11 @@ static int doDepth(sdl2_app *sdlApp)
         char msg_stw[40] = { "" };
         char msg_rmc[40] = { "" };
         char msg_vwt[40] = { "" };
+        char msg_min[40] = { "" };
         char msg_tod[40];
+        statValue shallow;
         time_t ct;
+        float depthw;
 
         // Constants for instrument
         const float minangle = 12;  // Scale start
@@ -2424,6 +3073,7 @@ static int doDepth(sdl2_app *sdlApp)
         if (doBreak == 1) break;
 
         ct = time(NULL);    // Get a timestamp for this turn 
+        depthw = warnDepth();
         strftime(msg_tod, sizeof(msg_tod),TIMEDATFMT, localtime(&ct));
 
         // DPT - Depth
@@ -2435,7 +3085,7 @@ static int doDepth(sdl2_app *sdlApp)
         }
 
         if (sdlApp->conf->runWrn) {
-            sprintf(msg_dtw, "@%.1f", warn.depthw);
+            sprintf(msg_dtw, "@%.1f", depthw);
         }
 
         // Heading
@@ -2460,8 +3110,12 @@ static int doDepth(sdl2_app *sdlApp)
         if (!(ct - cnmea.vwr_ts > S_TIMEOUT))
             sprintf(msg_mtw, "WND: %.1f", cnmea.vwrs);
 
+        // Shallowest the last 10 minutes
+        if (statGet(HIST_DBT, STAT_10MIN, &shallow))
+            sprintf(msg_min, "MIN: %.1f", shallow.min);
+
         gauge = gaugeDepth;
-        if (cnmea.dbt <=5 || (cnmea.dbt <= 10 && cnmea.dbt <= warn.depthw)) {
+        if (cnmea.dbt <=5 || (cnmea.dbt <= 10 && cnmea.dbt <= depthw)) {
             gauge = gaugeDepthW;
         }
         if (cnmea.dbt > 10) gauge = gaugeDepthx10;
@@ -2473,8 +3127,9 @@ static int doDepth(sdl2_app *sdlApp)
         angle = roundf(scale+minangle);
 
         // Run needle with smooth acceleration
-        if (angle > t_angle) t_angle += 3.2 * (fabsf(angle -t_angle) / 24) ;
-        else if (angle < t_angle) t_angle -= 3.2 * (fabsf(angle -t_angle) / 24);
+        if (angle > t_angle) t_angle += 3.2*govPace() * (fabsf(angle -t_angle) / 24) ;
+        else if (angle < t_angle) t_angle -= 3.2*govPace() * (fabsf(angle -t_angle) / 24);
+        lastSetNeedle(LAST_DPT, t_angle);
 
         SDL_RenderCopy(sdlApp->renderer, Background_Tx, NULL, NULL);
     
@@ -2486,32 +3141,37 @@ static int doDepth(sdl2_app *sdlApp)
         }
 
         if (!sdlApp->plotMode) {
-            get_text_and_rect(sdlApp->renderer, 182, 300, 4, msg_dbt, fontLarge, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+            get_value_and_rect(sdlApp->renderer, 182, 300, 4, msg_dbt, fontLarge, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_DBT));
         } else {
-            get_text_and_rect(sdlApp->renderer, 182, 390, 4, msg_dbt, fontLarge, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <= warn.depthw? RED: BLACK);
+            get_value_and_rect(sdlApp->renderer, 182, 390, 4, msg_dbt, fontLarge, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <= depthw? RED: BLACK, BUS_MASK(HIST_DBT));
         }
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
         if (!sdlApp->plotMode) {
-            get_text_and_rect(sdlApp->renderer, 180, 370, 1, msg_vwt, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+            get_value_and_rect(sdlApp->renderer, 180, 370, 1, msg_vwt, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_MTW));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
             if (!(ct - cnmea.hdm_ts > S_TIMEOUT)) {
-                get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_hdm, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+                get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_hdm, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_HDM));
                 SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
             }
             if (!(ct - cnmea.rmc_ts > S_TIMEOUT)) {
-                get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_rmc, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+                get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_rmc, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_SOG));
                 SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
             }
 
             if (!(ct - cnmea.stw_ts > S_TIMEOUT)) {
-                get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_stw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+                get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_stw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_STW));
                 SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
             }
 
             if (!(ct - cnmea.vwr_ts > S_TIMEOUT)) {
-                get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_mtw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+                get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_mtw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_MTW));
+                SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
+            }
+
+            if (msg_min[0]) {
+                get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_min, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, shallow.min <= depthw? RED : WHITE);
                 SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
             }
         }
@@ -2534,7 +3194,7 @@ static int doDepth(sdl2_app *sdlApp)
 
         if (sdlApp->conf->runWrn) {
             if (!sdlApp->plotMode) {
-                get_text_and_rect(sdlApp->renderer, 264, 158, 1, msg_dtw, fontMedium, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <= warn.depthw? RED: BLACK);
+                get_text_and_rect(sdlApp->renderer, 264, 158, 1, msg_dtw, fontMedium, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <= depthw? RED: BLACK);
                 SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
             }
 
@@ -2550,74 +3210,44 @@ static int doDepth(sdl2_app *sdlApp)
             SDL_RenderCopyEx(sdlApp->renderer, textBox, NULL, &textBoxR, 0, NULL, SDL_FLIP_NONE);
         }
 
-#ifdef PLOTSDL
         if (sdlApp->plotMode)
         {
-            // The captionlist and coordlist lists
-            captionlist caption_list = NULL;
-            coordlist coordinate_list = NULL;
-            int j=0;
-
-            // Hidden but must be defined
-            caption_list=push_back_caption(caption_list,"Depth", 0, (cnmea.dbt <= warn.depthw? 0xFF0000 : 0x00FF00));
-
-            int avtd = 0;
-            float awd = 0;
-
-            // Populate plot parameter object
-            depthBuf[0] = cnmea.dbt;
-
-            for (int i=sizeof(depthBuf)/sizeof(float); i >0; i--)
-            {
-                coordinate_list=push_back_coord(coordinate_list, 0, j, depthBuf[j]);
-                if (depthBuf[j] && avtd < 6) {
-                    awd += depthBuf[j];
-                    avtd++;
-                }
-                if (j++)
-                    depthBuf[i] = depthBuf[i-1];    // History shift
-            }
-
-            awd /= avtd;
-
-            // Adjust y-scale according to sampled average watt
-            params.max_y = 1000; params.scale_y = 75;    // Default
-            if (awd < 500) {params.max_y = 500;    params.scale_y = 50;}
-            if (awd < 200) {params.max_y = 220;    params.scale_y = 20;}
-            if (awd < 100) {params.max_y = 120;    params.scale_y = 10;}
-            if (awd < 40)  {params.max_y = 50;     params.scale_y = 5;}
-            if (awd < 20)  {params.max_y = 30;     params.scale_y = 3;}
-            if (awd < 6)   {params.max_y = 8;      params.scale_y = 1;}
-            //if (awd < 3)   {params.max_y = 5;      params.scale_y = 1;}
+            // Populate the plot from the history store
+            float awd = plotHistory(sdlApp, &plot, HIST_DBT, ct);
+
+            // Adjust y-scale according to the deepest sample
+            plot.max_y = 1000; plot.scale_y = 75;    // Default
+            if (awd < 500) {plot.max_y = 500;    plot.scale_y = 50;}
+            if (awd < 200) {plot.max_y = 220;    plot.scale_y = 20;}
+            if (awd < 100) {plot.max_y = 120;    plot.scale_y = 10;}
+            if (awd < 40)  {plot.max_y = 50;     plot.scale_y = 5;}
+            if (awd < 20)  {plot.max_y = 30;     plot.scale_y = 3;}
+            if (awd < 6)   {plot.max_y = 8;      plot.scale_y = 1;}
+            //if (awd < 3)   {plot.max_y = 5;      plot.scale_y = 1;}
            
-            params.caption_list = caption_list;
-            if(doPlot)
-	            params.coordinate_list = coordinate_list;
-
-            plot_graph(&params);
+            // The history stays in view, greyed out without a live value
+            plotDraw(&plot, !doPlot? PLOT_GREY : cnmea.dbt <= depthw? 0xFF0000 : 0x00FF00);
         }
-#endif
 
 
         SDL_RenderPresent(sdlApp->renderer);
 
-        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && (toggle = !toggle)) {
-            // Read the pixels from the current render target and save them onto the surface
-            // This will slow down the application a bit.
-            SDL_RenderReadPixels(sdlApp->renderer, NULL, SDL_GetWindowPixelFormat(sdlApp->window),
-                sdlApp->conf->vncPixelBuffer->pixels, sdlApp->conf->vncPixelBuffer->pitch);
-            doRGBconv(sdlApp);
-            rfbMarkRectAsModified(sdlApp->conf->vncServer, 0, 0, sdlApp->conf->window_w, sdlApp->conf->window_h);
+        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && govCapture() && (toggle = !toggle)) {
+            vncCapture(sdlApp);
         }
 
+        if (!staleMask)
+            snapTake(sdlApp->renderer, sdlApp->curPage);
+        asetUpload();
+
         if (!sdlApp->plotMode) {
         
             // Reduce CPU load if only short scale movements
             dynUpd = (1/fabsf(angle -t_angle))*200;
             dynUpd = dynUpd > 200? 200:dynUpd;
-            SDL_Delay(30+(int)dynUpd);
+            govFrameDelay(30+(int)dynUpd);
         }   else {
-            SDL_Delay(1000);
+            govFrameDelay(1000);
         }
 
         sdlApp->textFieldArrIndx--;
@@ -2630,26 +3260,7 @@ static int doDepth(sdl2_app *sdlApp)
         SDL_DestroyTexture(subTaskbar);
     }
 
-#ifdef PLOTSDL
-    params.screen_width=0;
-    plot_graph(&params);
-#endif
-
-    SDL_DestroyTexture(gaugeDepth);
-    SDL_DestroyTexture(gaugeDepthW);
-    SDL_DestroyTexture(gaugeDepthx10);
-    SDL_DestroyTexture(gaugeNeedleApp);
-    SDL_DestroyTexture(menuBar);
-    SDL_DestroyTexture(netStatBar);
-    SDL_DestroyTexture(muteBar);
-    SDL_DestroyTexture(unmuteBar);
-    SDL_DestroyTexture(textBox);
-    TTF_CloseFont(fontLarge);
-    TTF_CloseFont(fontSmall);
-    TTF_CloseFont(fontCog);
-    TTF_CloseFont(fontSrc);
-    TTF_CloseFont(fontTod);
-    IMG_Quit();
+    plotClose(&plot);
 
     return event.type;
 }
@@ -2659,21 +3270,21 @@ static int doWind(sdl2_app *sdlApp)
 {
     SDL_Event event;
     SDL_Rect gaugeR, needleR, menuBarR, subTaskbarR, netStatbarR, noNetStatbarR, mutebarR, unmutebarR, textBoxR;;
-    TTF_Font* fontLarge =  TTF_OpenFont(sdlApp->fontPath, 46);
-    TTF_Font* fontSmall =  TTF_OpenFont(sdlApp->fontPath, 20);
-    TTF_Font* fontCog = TTF_OpenFont(sdlApp->fontPath, 42);
-    TTF_Font* fontSrc = TTF_OpenFont(sdlApp->fontPath, 14);
-    TTF_Font* fontTod = TTF_OpenFont(sdlApp->fontPath, 12);
-
-    SDL_Texture* gaugeSumlog = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "wind.png");
-    SDL_Texture* gaugeNeedleApp = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "needle.png");
-    SDL_Texture* gaugeNeedleTrue = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "needle-black.png");
-    SDL_Texture* menuBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "menuBar.png");
-    SDL_Texture* netStatBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "netStat.png");
-    SDL_Texture* noNetStatbar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "noNetStat.png");
-    SDL_Texture* muteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "mute.png");
-    SDL_Texture* unmuteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "unmute.png");
-    SDL_Texture* textBox = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "textBox.png");
+    TTF_Font* fontLarge =  asetFont(sdlApp->fontPath, 46);
+    TTF_Font* fontSmall =  asetFont(sdlApp->fontPath, 20);
+    TTF_Font* fontCog = asetFont(sdlApp->fontPath, 42);
+    TTF_Font* fontSrc = asetFont(sdlApp->fontPath, 14);
+    TTF_Font* fontTod = asetFont(sdlApp->fontPath, 12);
+
+    SDL_Texture* gaugeSumlog = asetGet("wind.png");
+    SDL_Texture* gaugeNeedleApp = asetGet("needle.png");
+    SDL_Texture* gaugeNeedleTrue = asetGet("needle-black.png");
+    SDL_Texture* menuBar = asetGet("menuBar.png");
+    SDL_Texture* netStatBar = asetGet("netStat.png");
+    SDL_Texture* noNetStatbar = asetGet("noNetStat.png");
+    SDL_Texture* muteBar = asetGet("mute.png");
+    SDL_Texture* unmuteBar = asetGet("unmute.png");
+    SDL_Texture* textBox = asetGet("textBox.png");
 
     SDL_Texture* subTaskbar = NULL;
 
@@ -2725,8 +3336,8 @@ static int doWind(sdl2_app *sdlApp)
 
     SDL_Rect textField_rect;
 
-    float t_angle_a = 0;
-    float t_angle_t = 0;
+    float t_angle_a = staleMask? remainderf(lastNeedle(LAST_AWA), 360) : 0;
+    float t_angle_t = staleMask? remainderf(lastNeedle(LAST_TWA), 360) : 0;
     float angle_a = 0;
     float angle_t = 0;
     int res = 1;
@@ -2748,7 +3359,9 @@ static int doWind(sdl2_app *sdlApp)
         char msg_stw[40] = { "" };
         char msg_hdm[40] = { "" };
         char msg_rmc[40] = { "" };
+        char msg_gst[40] = { "" };
         char msg_tod[40];
+        statValue gust, tws;
         time_t ct;
         int doBreak = 0;
         
@@ -2783,9 +3396,15 @@ static int doWind(sdl2_app *sdlApp)
         else
             sprintf(msg_vwra, "%.0f%c", cnmea.vwra, 0xb0);
 
+        // Strongest apparent wind the last 10 minutes
+        if (statGet(HIST_AWS, STAT_10MIN, &gust))
+            sprintf(msg_gst, "GUST: %.1f", gust.max);
+
         // True wind speed
          if (ct -  cnmea.vwt_ts > S_TIMEOUT || cnmea.vwts == 0)
             sprintf(msg_vwts, "----");
+        else if (statGet(HIST_TWS, STAT_10MIN, &tws))
+            sprintf(msg_vwts, "TRUE: %.1f AVG: %.1f", cnmea.vwts, tws.mean);
         else
             sprintf(msg_vwts, "TRUE: %.1f", cnmea.vwts);
 
@@ -2814,8 +3433,8 @@ static int doWind(sdl2_app *sdlApp)
         angle_a = rotate(angle_a, res); res=0;
         
         // Run needle with smooth acceleration
-        if (angle_a > t_angle_a) t_angle_a += 3.2 * (fabsf(angle_a -t_angle_a) / 24) ;
-        else if (angle_a < t_angle_a) t_angle_a -= 3.2 * (fabsf(angle_a -t_angle_a) / 24);
+        if (angle_a > t_angle_a) t_angle_a += 3.2*govPace() * (fabsf(angle_a -t_angle_a) / 24) ;
+        else if (angle_a < t_angle_a) t_angle_a -= 3.2*govPace() * (fabsf(angle_a -t_angle_a) / 24);
 
         angle_t = cnmea.vwta; // 0-180
 
@@ -2826,8 +3445,10 @@ static int doWind(sdl2_app *sdlApp)
         angle_t = rotate_a(angle_t, res_a); res_a=0;
         
         // Run needle with smooth acceleration
-        if (angle_t > t_angle_t) t_angle_t += 3.2 * (fabsf(angle_t -t_angle_t) / 24) ;
-        else if (angle_t < t_angle_t) t_angle_t -= 3.2 * (fabsf(angle_t -t_angle_t) / 24);
+        if (angle_t > t_angle_t) t_angle_t += 3.2*govPace() * (fabsf(angle_t -t_angle_t) / 24) ;
+        else if (angle_t < t_angle_t) t_angle_t -= 3.2*govPace() * (fabsf(angle_t -t_angle_t) / 24);
+        lastSetNeedle(LAST_AWA, t_angle_a);
+        lastSetNeedle(LAST_TWA, t_angle_t);
 
         SDL_RenderCopy(sdlApp->renderer, Background_Tx, NULL, NULL);
        
@@ -2839,34 +3460,39 @@ static int doWind(sdl2_app *sdlApp)
         if (!(ct - cnmea.stw_ts > S_TIMEOUT) && cnmea.stw > 0.9) 
             SDL_RenderCopyEx(sdlApp->renderer, gaugeNeedleTrue, NULL, &needleR, t_angle_t, NULL, SDL_FLIP_NONE);
 
-        get_text_and_rect(sdlApp->renderer, 216, 100, 4, msg_vwra, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+        get_value_and_rect(sdlApp->renderer, 216, 100, 4, msg_vwra, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_AWA));
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
-        get_text_and_rect(sdlApp->renderer, 182, 300, 4, msg_vwrs, fontLarge, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);    
+        get_value_and_rect(sdlApp->renderer, 182, 300, 4, msg_vwrs, fontLarge, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_AWS));    
         SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
         if (!(ct - cnmea.stw_ts > S_TIMEOUT) && cnmea.stw > 0.9) {
-            get_text_and_rect(sdlApp->renderer, 150, 356, 4, msg_vwts, fontSmall,&sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);    
+            get_value_and_rect(sdlApp->renderer, 150, 356, 4, msg_vwts, fontSmall,&sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_TWS));    
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
         
         if (!(ct - cnmea.hdm_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_hdm, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_hdm, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_HDM));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
         
         if (!(ct - cnmea.stw_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_stw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_stw, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_STW));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
         if (!(ct - cnmea.rmc_ts > S_TIMEOUT)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_rmc, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_rmc, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE, BUS_MASK(HIST_SOG));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
         if (!(ct - cnmea.dbt_ts > S_TIMEOUT || cnmea.dbt == 0)) {
-            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_dbt, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <DWRN? RED : WHITE);
+            get_value_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_dbt, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, cnmea.dbt <DWRN? RED : WHITE, BUS_MASK(HIST_DBT));
+            SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
+        }
+
+        if (msg_gst[0]) {
+            get_text_and_rect(sdlApp->renderer, 500, boxItems[boxItem++], 0, msg_gst, fontCog, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, WHITE);
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
         }
 
@@ -2901,20 +3527,19 @@ static int doWind(sdl2_app *sdlApp)
 
         SDL_RenderPresent(sdlApp->renderer);
  
-        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && (toggle = !toggle)) {
-            // Read the pixels from the current render target and save them onto the surface
-            // This will slow down the application a bit.
-            SDL_RenderReadPixels(sdlApp->renderer, NULL, SDL_GetWindowPixelFormat(sdlApp->window),
-                sdlApp->conf->vncPixelBuffer->pixels, sdlApp->conf->vncPixelBuffer->pitch);
-            doRGBconv(sdlApp);
-            rfbMarkRectAsModified(sdlApp->conf->vncServer, 0, 0, sdlApp->conf->window_w, sdlApp->conf->window_h);
+        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && govCapture() && (toggle = !toggle)) {
+            vncCapture(sdlApp);
         }
+
+        if (!staleMask)
+            snapTake(sdlApp->renderer, sdlApp->curPage);
+        asetUpload();
         
         // Reduce CPU load if only short scale movements
         dynUpd = (1/fabsf(angle_a -t_angle_a))*200;
         dynUpd = dynUpd > 200? 200:dynUpd;
 
-        SDL_Delay(30+(int)dynUpd);
+        govFrameDelay(30+(int)dynUpd);
 
         sdlApp->textFieldArrIndx--;
         do {
@@ -2925,20 +3550,6 @@ static int doWind(sdl2_app *sdlApp)
     if (subTaskbar != NULL) {
         SDL_DestroyTexture(subTaskbar);
     }
-    SDL_DestroyTexture(gaugeSumlog);
-    SDL_DestroyTexture(gaugeNeedleApp);
-    SDL_DestroyTexture(gaugeNeedleTrue);
-    SDL_DestroyTexture(menuBar);
-    SDL_DestroyTexture(netStatBar);
-    SDL_DestroyTexture(muteBar);
-    SDL_DestroyTexture(unmuteBar);
-    SDL_DestroyTexture(textBox);
-    TTF_CloseFont(fontLarge);
-    TTF_CloseFont(fontSmall);
-    TTF_CloseFont(fontCog);
-    TTF_CloseFont(fontSrc);
-    TTF_CloseFont(fontTod);
-    IMG_Quit();
 
     return event.type;
 }
@@ -2949,25 +3560,26 @@ static int doEnvironment(sdl2_app *sdlApp)
     SDL_Event event;
     SDL_Rect gaugeVoltR, gaugeCurrR, gaugeTempR, voltNeedleR, currNeedleR;
     SDL_Rect tempNeedleR, menuBarR, netStatbarR, noNetStatbarR, mutebarR, unmutebarR, subTaskbarR;
-    TTF_Font* fontSmall = TTF_OpenFont(sdlApp->fontPath, 14);
-    TTF_Font* fontLarge = TTF_OpenFont(sdlApp->fontPath, 18);
-    TTF_Font* fontTod = TTF_OpenFont(sdlApp->fontPath, 12);
-
-    SDL_Texture* menuBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "menuBar.png");
-    SDL_Texture* netStatBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "netStat.png");
-    SDL_Texture* noNetStatbar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "noNetStat.png");
-    SDL_Texture* muteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "mute.png");
-    SDL_Texture* unmuteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "unmute.png");
-
-    SDL_Texture* gaugeVolt = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "volt.png");
-    SDL_Texture* gaugeVolt24 = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "volt-24.png");
-    SDL_Texture* gaugeCurr = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "curr.png");
-    SDL_Texture* gaugeTemp = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "temp.png");
-    SDL_Texture* needleVolt = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "sneedle.png");
-    SDL_Texture* needleCurr = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "sneedle.png");
-    SDL_Texture* needleTemp = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "sneedle.png");
+    TTF_Font* fontSmall = asetFont(sdlApp->fontPath, 14);
+    TTF_Font* fontLarge = asetFont(sdlApp->fontPath, 18);
+    TTF_Font* fontTod = asetFont(sdlApp->fontPath, 12);
+
+    SDL_Texture* menuBar = asetGet("menuBar.png");
+    SDL_Texture* netStatBar = asetGet("netStat.png");
+    SDL_Texture* noNetStatbar = asetGet("noNetStat.png");
+    SDL_Texture* muteBar = asetGet("mute.png");
+    SDL_Texture* unmuteBar = asetGet("unmute.png");
+
+    SDL_Texture* gaugeVolt = asetGet("volt.png");
+    SDL_Texture* gaugeVolt24 = asetGet("volt-24.png");
+    SDL_Texture* gaugeCurr = asetGet("curr.png");
+    SDL_Texture* gaugeTemp = asetGet("temp.png");
+    SDL_Texture* needleVolt = asetGet("sneedle.png");
+    SDL_Texture* needleCurr = asetGet("sneedle.png");
+    SDL_Texture* needleTemp = asetGet("sneedle.png");
 
     sdlApp->curPage = PWRPAGE;
+    pageWatch(sdlApp, BUS_MASK(HIST_VOLT) | BUS_MASK(HIST_CURR) | BUS_MASK(HIST_TEMP));
     SDL_Texture* subTaskbar = NULL;
 
     if (sdlApp->subAppsCmd[sdlApp->curPage][0] != NULL) {
@@ -3054,28 +3666,10 @@ static int doEnvironment(sdl2_app *sdlApp)
     char msg_curr_bank[20] = {"Bank -"};
     char msg_temp_loca[20] = {"--"};
 
-#ifdef PLOTSDL
-    float powerBuf[25];
-
-    plot_params params;
-
-    params.screen_width=760;
-    params.screen_heigth=210;
-    params.font_text_path=DEFAULT_FONT;
-    params.font_text_size=12;
-    params.hide_backgroud = 1;
-    params.hide_caption = 1;
-    params.caption_text_x="Time (s)";
-    params.caption_text_y="Watt";
-    params.scale_x = 1;
-    params.max_x = sizeof(powerBuf)/sizeof(float);
-    params.screen = sdlApp->window;
-    params.renderer = sdlApp->renderer;
-    params.offset_x = 0;
-    params.offset_y = 190;
-
-    memset(powerBuf, 0, sizeof(powerBuf));
-#endif
+    plotParams plot;
+
+    (void)plotInit(&plot, sdlApp->renderer, sdlApp->fontPath, 0, 190, 760, 210, PLOT_POINTS);
+    plot.caption_y = "Watt";
 
     while (1) {
         sdlApp->textFieldArrIndx = 0;
@@ -3108,6 +3702,8 @@ static int doEnvironment(sdl2_app *sdlApp)
         }
         if (doBreak == 1) break;
 
+        pageWatch(sdlApp, BUS_MASK(HIST_VOLT) | BUS_MASK(HIST_CURR) | BUS_MASK(HIST_TEMP));
+
         ct = time(NULL);    // Get a timestamp for this turn
         strftime(msg_tod, sizeof(msg_tod),TIMEDATFMT, localtime(&ct));
 
@@ -3155,7 +3751,7 @@ static int doEnvironment(sdl2_app *sdlApp)
             v_angle = ((volt_value-v_scaleoffset) * (v_maxangle/v_max) *2)+v_offset;
             SDL_RenderCopyEx(sdlApp->renderer, needleVolt, NULL, &voltNeedleR, v_angle, NULL, SDL_FLIP_NONE);
 
-            get_text_and_rect(sdlApp->renderer, 164, 170, 0, msg_volt, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+            get_value_and_rect(sdlApp->renderer, 164, 170, 0, msg_volt, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_VOLT));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
             get_text_and_rect(sdlApp->renderer, 146, 240, 0, msg_volt_bank, fontLarge,&sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
@@ -3169,7 +3765,7 @@ static int doEnvironment(sdl2_app *sdlApp)
                 SDL_RenderCopyEx(sdlApp->renderer, needleCurr, NULL, &currNeedleR, c_angle, NULL, SDL_FLIP_NONE);
             }
 
-            get_text_and_rect(sdlApp->renderer, 386, 170, 0, msg_curr, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+            get_value_and_rect(sdlApp->renderer, 386, 170, 0, msg_curr, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_CURR));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
             get_text_and_rect(sdlApp->renderer, 370, 240, 0, msg_curr_bank, fontLarge, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
@@ -3181,7 +3777,7 @@ static int doEnvironment(sdl2_app *sdlApp)
             t_angle = ((temp_value-t_scaleoffset) * (t_maxangle/t_max)*1.2)+t_offset;
             SDL_RenderCopyEx(sdlApp->renderer, needleTemp, NULL, &tempNeedleR, t_angle, NULL, SDL_FLIP_NONE);
 
-            get_text_and_rect(sdlApp->renderer, 605, 170, 0, msg_temp, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
+            get_value_and_rect(sdlApp->renderer, 605, 170, 0, msg_temp, fontSmall, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK, BUS_MASK(HIST_TEMP));
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
             get_text_and_rect(sdlApp->renderer, 586, 240, 0, msg_temp_loca, fontLarge, &sdlApp->textFieldArr[sdlApp->textFieldArrIndx], &textField_rect, BLACK);
@@ -3220,66 +3816,36 @@ static int doEnvironment(sdl2_app *sdlApp)
             SDL_RenderCopyEx(sdlApp->renderer, subTaskbar, NULL, &subTaskbarR, 0, NULL, SDL_FLIP_NONE);
         }
 
-#ifdef PLOTSDL
         if (cnmea.startTime)
         {
-            // The captionlist and coordlist lists
-            captionlist caption_list = NULL;
-            coordlist coordinate_list = NULL;
-            int j=0;
-
-            // Hidden but must be defined
-            caption_list=push_back_caption(caption_list,"Power consumption", 0, (curr_value >=0? 0x00FF00 : 0xFF0000));
-
-            int avtp = 0;
-            float avpw = 0;
-
-            // Populate plot parameter object
-            powerBuf[0] = fabs(cnmea.volt * cnmea.curr);
-
-            for (int i=sizeof(powerBuf)/sizeof(float); i >0; i--)
-            {
-                coordinate_list=push_back_coord(coordinate_list, 0, j, powerBuf[j]);
-                if (powerBuf[j] && avtp < 6) {
-                    avpw += powerBuf[j];
-                    avtp++;
-                }
-                if (j++)
-                    powerBuf[i] = powerBuf[i-1];    // History shift
-            }
-
-            avpw /= avtp;
-
-            // Adjust y-scale according to sampled average watt
-            params.max_y = 1000; params.scale_y = 75;    // Default
-            if (avpw < 500) {params.max_y = 500;    params.scale_y = 50;}
-            if (avpw < 200) {params.max_y = 220;    params.scale_y = 20;}
-            if (avpw < 100) {params.max_y = 120;    params.scale_y = 10;}
-            if (avpw < 40)  {params.max_y = 50;     params.scale_y = 5;}
-            if (avpw < 20)  {params.max_y = 30;     params.scale_y = 3;}
-            if (avpw < 6)   {params.max_y = 8;      params.scale_y = 1;}
-            //if (avpw < 3)   {params.max_y = 5;      params.scale_y = 1;}
+            // Populate the plot from the history store
+            float avpw = plotHistory(sdlApp, &plot, HIST_POWER, ct);
+
+            // Adjust y-scale according to the peak watt
+            plot.max_y = 1000; plot.scale_y = 75;    // Default
+            if (avpw < 500) {plot.max_y = 500;    plot.scale_y = 50;}
+            if (avpw < 200) {plot.max_y = 220;    plot.scale_y = 20;}
+            if (avpw < 100) {plot.max_y = 120;    plot.scale_y = 10;}
+            if (avpw < 40)  {plot.max_y = 50;     plot.scale_y = 5;}
+            if (avpw < 20)  {plot.max_y = 30;     plot.scale_y = 3;}
+            if (avpw < 6)   {plot.max_y = 8;      plot.scale_y = 1;}
+            //if (avpw < 3)   {plot.max_y = 5;      plot.scale_y = 1;}
            
-            params.caption_list = caption_list;
-            if(doPlot)
-	            params.coordinate_list = coordinate_list;
-
-            plot_graph(&params);
+            // The history stays in view, greyed out without a live value
+            plotDraw(&plot, !doPlot? PLOT_GREY : curr_value >=0? 0x00FF00 : 0xFF0000);
         }
-#endif
 
         SDL_RenderPresent(sdlApp->renderer);
  
-        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer) {
-            // Read the pixels from the current render target and save them onto the surface
-            // This will slow down the application a bit.
-            SDL_RenderReadPixels(sdlApp->renderer, NULL, SDL_GetWindowPixelFormat(sdlApp->window),
-                sdlApp->conf->vncPixelBuffer->pixels, sdlApp->conf->vncPixelBuffer->pitch);
-            doRGBconv(sdlApp);
-            rfbMarkRectAsModified(sdlApp->conf->vncServer, 0, 0, sdlApp->conf->window_w, sdlApp->conf->window_h);
+        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && govCapture()) {
+            vncCapture(sdlApp);
         }
 
-        SDL_Delay(1000);
+        if (!staleMask)
+            snapTake(sdlApp->renderer, sdlApp->curPage);
+        asetUpload();
+
+        govFrameDelay(1000);
 
         sdlApp->textFieldArrIndx--;
         do {
@@ -3291,25 +3857,9 @@ static int doEnvironment(sdl2_app *sdlApp)
         SDL_DestroyTexture(subTaskbar);
     }
 
-#ifdef PLOTSDL
-    params.screen_width=0;
-    plot_graph(&params);
-#endif
-    SDL_DestroyTexture(gaugeVolt);
-    SDL_DestroyTexture(gaugeVolt24);
-    SDL_DestroyTexture(gaugeCurr);
-    SDL_DestroyTexture(gaugeTemp);
-    SDL_DestroyTexture(needleVolt);
-    SDL_DestroyTexture(needleCurr);
-    SDL_DestroyTexture(needleTemp);
-    SDL_DestroyTexture(menuBar);
-    SDL_DestroyTexture(netStatBar); 
-    SDL_DestroyTexture(muteBar);
-    SDL_DestroyTexture(unmuteBar);  
-    TTF_CloseFont(fontTod);
-    TTF_CloseFont(fontSmall);
-    TTF_CloseFont(fontLarge);
-    IMG_Quit();
+    plotClose(&plot);
+
+    pageWatch(sdlApp, 0);
 
     return event.type;
 }
@@ -3332,21 +3882,20 @@ static int doWater(sdl2_app *sdlApp)
     sdlApp->curPage = WTRPAGE;
 
 
-    TTF_Font* fontHD =  TTF_OpenFont(sdlApp->fontPath, 40);
-    TTF_Font* fontLA =  TTF_OpenFont(sdlApp->fontPath, 40);
-    TTF_Font* fontLO =  TTF_OpenFont(sdlApp->fontPath, 30);
-    TTF_Font* fontMG =  TTF_OpenFont(sdlApp->fontPath, 14);
-    TTF_Font* fontCog = TTF_OpenFont(sdlApp->fontPath, 42);
-    TTF_Font* fontSrc = TTF_OpenFont(sdlApp->fontPath, 14);
-    TTF_Font* fontTod = TTF_OpenFont(sdlApp->fontPath, 12);
+    TTF_Font* fontHD =  asetFont(sdlApp->fontPath, 40);
+    TTF_Font* fontLA =  asetFont(sdlApp->fontPath, 40);
+    TTF_Font* fontLO =  asetFont(sdlApp->fontPath, 30);
+    TTF_Font* fontCog = asetFont(sdlApp->fontPath, 42);
+    TTF_Font* fontSrc = asetFont(sdlApp->fontPath, 14);
+    TTF_Font* fontTod = asetFont(sdlApp->fontPath, 12);
 
-    SDL_Texture* gaugeWtr = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "dflow.png");
-    SDL_Texture* menuBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "menuBar.png");
-    SDL_Texture* netStatBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "netStat.png");
-    SDL_Texture* noNetStatbar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "noNetStat.png");
-    SDL_Texture* muteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "mute.png");
-    SDL_Texture* unmuteBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "unmute.png");
-    SDL_Texture* textBox = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "textBox.png");
+    SDL_Texture* gaugeWtr = asetGet("dflow.png");
+    SDL_Texture* menuBar = asetGet("menuBar.png");
+    SDL_Texture* netStatBar = asetGet("netStat.png");
+    SDL_Texture* noNetStatbar = asetGet("noNetStat.png");
+    SDL_Texture* muteBar = asetGet("mute.png");
+    SDL_Texture* unmuteBar = asetGet("unmute.png");
+    SDL_Texture* textBox = asetGet("textBox.png");
 
     SDL_Rect textField_rect;
 
@@ -3511,16 +4060,15 @@ static int doWater(sdl2_app *sdlApp)
 
         SDL_RenderPresent(sdlApp->renderer); 
 
-        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer) {
-            // Read the pixels from the current render target and save them onto the surface
-            // This will slow down the application a bit.
-            SDL_RenderReadPixels(sdlApp->renderer, NULL, SDL_GetWindowPixelFormat(sdlApp->window),
-                sdlApp->conf->vncPixelBuffer->pixels, sdlApp->conf->vncPixelBuffer->pitch);
-            doRGBconv(sdlApp);
-            rfbMarkRectAsModified(sdlApp->conf->vncServer, 0, 0, sdlApp->conf->window_w, sdlApp->conf->window_h);
+        if (sdlApp->conf->runVnc && sdlApp->conf->vncClients && sdlApp->conf->vncPixelBuffer && govCapture()) {
+            vncCapture(sdlApp);
         }
 
-        SDL_Delay(1000);
+        if (!staleMask)
+            snapTake(sdlApp->renderer, sdlApp->curPage);
+        asetUpload();
+
+        govFrameDelay(1000);
 
         sdlApp->textFieldArrIndx--;
         do {
@@ -3528,21 +4076,6 @@ static int doWater(sdl2_app *sdlApp)
         } while (sdlApp->textFieldArrIndx-- >0);
     }
 
-    SDL_DestroyTexture(gaugeWtr);
-    SDL_DestroyTexture(menuBar);
-    SDL_DestroyTexture(netStatBar);
-    SDL_DestroyTexture(muteBar);
-    SDL_DestroyTexture(unmuteBar);
-    SDL_DestroyTexture(textBox);
-    TTF_CloseFont(fontHD);
-    TTF_CloseFont(fontLA);
-    TTF_CloseFont(fontLO);
-    TTF_CloseFont(fontMG);
-    TTF_CloseFont(fontCog);
-    TTF_CloseFont(fontSrc);
-    TTF_CloseFont(fontTod);
-    IMG_Quit();
-
     return event.type;
 }
 
@@ -3608,11 +4141,11 @@ static int doCalibration(sdl2_app *sdlApp, configuration *configParams)
     SDL_Event event;
     SDL_Rect menuBarR;
 
-    TTF_Font* fontCAL =  TTF_OpenFont(sdlApp->fontPath, 28);
-    TTF_Font* fontPRG =  TTF_OpenFont(sdlApp->fontPath, 11);
-    TTF_Font* fontSrc = TTF_OpenFont(sdlApp->fontPath, 14);
+    TTF_Font* fontCAL =  asetFont(sdlApp->fontPath, 28);
+    TTF_Font* fontPRG =  asetFont(sdlApp->fontPath, 11);
+    TTF_Font* fontSrc = asetFont(sdlApp->fontPath, 14);
 
-    SDL_Texture* menuBar = IMG_LoadTexture(sdlApp->renderer, IMAGE_PATH "menuBar.png");
+    SDL_Texture* menuBar = asetGet("menuBar.png");
 
     CURL *curl = NULL;
 
@@ -3736,6 +4269,7 @@ static int doCalibration(sdl2_app *sdlApp, configuration *configParams)
         addMenuItems(sdlApp, fontSrc);
 
         SDL_RenderPresent(sdlApp->renderer); 
+        wdogFrame();
         
         SDL_Delay(100);
 
@@ -3781,6 +4315,7 @@ static int doCalibration(sdl2_app *sdlApp, configuration *configParams)
             SDL_RenderCopy(sdlApp->renderer, sdlApp->textFieldArr[sdlApp->textFieldArrIndx++], NULL, &textField_rect);
 
             SDL_RenderPresent(sdlApp->renderer); 
+            wdogFrame();
             
             SDL_Delay(100); 
 
@@ -3797,127 +4332,238 @@ static int doCalibration(sdl2_app *sdlApp, configuration *configParams)
     SDL_Delay(1000); 
     SDL_Log("Calibration completed");
 
-    SDL_DestroyTexture(menuBar);
-    TTF_CloseFont(fontCAL);
-    TTF_CloseFont(fontPRG);
-    TTF_CloseFont(fontSrc);
-
     return event.type;
 }
 
-static void closeSDL2(sdl2_app *sdlApp)
+// Release the window and all that is drawn in it, the threads are left alone.
+// The images of each page, decoded first when the page is next
+static const char * const pageAssets[][12] = {
+    [COGPAGE] = { "compassRose.png", "outerRing.png", "clinometer.png", "windDir.png", "menuBar.png", "netStat.png",
+                  "noNetStat.png", "mute.png", "cal.png", "unmute.png", "textBox.png", NULL },
+    [SOGPAGE] = { "sumlog.png", "needle.png", "menuBar.png", "netStat.png", "noNetStat.png", "textBox.png",
+                  "mute.png", "unmute.png", NULL },
+    [DPTPAGE] = { "depthw.png", "depth.png", "depthx10.png", "menuBar.png", "netStat.png", "noNetStat.png",
+                  "needle.png", "mute.png", "unmute.png", "textBox.png", NULL },
+    [WNDPAGE] = { "wind.png", "needle.png", "needle-black.png", "menuBar.png", "netStat.png", "noNetStat.png",
+                  "mute.png", "unmute.png", "textBox.png", NULL },
+    [GPSPAGE] = { "gps.png", "menuBar.png", "netStat.png", "noNetStat.png", "mute.png", "unmute.png", "textBox.png", NULL },
+    [CALPAGE] = { "menuBar.png", NULL },
+    [PWRPAGE] = { "volt.png", "volt-24.png", "curr.png", "temp.png", "sneedle.png", "menuBar.png", "netStat.png",
+                  "noNetStat.png", "mute.png", "unmute.png", NULL },
+    [TSKPAGE] = { NULL },
+    [WTRPAGE] = { "dflow.png", "menuBar.png", "netStat.png", "noNetStat.png", "mute.png", "unmute.png", "textBox.png", NULL },
+    [TRKPAGE] = { "menuBar.png", "netStat.png", "noNetStat.png", "mute.png", "unmute.png", NULL }
+};
+
+static void closeDisplay(sdl2_app *sdlApp)
 {
+    asetClose();
     TTF_Quit();
+    SDL_DestroyTexture(Background_Tx);
+    Background_Tx = NULL;
     SDL_DestroyRenderer(sdlApp->renderer);
+    sdlApp->renderer = NULL;
     SDL_DestroyWindow(sdlApp->window);
-    SDL_VideoQuit();
-    SDL_Quit();
+    sdlApp->window = NULL;
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
 }
 
-static int openSDL2(configuration *configParams, sdl2_app *sdlApp)
+static int openDisplay(configuration *configParams, sdl2_app *sdlApp)
 {
     SDL_Surface* Loading_Surf;
-    SDL_Thread *threadNmea = NULL;
-    SDL_Thread *threadI2C = NULL;
-    SDL_Thread *threadGPS = NULL;
-    SDL_Thread *threadVNC = NULL;
-    SDL_Thread *threadWrn = NULL;
-    configParams->conn = NULL; 
+    char splash[PATH_MAX];
+    static int snapShown;
     Uint32 flags;
 
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,  "Couldn't initialize SDL. Video driver %s!", SDL_GetError());
         return SDL_QUIT;
     }
 
-    if (sqlite3_open_v2(SQLDBPATH, &configParams->conn, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, 0)) {
+    flags = configParams->useWm == 1? SDL_WINDOW_BORDERLESS | SDL_WINDOW_FULLSCREEN | SDL_WINDOW_ALWAYS_ON_TOP : 0;
+
+    if ((sdlApp->window = SDL_CreateWindow("sdlSpeedometer",
+            0, 0, // Pos x/y
+            configParams->window_w, configParams->window_h,
+            flags)) == NULL) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateWindow failed: %s", SDL_GetError());
+            return SDL_QUIT;
+    }
+
+    SDL_ShowCursor(configParams->cursor == 1? SDL_ENABLE : SDL_DISABLE);
+
+    if (configParams->useWm == 1) {
+        SDL_SetWindowBordered( sdlApp->window, SDL_FALSE );
+    }
+
+    sdlApp->renderer = SDL_CreateRenderer(sdlApp->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+
+    SDL_RenderSetScale(sdlApp->renderer, configParams->scale, configParams->scale);
+
+    // The last snapshot at this size, to look at while the rest loads
+    (void)snapInit(SNAPDIR, configParams->window_w, configParams->window_h);
+    sprintf(splash, IMAGE_PATH "splash-%dx%d.png", configParams->window_w, configParams->window_h);
+    if (snapShow(sdlApp->renderer, splash) == 0 && !snapShown++)
+        bootMark("Snapshot shown");
+
+    TTF_Init();
+
+    // Decoded in the background while the snapshot is up
+    (void)asetInit(sdlApp->renderer, IMAGE_PATH);
+
+    Loading_Surf = SDL_LoadBMP(DEFAULT_BACKGROUND);
+    Background_Tx = SDL_CreateTextureFromSurface(sdlApp->renderer, Loading_Surf);
+    SDL_FreeSurface(Loading_Surf);
+
+//    SDL_RaiseWindow(sdlApp->window);
+
+    return 0;
+}
+
+static void closeSDL2(sdl2_app *sdlApp)
+{
+    closeDisplay(sdlApp);
+    SDL_Quit();
+}
+
+static int openSDL2(configuration *configParams, sdl2_app *sdlApp)
+{
+    Uint32 start;
+    configParams->conn = NULL; 
+
+    // The event queue outlives the display, i.e. during a subtask
+    if (SDL_Init(SDL_INIT_EVENTS) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,  "Couldn't initialize SDL: %s!", SDL_GetError());
+        return SDL_QUIT;
+    }
+
+    if (sqlite3_open_v2(SQLDBPATH, &configParams->conn, SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX, 0)) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open configuration databas : %s", (char*)sqlite3_errmsg(configParams->conn));
         (void)sqlite3_close(configParams->conn);
         configParams->conn = NULL;
         return SDL_QUIT;
     }
 
+    if (thrdInit())
+        return SDL_QUIT;
+
+    // The first frame is up before the threads start
+    if (openDisplay(configParams, sdlApp))
+        return SDL_QUIT;
+
+    start = SDL_GetTicks();
+
+    if (configParams->runSnp) {
+        if (thrdStart("threadSnap", threadSnap, configParams, &configParams->runSnp))
+            configParams->runSnp = 0;
+    }
+
+    if (configParams->runAlm) {
+        if (alrmLoad(configParams->conn, &warn) || thrdStart("threadAlarm", threadAlarm, configParams, &configParams->runAlm))
+            configParams->runAlm = 0;
+    }
+
     if (configParams->runNet) {
         if (strncmp(configParams->server, "none", 4)) {
-            threadNmea = SDL_CreateThread(nmeaNetCollector, "nmeaNetCollector", configParams);
-
-            if (NULL == threadNmea) {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateThread nmeaNetCollector failed: %s", SDL_GetError());
-            } else SDL_DetachThread(threadNmea);
+            if (thrdStart("nmeaNetCollector", nmeaNetCollector, configParams, &configParams->runNet))
+                configParams->runNet = 0;
         } else
             configParams->runNet = 0;
     }
 
     if (configParams->runi2c) {
-        threadI2C = SDL_CreateThread(i2cCollector, "i2cCollector", configParams);
-
-        if (NULL == threadI2C) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateThread threadI2C failed: %s", SDL_GetError());
-        } else SDL_DetachThread(threadI2C);
+        if (thrdStart("i2cCollector", i2cCollector, configParams, &configParams->runi2c))
+            configParams->runi2c = 0;
     }
 
     if (configParams->runGps) {
         if (strncmp(configParams->tty, "none", 4)) {
-            threadGPS = SDL_CreateThread(threadSerial, "threadGPS", configParams);
-
-            if (NULL == threadGPS) {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateThread threadGPS failed: %s", SDL_GetError());
-            } else SDL_DetachThread(threadGPS);
+            if (thrdStart("threadGPS", threadSerial, configParams, &configParams->runGps))
+                configParams->runGps = 0;
         } else
          configParams->runGps = 0;   
     }
 
     if (configParams->runVnc == 1) {
-        threadVNC = SDL_CreateThread(threadVnc, "threadVNC", sdlApp);
-        if (NULL == threadVNC) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateThread threadVNC failed: %s", SDL_GetError());
+        // Stopped by rfbShutdownServer, or by thrdStop to be rebound
+        vncRun = 1;
+        if ((vncLock = SDL_CreateMutex()) == NULL || thrdStart("threadVNC", threadVnc, sdlApp, &vncRun))
              configParams->runVnc = 0; 
-        } else { SDL_DetachThread(threadVNC);  configParams->runVnc = 2; }
+        else configParams->runVnc = 2;
     }
 
     if (configParams->runWrn) {
         if (SDL_getenv("SDL_AUDIODRIVER") == NULL) {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_AUDIODRIVER (alsa/pulse) not set in environment. Cannot play warnings");
             configParams->runWrn = 0;
-        } else {
-            threadWrn = SDL_CreateThread(threadWarn, "threadWarn", configParams);
+        } else if (thrdStart("threadWarn", threadWarn, configParams, &configParams->runWrn))
+            configParams->runWrn = 0;
+    }
 
-            if (NULL == threadWrn) {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateThread threadWarn failed: %s", SDL_GetError());
-                configParams->runWrn = 0;
-            } else SDL_DetachThread(threadWrn);
-        }
+    if (configParams->runHst) {
+        if (thrdStart("threadHistory", threadHistory, configParams, &configParams->runHst))
+            configParams->runHst = 0;
     }
 
+    if (configParams->runLgb) {
+        if (thrdStart("threadLogbook", threadLogbook, configParams, &configParams->runLgb))
+            configParams->runLgb = 0;
+    }
 
-    flags = configParams->useWm == 1? SDL_WINDOW_BORDERLESS | SDL_WINDOW_FULLSCREEN | SDL_WINDOW_ALWAYS_ON_TOP : 0;
+    if (configParams->runMtr) {
+        if (thrdStart("threadMetrics", threadMetrics, configParams, &configParams->runMtr))
+            configParams->runMtr = 0;
+    }
 
-    if ((sdlApp->window = SDL_CreateWindow("sdlSpeedometer",
-            0, 0, // Pos x/y
-            configParams->window_w, configParams->window_h,
-            flags)) == NULL) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateWindow failed: %s", SDL_GetError());
-            configParams->runGps = configParams->runi2c = configParams->runNet = configParams->runWrn = 0;
-            return SDL_QUIT;
+    if (configParams->runTrc) {
+        if (thrdStart("threadTrace", threadTrace, configParams, &configParams->runTrc))
+            configParams->runTrc = 0;
     }
 
-    SDL_ShowCursor(configParams->cursor == 1? SDL_ENABLE : SDL_DISABLE);
+    if (configParams->runCfg) {
+        if (confInit(SQLDBPATH) || thrdStart("threadConfig", threadConfig, configParams, &configParams->runCfg))
+            configParams->runCfg = 0;
+    }
 
-    if (configParams->useWm == 1) {
-        SDL_SetWindowBordered( sdlApp->window, SDL_FALSE );
+    if (configParams->runWdg) {
+        if (thrdStart("threadWatchdog", threadWatchdog, configParams, &configParams->runWdg))
+            configParams->runWdg = 0;
+        else
+            wdogWatch();
     }
 
-    sdlApp->renderer = SDL_CreateRenderer(sdlApp->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    SDL_Log("Threads started in %u ms", SDL_GetTicks() - start);
 
-    SDL_RenderSetScale(sdlApp->renderer, configParams->scale, configParams->scale);
+    return 0;
+}
 
-    TTF_Init();
+// Is cmd an executable here or in PATH, as which(1)
+static int inPath(const char *cmd)
+{
+    char path[PATH_MAX];
+    const char *dir, *end;
+    struct stat sb;
 
-    Loading_Surf = SDL_LoadBMP(DEFAULT_BACKGROUND);
-    Background_Tx = SDL_CreateTextureFromSurface(sdlApp->renderer, Loading_Surf);
-    SDL_FreeSurface(Loading_Surf);
+    if (cmd == NULL || *cmd == '\0')
+        return 0;
 
-//    SDL_RaiseWindow(sdlApp->window);
+    if (strchr(cmd, '/') != NULL)
+        return !access(cmd, X_OK) && !stat(cmd, &sb) && S_ISREG(sb.st_mode);
+
+    if ((dir = getenv("PATH")) == NULL)
+        dir = "/usr/local/bin:/usr/bin:/bin";
+
+    for (; *dir; dir = *end? end + 1 : end) {
+        if ((end = strchr(dir, ':')) == NULL)
+            end = dir + strlen(dir);
+
+        if (end == dir)     // An empty entry is the current directory
+            snprintf(path, sizeof(path), "./%s", cmd);
+        else
+            snprintf(path, sizeof(path), "%.*s/%s", (int)(end - dir), dir, cmd);
+        if (!access(path, X_OK) && !stat(path, &sb) && S_ISREG(sb.st_mode))
+            return 1;
+    }
 
     return 0;
 }
@@ -3925,10 +4571,7 @@ static int openSDL2(configuration *configParams, sdl2_app *sdlApp)
 // Check if subtask is within PATH.
 static int checkSubtask(sdl2_app *sdlApp, configuration *configParams)
 {
-    char subtask[PATH_MAX];
-    char buff[PATH_MAX];
     int rval;
-    FILE *fd;
     sqlite3_stmt *res;
     const char *tail;
 
@@ -3945,14 +4588,10 @@ static int checkSubtask(sdl2_app *sdlApp, configuration *configParams)
                 strcpy((sdlApp->subAppsCmd[c][0]=(char*)malloc(PATH_MAX)), (char*)sqlite3_column_text(res, 0));
                 strcpy((sdlApp->subAppsCmd[c][1]=(char*)malloc(PATH_MAX)), (char*)sqlite3_column_text(res, 1));
                 strcpy((sdlApp->subAppsIco[c][2]=(char*)malloc(PATH_MAX)), (char*)sqlite3_column_text(res, 2));
-                sprintf(subtask, "which %s", sdlApp->subAppsCmd[c][0]);
-                *buff = '\0';
-                if ((fd = popen(subtask, "r")) != NULL) {
-                    fgets(buff, sizeof(buff) , fd);
-                    pclose(fd);
-                }
-                if (strlen(buff) < 2)
+                if (!inPath(sdlApp->subAppsCmd[c][0])) {
+                    free(sdlApp->subAppsCmd[c][0]);
                     sdlApp->subAppsCmd[c][0] = NULL;
+                }
 
                 if (c++ >= TSKPAGE) break;
             }
@@ -3968,11 +4607,98 @@ static int checkSubtask(sdl2_app *sdlApp, configuration *configParams)
     return 1;
 }
 
-// Give up all resources in favor of a subtask execution.
+// Forget the subtasks so that checkSubtask() reads them again
+static void resetSubtask(sdl2_app *sdlApp)
+{
+    for (int c = 1; c < TSKPAGE; c++) {
+        free(sdlApp->subAppsCmd[c][0]);
+        free(sdlApp->subAppsCmd[c][1]);
+        free(sdlApp->subAppsIco[c][2]);
+        sdlApp->subAppsCmd[c][0] = sdlApp->subAppsCmd[c][1] = sdlApp->subAppsIco[c][2] = NULL;
+    }
+
+    sdlApp->subAppsCmd[0][0] = NULL;
+}
+
+// Take a changed configuration database in use. Only the subsystems
+// with new settings are restarted, the rest of the instruments keep running.
+int reconfigureDb(configuration *configParams)
+{
+    configuration next = *configParams;
+    warnings w = warn;
+    int changed = 0;
+
+    // Read into copies, the other threads see only what is published under configLock
+    if (configureDb(&next, &w) != SQLITE_OK)
+        return -1;
+
+    // Warning thresholds and compass offsets are taken in place
+    (void)alrmLoad(configParams->conn, &w);
+    SDL_LockMutex(configLock);
+    warn = w;
+    SDL_UnlockMutex(configLock);
+    __atomic_store_n(&calibReload, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&subtaskReload, 1, __ATOMIC_RELAXED);
+
+    if (strcmp(next.tty, configParams->tty) || next.baud != configParams->baud) {
+        if (thrdStop("threadGPS")) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "GPS serial port not changed to %s", next.tty);
+            return -1;
+        }
+        SDL_LockMutex(configLock);
+        strcpy(configParams->tty, next.tty);
+        configParams->baud = next.baud;
+        SDL_UnlockMutex(configLock);
+        configParams->runGps = !noGps && strncmp(configParams->tty, "none", 4);
+        if (configParams->runGps && thrdStart("threadGPS", threadSerial, configParams, &configParams->runGps))
+            configParams->runGps = 0;
+        SDL_Log("GPS serial port now %s at %d baud", configParams->tty, configParams->baud);
+        changed++;
+    }
+
+    if (strcmp(next.server, configParams->server) || next.port != configParams->port) {
+        if (thrdStop("nmeaNetCollector")) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "NMEA server not changed to %s", next.server);
+            return -1;
+        }
+        SDL_LockMutex(configLock);
+        strcpy(configParams->server, next.server);
+        configParams->port = next.port;
+        SDL_UnlockMutex(configLock);
+        configParams->runNet = !noNet && strncmp(configParams->server, "none", 4);
+        if (configParams->runNet && thrdStart("nmeaNetCollector", nmeaNetCollector, configParams, &configParams->runNet))
+            configParams->runNet = 0;
+        SDL_Log("NMEA server now %s:%d", configParams->server, configParams->port);
+        changed++;
+    }
+
+    if (next.vncPort != configParams->vncPort) {
+        // The clients are let go and the server listens again on the new port,
+        // with threadVNC out of rfbProcessEvents and the render loop out of the capture
+        if (configParams->runVnc != 2) {
+            configParams->vncPort = next.vncPort;
+        } else if (thrdStop("threadVNC") == 0) {
+            SDL_LockMutex(vncLock);
+            rfbShutdownServer(configParams->vncServer, TRUE);
+            configParams->vncPort = next.vncPort;
+            SDL_UnlockMutex(vncLock);
+            (void)thrdRestart("threadVNC");
+        } else
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "VNC server not rebound to port %d", next.vncPort);
+        SDL_Log("VNC port now %d", configParams->vncPort);
+        changed++;
+    }
+
+    if (changed && configParams->runWdg)
+        wdogWatch();
+
+    return changed;
+}
+
+// Give up the display in favor of a subtask execution.
+// The collectors, history and alarms keep running in the background.
 static int doSubtask(sdl2_app *sdlApp, configuration *configParams)
 {
-    int runners[4];
-    int t_wmax = 4;
     int status, i=0;
     char *args[20];
     char cmd[1024];
@@ -3989,25 +4715,8 @@ static int doSubtask(sdl2_app *sdlApp, configuration *configParams)
     while(args[i] != NULL)
         args[++i] = strtok(NULL, " ");
 
-    // Take down threads and all of SDL2
-    runners[0] = configParams->runGps;
-    runners[1] = configParams->runi2c;
-    runners[2] = configParams->runNet;
-    runners[3] = configParams->runWrn;
-    configParams->runGps = configParams->runi2c = configParams->runNet = configParams->runWrn = 0;
-
-    while(configParams->numThreads && t_wmax--) {
-        SDL_Delay(350*configParams->numThreads);
-        if (configParams->numThreads) {
-            SDL_Log("Taking down threads #%d remains", configParams->numThreads);
-        }
-    }
-
-    if (configParams->numThreads) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to take down all threads: %d remains.", configParams->numThreads);
-    }
-
-    closeSDL2(sdlApp);
+    wdogHold(1);
+    closeDisplay(sdlApp);
     
     configParams->subTaskPID = fork ();
 
@@ -4016,6 +4725,7 @@ static int doSubtask(sdl2_app *sdlApp, configuration *configParams)
         setpgid(0, 0);
         prctl(PR_SET_PDEATHSIG, SIGINT);
         execv ("/bin/bash", args);
+        _exit(EXIT_FAILURE);
     }
 
     // You've picked my bones clean, speak now ...
@@ -4023,29 +4733,53 @@ static int doSubtask(sdl2_app *sdlApp, configuration *configParams)
     // ... before I reclaim the meat. (Solonius)
 
     configParams->subTaskPID = 0;
-    (void)configureDb(configParams);   // Fetch eventually a new configuration
 
-    // Regain SDL2 control
-    configParams->runGps = runners[0];
-    configParams->runi2c = runners[1];
-    configParams->runNet = runners[2];
-    configParams->runWrn = runners[3];
-    status = openSDL2(configParams, sdlApp);
+    // Fetch eventually a new configuration, unless already taken in use by the watcher
+    if (!thrdRunning("threadConfig"))
+        (void)reconfigureDb(configParams);
 
-    if (status == 0)    
-        status = sdlApp->curPage;
+    // Regain the display
+    if (openDisplay(configParams, sdlApp))
+        return SDL_QUIT;
+
+    wdogHold(0);
+
+    // Touches made in the subtask are not for us
+    SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+    govTouch();
 
-    return status;
+    return sdlApp->curPage;
+}
+
+// Startup timeline against the boot-to-instruments budget. NULL starts the clock.
+void bootMark(const char *what)
+{
+    static struct timespec start;
+    struct timespec now, boot;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (what == NULL) {
+        start = now;
+        return;
+    }
+
+    clock_gettime(CLOCK_BOOTTIME, &boot);
+
+    SDL_Log("Startup: %s after %ld ms, %.1f s since boot", what,
+        (now.tv_sec - start.tv_sec)*1000 + (now.tv_nsec - start.tv_nsec)/1000000, boot.tv_sec + boot.tv_nsec/1e9);
 }
 
 int main(int argc, char *argv[])
 {
-    int c, t_wmax = 4;
+    int c;
+    Uint32 busEvent;
     configuration configParams;
     sdl2_app sdlApp;
     char buf[FILENAME_MAX];
-    struct stat stats;
-    FILE *fd;
+    char *trckPath = NULL;
+    float trckHours = 0;
+    float trckTol = 0;
 
     memset(&cnmea, 0, sizeof(cnmea));
     memset(&sdlApp, 0, sizeof(sdlApp));
@@ -4056,44 +4790,42 @@ int main(int argc, char *argv[])
 
     SDL_LogSetOutputFunction((void*)logCallBack, argv[0]);   
 
+    bootMark(NULL);
+
+    // Make the image pack and leave, at install without display or database
+    if (argc == 3 && !strcmp(argv[1], "-P"))
+        exit(asetMakePack(argv[2])? EXIT_FAILURE : EXIT_SUCCESS);
+
+    strcpy(configParams.ssize, DEFAULT_SCREEN_SIZE);
+
     if (getenv("DISPLAY") != NULL) {    // Wait for Xorg to become ready
-        int i;
-        for (i = 0; i < 5; i++) {
-            system("xdpyinfo  2>/dev/null | grep dimensions | awk '{printf \"%s\", $2}' >/tmp/d-data.txt");
-            if ((fd=fopen("/tmp/d-data.txt", "r")) != NULL) {
-                fstat(fileno(fd), &stats);
-                if (stats.st_size == 0) {
-                    fclose(fd);
-                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Retry (%d): failed to retrive screen size from Xorg", i+1);
-                    sleep(2);
-                    continue;
-                }
-                fread(configParams.ssize, 1, sizeof(configParams.ssize), fd);
-                fclose(fd);
-                break;
-            }
-        }
+        int w, h;
 
-        unlink("/tmp/d-data.txt");
-        if (i >= 5) {
+        if (xwinReady(XORG_WAIT)) {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s: No response from Xorg. Terminating now!\n", argv[0]);
             return 1;
         }
-    }  else {
-        strcpy(configParams.ssize, DEFAULT_SCREEN_SIZE);
+        bootMark("X server ready");
+
+        if (xwinSize(&w, &h) == 0)
+            snprintf(configParams.ssize, sizeof(configParams.ssize), "%dx%d", w, h);
+        else
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to retrive screen size from Xorg, using %s", configParams.ssize);
     }
 
     configParams.scale = DEFAULT_SCREEN_SCALE;
+    configParams.idleTime = IDLE_TIME*60;
+    configParams.cpuBudget = CPU_BUDGET;
 
-    configParams.runGps = configParams.runi2c = configParams.runNet = 1;
+    configParams.runGps = configParams.runi2c = configParams.runNet = configParams.runHst = configParams.runLgb = configParams.runAlm = configParams.runSnp = configParams.runTrc = configParams.runWdg = configParams.runCfg = 1;
         
     sdlApp.nextPage = COGPAGE; // Start-page
 
-    if (configureDb(&configParams) != SQLITE_OK) {  // Fetch configuration
+    if ((configLock = SDL_CreateMutex()) == NULL || configureDb(&configParams, &warn) != SQLITE_OK) {  // Fetch configuration
         exit(EXIT_FAILURE);
     }
 
-    while ((c = getopt (argc, argv, "cChlvginwVps:z:")) != -1)
+    while ((c = getopt (argc, argv, "cChlvginwVtps:z:x:T:D:I:B:M:")) != -1)
     {
         switch (c)
             {
@@ -4105,10 +4837,12 @@ int main(int argc, char *argv[])
             case 'C':   configParams.cursor = 1;    // Show cursor
                 break;
             case 'g':   configParams.runGps = 0;    // Diable GPS data collection
+                        noGps = 1;
                 break;
             case 'i':   configParams.runi2c = 0;    // Disable i2c data collection
                 break;
             case 'n':   configParams.runNet = 0;    // Disable NMEA net data collection
+                        noNet = 1;
                 break;
             case 'w':   configParams.useWm  = 1;    // Use private WM
                 break;
@@ -4120,20 +4854,58 @@ int main(int argc, char *argv[])
                 break;
             case 'z':   configParams.scale = atof(optarg);    // Scale the screen
                 break;
+            case 'x':   trckPath = optarg;          // Export track to a .gpx or .csv file and exit
+                break;
+            case 'T':   trckHours = atof(optarg);   // Hours of track to export
+                break;
+            case 'D':   trckTol = atof(optarg);     // Track simplification tolerance in meters
+                break;
+            case 'I':   configParams.idleTime = atoi(optarg)*60;  // Minutes before idle mode, 0 = never
+                break;
+            case 'B':   configParams.cpuBudget = atoi(optarg);  // Percent of a core for rendering
+                break;
+            case 't':   trceOn = 1;                 // Record a trace from the start
+                break;
+            case 'M':   configParams.runMtr = 1;    // Serve metrics on [address:]port
+                snprintf(configParams.metrics, sizeof(configParams.metrics), "%s", optarg);
+                break;
             case 'v':
                 fprintf(stderr, "revision: %s\n", SWREV);
                 exit(EXIT_SUCCESS);
                 break;
             case 'h':
             default:
-                fprintf(stderr, "Usage: %s -l -c -g -i -n -p -V -w -z -s -v (version)\n", basename(argv[0]));
+                fprintf(stderr, "Usage: %s -l -c -g -i -n -p -t -V -w -z -s -x -T -D -I -B -M -P dir -v (version)\n", basename(argv[0]));
                 fprintf(stderr, "       Where: -l use syslog : -c Create database only: -C show cursor : -g Disable GPS : -i Disable i2c : -p Play warnings\n");
                 fprintf(stderr, "              -n Disabe NMEA Net : -w use WM : -V Enable VNC Server : -z Scale factor : -s Window size w/h\n");
+                fprintf(stderr, "              -x Export track to file.gpx or file.csv : -T Last hours to export : -D Simplify track within meters\n");
+                fprintf(stderr, "              -I Minutes without touch before idle mode at anchor, 0 = never (default %d)\n", IDLE_TIME);
+                fprintf(stderr, "              -B Percent of a core to spend on rendering before frames are slowed down (default %d)\n", CPU_BUDGET);
+                fprintf(stderr, "              -t Record a trace, SIGUSR1 toggles and SIGUSR2 or three fingers dump it to /tmp\n");
+                fprintf(stderr, "              -M [address:]port Serve Prometheus metrics, on localhost unless an address is given\n");
+                fprintf(stderr, "              -P dir Pack the images in dir for install and exit\n");
                 exit(EXIT_FAILURE);
                 break;
             }
     }
 
+    if (trckPath != NULL) {
+        time_t now = time(NULL);
+        int cnt;
+
+        if (trckOpen(TRCKPATH))
+            exit(EXIT_FAILURE);
+
+        cnt = trckExport(trckPath, trckHours > 0? now - (time_t)(trckHours*3600) : 0, now, trckTol);
+        trckClose();
+
+        if (cnt < 0)
+            exit(EXIT_FAILURE);
+
+        fprintf(stderr, "Exported %d track points to %s\n", cnt, trckPath);
+        exit(EXIT_SUCCESS);
+    }
+
     {
         // Resolve -s option
         const char s[2] = "x";
@@ -4159,6 +4931,11 @@ int main(int argc, char *argv[])
         syslog (LOG_NOTICE, "Program started by User %d", getuid ());
     }
 
+    (void)loggInit(logWrite);
+
+    if (trceInit(trceOn))
+        configParams.runTrc = 0;
+
     if (configParams.runVnc == 1) {
         // Create an empty RGB surface that will be used to hold the VNC pixel buffer
         configParams.vncPixelBuffer = SDL_CreateRGBSurface(0, configParams.window_w, configParams.window_h, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000); 
@@ -4182,45 +4959,28 @@ int main(int argc, char *argv[])
         SDL_setenv("SDL_VIDEODRIVER", "x11", 0);
         SDL_Log("Using X11 Videodriver");
 
-        pid_t pid0, pid1=0, pid2;
+        pid_t pid0, pid1=0;
         int status;
 
-        if (configParams.useWm  == 1 && system("xprop -root|grep -q _NET_CLIENT_LIST >/dev/null 2>&1") != 0) {
-
-            sprintf(buf, "xrandr -s %dx%d &>/dev/null", configParams.window_w, configParams.window_h);
-            system(buf);
+        if (configParams.useWm  == 1 && !xwinHasWm()) {
 
-            pid0 = fork();
+            (void)xwinSetSize(configParams.window_w, configParams.window_h);
 
-            if (pid0 == 0) {
+            // Without devilspie2 the window manager would decorate us
+            if (!inPath(DEVILSPIE)) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s not found, no window manager started", DEVILSPIE);
+                pid0 = -1;
+            } else if ((pid0 = fork()) == 0) {
+                loggAfterFork();
                 // Disabe decorations from wm.
                 SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Attempt to start devilspie2");
-                char *args[] = { "/usr/bin/devilspie2", "-f", "/usr/local/etc/devilspie2",  NULL }; 
+                char *args[] = { DEVILSPIE, "-f", "/usr/local/etc/devilspie2",  NULL }; 
                 execvp(args[0], args);
                 SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to execute  %s: %s (non fatal)\n", args[0], strerror(errno));
                 _exit(0);
             }
 
-            sprintf(buf, "/usr/local/share/images/splash-%dx%d.png", configParams.window_w, configParams.window_h);
-            if (stat(buf, &stats) == 0) {
-
-                pid2 = fork();
-
-                if (pid2 == 0 ) {
-                    // Start the splashscreen
-                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Attempt to initiate the splash screen");
-                    char *args[] = { "/usr/bin/xloadimage", "-onroot", "-quiet", "-fullscreen", buf, NULL };
-                    execvp(args[0], args);
-                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to execute  %s %s : %s (non fatal)\n", args[0], buf, strerror(errno));
-                    _exit(0);
-                }
-            } else {
-                SDL_Log("Splash file \"%s not found\"\n", buf);
-            }
-
-            sleep(1);
-
-            if (waitpid(pid0,&status,WNOHANG) == 0) {
+            if (pid0 > 0) {
 
                 pid1 = fork();
 
@@ -4228,6 +4988,8 @@ int main(int argc, char *argv[])
 
                     pid_t pidWmMgr;
 
+                    loggAfterFork();
+
                     for (int i = 1; i < 8; i++) {
 
                         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Attempt to start a window manager");
@@ -4253,33 +5015,26 @@ int main(int argc, char *argv[])
                             _exit(1);
                         }
 
-                        for (int i = 0; i < 5; i++) {
-                            sleep(1);
-                            // Make sure to be on top if wm restarts
-                            if (!system("wmctrl -a sdlSpeedometer >/dev/null 2>&1;")) {
-                                break;
-                            }
-                        }
+                        // Make sure to be on top if wm restarts
+                        (void)xwinRaise("sdlSpeedometer", XWM_WAIT);
 
                         if (waitpid(pidWmMgr,&status,WUNTRACED) != 0) {
                             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "The window manager died unexpectedly. Retry  #%d", i);
-                            sleep(2);
+                            sleep(2);   // Not in a hurry to fail again
                         }
                     }
                     _exit(0);
                 }
-            }
-
-            sleep(2);
 
-            if (pid1>0 && waitpid(pid1,&status,WNOHANG) != 0) {
-                kill(pid0, SIGINT);
-                sleep(1);
-                waitpid(pid0,&status,WNOHANG);
+                // Go on as soon as the window manager has taken the screen
+                if (xwinWaitWm(XWM_WAIT) == 0) {
+                    bootMark("Window manager ready");
+                } else if (pid1 > 0 && waitpid(pid1,&status,WNOHANG) != 0) {
+                    kill(pid0, SIGINT);
+                    waitpid(pid0,&status,0);
+                }
             }
 
-            sleep(1);
-
         }  else {
             if (configParams.useWm == 1) {
                 SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "A window manager is already running. The -w option is disabled.");
@@ -4299,9 +5054,34 @@ int main(int argc, char *argv[])
             }
     }
 
+    (void)histOpen(HISTPATH);
+    (void)archOpen(ARCHPATH);
+    (void)statInit();
+    govInit(configParams.idleTime, configParams.cpuBudget);
+    (void)trckOpen(TRCKPATH);
+
+    // Something to show before the collectors have delivered
+    lastRestore(time(NULL));
+    if (staleMask && lastPage() >= COGPAGE && lastPage() <= TRKPAGE && lastPage() != CALPAGE && lastPage() != TSKPAGE)
+        sdlApp.nextPage = lastPage();
+
+    if (logbInit(LOGBPATH))
+        configParams.runLgb = 0;
+    else
+        logbEvent("sdlSpeedometer %s started", SWREV);
+
     if (openSDL2(&configParams, &sdlApp))
         exit(EXIT_FAILURE);
 
+    bootMark("Display open");
+    (void)wdogNotify("READY=1");
+
+    // New data on the bus wakes up the page loop
+    if ((busEvent = SDL_RegisterEvents(1)) != (Uint32)-1)
+        sdlApp.bus = busSubscribe(0, busEvent);
+    if (sdlApp.bus != NULL)
+        govBus(busEvent);
+
     (void)checkSubtask(&sdlApp, &configParams);
 
     if (configParams.runVnc) {
@@ -4310,6 +5090,20 @@ int main(int argc, char *argv[])
 
     while(1)
     {
+        if (sdlApp.nextPage != CALPAGE && sdlApp.nextPage != TSKPAGE)
+            lastSetPage(sdlApp.nextPage);
+
+        if (sdlApp.nextPage >= COGPAGE && sdlApp.nextPage <= TRKPAGE)
+            asetWant(pageAssets[sdlApp.nextPage]);
+
+        metrPage(sdlApp.nextPage);
+
+        // Subtasks edited in the database, the pages load their icons when entered
+        if (__atomic_exchange_n(&subtaskReload, 0, __ATOMIC_RELAXED)) {
+            resetSubtask(&sdlApp);
+            (void)checkSubtask(&sdlApp, &configParams);
+        }
+
         switch (sdlApp.nextPage)
         {
             case COGPAGE: sdlApp.nextPage = doCompass(&sdlApp);
@@ -4322,6 +5116,8 @@ int main(int argc, char *argv[])
                 break;
             case GPSPAGE: sdlApp.nextPage = doGps(&sdlApp);
                 break;
+            case TRKPAGE: sdlApp.nextPage = doTrack(&sdlApp);
+                break;
             case PWRPAGE: sdlApp.nextPage = doEnvironment(&sdlApp);
                 break;
 #ifdef DIGIFLOW
@@ -4340,28 +5136,32 @@ int main(int argc, char *argv[])
     }
 
     // Terminate the threads
-    if (configParams.runVnc) {
+    if (configParams.runVnc)
         rfbShutdownServer(configParams.vncServer, TRUE);
-        if (configParams.vncPixelBuffer != NULL)
-            SDL_FreeSurface(configParams.vncPixelBuffer);
-    }
 
-    configParams.runGps = configParams.runi2c = configParams.runNet = configParams.runWrn = 0;
+    logbEvent("sdlSpeedometer stopped");
+    (void)wdogNotify("STOPPING=1");
 
     // .. and let them close cleanly
-    while(configParams.numThreads && t_wmax--) {
-        SDL_Delay(1000);
-        if (configParams.numThreads) {
-            SDL_Log("Taking down threads #%d remains", configParams.numThreads);
-        }
-    }
+    thrdStopAll();
 
-    if (configParams.numThreads) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to take down all threads: %d remains.", configParams.numThreads);
-    }
+    (void)lastSave();
+
+    busUnsubscribe(sdlApp.bus);
+
+    if (configParams.runVnc && configParams.vncPixelBuffer != NULL)
+        SDL_FreeSurface(configParams.vncPixelBuffer);
+
+    if (configParams.conn)
+        (void)sqlite3_close_v2(configParams.conn);
     
     closeSDL2(&sdlApp);
 
+    histClose();
+    archClose();
+    trckViewClose();
+    trckClose();
+
     SDL_Log("User terminated");
 
     exit(EXIT_SUCCESS);
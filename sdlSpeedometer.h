@@ -1,17 +1,13 @@
 #ifndef SPEEDOMETER_H
 #define SPEEDOMETER_H
 
+#include <stdint.h>
 #include <sqlite3.h>
 #include <rfb/rfb.h>
 #ifdef HAS_SMBUS_H
 #include <i2c/smbus.h>
 #endif
 
-#ifdef PLOTSDL
-#include <plotsdl/plot.h>
-#include <plotsdl/llist.h>
-#endif
-
 //Dendent on project  https://github.com/ehedman/flowSensor
 //#define DIGIFLOW
 
@@ -54,7 +50,15 @@ typedef struct {
     int runNet;
     int runVnc;
     int runWrn;
-    int numThreads;
+    int runHst;
+    int runLgb;
+    int runAlm;
+    int runSnp;
+    int runMtr;
+    int runTrc;
+    int runWdg;
+    int runCfg;
+    char metrics[100];      // [address:]port of the metrics listener
     short port;
     char server[100];
     int useWm;
@@ -75,6 +79,8 @@ typedef struct {
     int muted;
     int subTaskPID;
     int cursor;
+    int idleTime;
+    int cpuBudget;
 } configuration;
 
 enum sdlPages {
@@ -86,9 +92,12 @@ enum sdlPages {
     CALPAGE,
     PWRPAGE,
     TSKPAGE,
-    WTRPAGE  
+    WTRPAGE,
+    TRKPAGE
 };
 
+typedef struct busSub busSub;
+
 typedef struct {
     SDL_Window *window;
     SDL_Renderer *renderer;
@@ -98,9 +107,12 @@ typedef struct {
     int nextPage;
     int curPage;
     int plotMode;
+    int plotSpan;
+    int trackZoom;
     SDL_Texture* textFieldArr[20];
     int textFieldArrIndx;
     configuration *conf;
+    busSub *bus;            // Wakes up the page loop on new data
 } sdl2_app;
 
 
@@ -115,6 +127,374 @@ extern float i2cReadHdm(int file, calibration *calib);
 extern float i2cReadRoll(int file, int dt, calibration *calib);
 extern void i2creadMAG(int  m[], int file);
 
+// History store channels sampled at 1 Hz
+enum histChannels {
+    HIST_SOG = 0,   // Speed over ground
+    HIST_STW,       // Speed through water
+    HIST_DBT,       // Depth
+    HIST_MTW,       // Water temperature
+    HIST_HDM,       // Heading
+    HIST_ROLL,      // Roll
+    HIST_AWA,       // Apparent wind angle 0-360
+    HIST_AWS,       // Apparent wind speed
+    HIST_TWA,       // True wind angle
+    HIST_TWS,       // True wind speed
+    HIST_VOLT,      // Battery volt
+    HIST_CURR,      // Battery current
+    HIST_TEMP,      // Sensor temperature
+    HIST_POWER,     // Volt * Current
+    HIST_NCHAN
+};
+
+#define HIST_DAYS   7
+#define HIST_SLOTS  (HIST_DAYS*24*3600)
+
+typedef struct {
+    float   min;
+    float   max;
+    float   mean;
+    int     count;
+} histStat;
+
+extern int histOpen(const char *path);
+extern void histClose(void);
+extern void histAppend(time_t ts, const float *row);
+extern time_t histLast(void);
+extern time_t histFirst(void);
+extern float histGet(int chan, time_t ts);
+extern int histStats(int chan, time_t from, time_t to, histStat *st);
+extern int histQuery(int chan, time_t from, time_t to, int n, histStat *out);
+
+// Data bus channels are the history channels and the position
+#define BUS_POS     HIST_NCHAN  // val = lat, val2 = lon
+#define BUS_NCHAN   (HIST_NCHAN+1)
+#define BUS_MASK(c) (1u << (c))
+
+enum busSources {
+    BUS_SRC_NET = 0,    // NMEA network server
+    BUS_SRC_GPS,        // Serial GPS
+    BUS_SRC_I2C         // Compass
+};
+
+typedef struct {
+    time_t  ts;
+    int     chan;
+    int     src;
+    double  val;
+    double  val2;
+} busMsg;
+
+extern void busPublish(int chan, int src, time_t ts, double val, double val2);
+extern busSub *busSubscribe(uint32_t mask, Uint32 event);
+extern void busUnsubscribe(busSub *sub);
+extern void busWatch(busSub *sub, uint32_t mask);
+extern int busFd(busSub *sub);
+extern int busPoll(busSub *sub, busMsg *msg);
+
+// Rolling statistics windows
+enum statWindows {
+    STAT_1MIN = 0,
+    STAT_10MIN,
+    STAT_1H,
+    STAT_NWIN
+};
+
+typedef struct {
+    float   min;
+    float   max;
+    float   mean;       // Circular mean for angles
+    float   stddev;     // Circular deviation for angles
+    int     count;
+} statValue;
+
+extern int statInit(void);
+extern void statAdd(time_t ts, const float *row);
+extern int statGet(int chan, int window, statValue *st);
+
+// Power governor states
+enum govStates {
+    GOV_ACTIVE = 0,
+    GOV_CALM,       // Idle from the next frame
+    GOV_IDLE,       // One frame a second
+    GOV_BLANK       // Display off
+};
+
+extern void govInit(int idleTime, int budget);
+extern int govIdle(void);
+extern void govTouch(void);
+extern void govWake(void);
+extern void govBus(Uint32 event);
+extern void govUpdate(time_t ct, int calm);
+extern void govFrameDelay(int ms);
+extern int govI2cDelay(int dt);
+extern float govPace(void);
+extern int govCapture(void);
+
+// Thread supervisor
+extern int thrdInit(void);
+extern int thrdStart(const char *name, SDL_ThreadFunction fn, void *data, int *run);
+extern int thrdStop(const char *name);
+extern int thrdRestart(const char *name);
+extern void thrdStopAll(void);
+extern int thrdRunning(const char *name);
+extern void thrdOnStop(void (*wake)(void));
+extern int thrdWait(int fd, short events, int ms);
+extern int thrdSleep(int ms);
+extern int thrdWatch(const char *name, int ms);
+extern int thrdStalled(const char **name, Uint32 *ms);
+
+// Alarm engine
+typedef struct {
+    char sound[40];
+    int severity;
+} alrmSound;
+
+extern int alrmLoad(sqlite3 *conn, const warnings *warn);
+extern int threadAlarm(void *conf);
+extern int alrmActive(void);
+extern int alrmUnacked(void);
+extern int alrmSounding(alrmSound *out, int max);
+extern void alrmAck(void);
+extern int alrmWait(int ms);
+
+// Alarm sound mixer
+extern int sndInit(const char *dir);
+extern void sndClose(void);
+extern int sndPlay(const char *name, int prio);
+extern void sndStop(void);
+extern void sndMute(int on);
+extern void sndIdle(void);
+
+// X server queries at startup
+extern int xwinReady(int ms);
+extern int xwinSize(int *w, int *h);
+extern int xwinSetSize(int w, int h);
+extern int xwinHasWm(void);
+extern int xwinWaitWm(int ms);
+extern int xwinRaise(const char *name, int ms);
+
+// Log writer, and a call site that logs at most once per period ms
+typedef struct loggSite {
+    const char  *file;      // The call site, for the summary
+    int         line;
+    int         prio;
+    Uint32      period;
+    Uint32      until;
+    int         suppressed;
+    int         linked;
+    struct loggSite *next;
+} loggSite;
+
+#define LOGG_PERIOD 60000   // ms, for messages repeated while a device or server is gone
+
+#define LOGG_LIMIT(ms, pri, fmt, ...) do { \
+    static loggSite _site = { .file = __FILE__, .line = __LINE__, .prio = pri, .period = ms }; \
+    if (loggAllow(&_site)) SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, pri, fmt, ##__VA_ARGS__); \
+} while (0)
+
+extern int loggInit(void (*out)(int prio, const char *text));
+extern void loggClose(void);
+extern void loggAfterFork(void);
+extern int loggPut(int prio, const char *text);
+extern int loggAllow(loggSite *site);
+
+// Metrics counters, served in the Prometheus text format
+enum metrCounters {
+    METR_RECONNECT = 0, // Connections to the NMEA server
+    METR_VNC_BYTES,     // Sent to VNC clients, a running total
+    METR_VNC_USEC,      // Spent capturing frames for VNC
+    METR_VNC_FRAMES,
+    METR_I2C_ERRORS,
+    METR_I2C_SAMPLES,
+    METR_ALARMS,
+    METR_NCOUNT
+};
+
+extern void metrAdd(int counter, uint64_t n);
+extern void metrSet(int counter, uint64_t val);
+extern void metrSentence(int src, const char *str, int bad);
+extern void metrPage(int page);
+extern void metrFrame(float ms);
+extern int threadMetrics(void *conf);
+
+// Trace recorder, TRCE_SCOPE("name") records the rest of the block
+typedef struct {
+    const char  *name;
+    uint64_t    t0;         // 0 when not recording
+} trceSpan;
+
+extern int trceOn;
+extern uint64_t trceNow(void);
+extern void trceAdd(const char *name, uint64_t t0, uint64_t t1);
+extern int trceInit(int on);
+extern void trceRequest(void);
+extern int threadTrace(void *conf);
+
+static inline trceSpan trceBegin(const char *name)
+{
+    trceSpan span = { name, 0 };
+
+    if (__builtin_expect(__atomic_load_n(&trceOn, __ATOMIC_RELAXED), 0))
+        span.t0 = trceNow();
+
+    return span;
+}
+
+static inline void trceEnd(trceSpan *span)
+{
+    if (__builtin_expect(span->t0 != 0, 0))
+        trceAdd(span->name, span->t0, trceNow());
+}
+
+#define TRCE_VAR2(line) _trce ## line
+#define TRCE_VAR(line) TRCE_VAR2(line)
+#define TRCE_SCOPE(name) trceSpan TRCE_VAR(__LINE__) __attribute__((cleanup(trceEnd))) = trceBegin(name)
+
+// Watchdog, with systemd when run as a notify service
+extern int wdogNotify(const char *state);
+extern void wdogFrame(void);
+extern void wdogHold(int on);
+extern void wdogWatch(void);
+extern int threadWatchdog(void *conf);
+
+// Live configuration, the database is watched for changes
+extern int configureDb(configuration *configParams, warnings *warn);
+extern int reconfigureDb(configuration *configParams);
+extern int confInit(const char *path);
+extern int threadConfig(void *conf);
+
+// Startup timeline
+extern void bootMark(const char *what);
+
+// Last known state, shown at startup
+enum lastNeedles {
+    LAST_COG = 0,   // Compass
+    LAST_ROLL,
+    LAST_SOG,       // Sumlog
+    LAST_DPT,       // Depth
+    LAST_AWA,       // Wind
+    LAST_TWA,
+    LAST_NNEEDLE
+};
+
+extern int lastOpen(const char *path);
+extern int lastSave(void);
+extern void lastUpdate(const busMsg *msg);
+extern int lastGet(int chan, busMsg *msg);
+extern time_t lastSaved(void);
+extern void lastSetNeedle(int n, float angle);
+extern float lastNeedle(int n);
+extern void lastSetPage(int page);
+extern int lastPage(void);
+
+// First frame cache
+extern int snapInit(const char *dir, int w, int h);
+extern int snapShow(SDL_Renderer *renderer, const char *splash);
+extern void snapTake(SDL_Renderer *renderer, int page);
+extern int threadSnap(void *conf);
+
+// Asset cache
+extern int asetInit(SDL_Renderer *renderer, const char *dir);
+extern void asetClose(void);
+extern void asetWant(const char * const *names);
+extern SDL_Texture *asetGet(const char *name);
+extern void asetUpload(void);
+extern struct _TTF_Font *asetFont(const char *path, int size);
+extern int asetMakePack(const char *dir);
+
+// Compressed long term archive of the history store
+extern int archOpen(const char *dir);
+extern void archClose(void);
+extern int archRoll(time_t now);
+extern time_t archFirst(void);
+extern int archQuery(int chan, time_t from, time_t to, int n, histStat *out);
+
+// Track recorder
+#define TRCK_DAYS   10
+#define TRCK_SLOTS  (TRCK_DAYS*24*3600)
+
+typedef struct {
+    int64_t ts;
+    double  lat;        // Decimal degrees
+    double  lon;
+    float   sog;
+    float   cog;
+} trckFix;
+
+extern int trckOpen(const char *path);
+extern void trckClose(void);
+extern void trckAdd(const trckFix *fix);
+extern uint64_t trckCount(void);
+extern uint64_t trckOldest(void);
+extern const trckFix *trckGet(uint64_t idx);
+extern uint64_t trckFind(time_t ts);
+extern int trckExport(const char *path, time_t from, time_t to, double tolerance);
+
+// Breadcrumb view zoom levels
+#define TRCK_ZOOMS  5
+
+extern int trckViewUpdate(void);
+extern int trckViewDraw(SDL_Renderer *renderer, const SDL_Rect *area, int zoom, Uint32 color);
+extern float trckViewScale(int zoom);
+extern void trckViewClose(void);
+
+// Logbook entries
+enum logbKinds {
+    LOGB_ROW = 0,   // Periodic position and instrument data
+    LOGB_EVENT      // Alarms, source changes ...
+};
+
+typedef struct {
+    time_t  ts;
+    int     kind;
+    double  lat;        // Decimal degrees, NAN = unknown
+    double  lon;
+    float   cog;
+    float   sog;
+    float   stw;
+    float   dbt;
+    float   awa;
+    float   aws;
+    float   volt;
+    float   curr;
+    char    text[80];   // Event text
+} logbEntry;
+
+extern int logbInit(const char *path);
+extern void logbPut(const logbEntry *entry);
+extern void logbEvent(const char *fmt, ...);
+extern int threadLogbook(void *conf);
+
+typedef struct {
+    SDL_Renderer *renderer;
+    const char  *fontPath;
+    SDL_Rect    area;           // Position and size on screen
+    float       max_x;          // X-axis range
+    float       max_y;          // Y-axis range
+    float       scale_x;        // X-axis grid
+    float       scale_y;        // Y-axis grid
+    const char  *caption_x;
+    const char  *caption_y;
+    int         npoints;        // Points added since plotClear()
+    int         maxpoints;      // Capacity of the buffers
+    float       *data;          // x, y, lo, hi per point
+    SDL_FPoint  *line;
+#if SDL_VERSION_ATLEAST(2,0,18)
+    SDL_Vertex  *verts;
+    int         *indices;
+#endif
+    SDL_Texture *layer;         // Cached axes and grid
+    int         soft;           // The layer is drawn in software, no target texture
+    float       lmax_x, lmax_y, lscale_x, lscale_y;
+    const char  *lcaption_x, *lcaption_y;
+} plotParams;
+
+extern int plotInit(plotParams *p, SDL_Renderer *renderer, const char *fontPath, int x, int y, int w, int h, int maxpoints);
+extern void plotClose(plotParams *p);
+extern void plotClear(plotParams *p);
+extern void plotAdd(plotParams *p, float x, float y, float lo, float hi);
+extern void plotDraw(plotParams *p, Uint32 color);
+
 typedef struct {
     // Dynamic data from NMEA server
     float   rmc;        // RMC (Speed Over Ground) in knots
@@ -134,6 +514,8 @@ typedef struct {
     float   hdm;        // Heading
     time_t  hdm_ts;     // HDM Timestamp (nmea)
     time_t  hdm_i2cts;  // HDM Timestamp (i2c)
+    float   cog;        // Course over ground, track made good from RMC/VTG
+    time_t  cog_ts;     // COG Timestamp
     float   vwra;       // Relative wind angle (0-180)
     float   vwta;       // True wind angle
     time_t  vwr_ts;     // Wind data Timestamp
@@ -0,0 +1,148 @@
+/*
+ * snapSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The first frame cache. Now and then, and shortly after a page change,
+ * the render loop reads back a frame it has just presented and the snap
+ * thread saves it as a PNG, one per screen size, next to the database.
+ * At startup that picture is the first frame presented, as soon as the
+ * window is there, so the screen looks like the instrument it was while
+ * fonts, images and data are still on their way. Without a snapshot the
+ * splash image of the screen size, if any, is shown instead.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/eventfd.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "sdlSpeedometer.h"
+
+#define SNAP_SETTLE 5000    // ms on a new page before it is taken
+#define SNAP_PERIOD 600000  // ms between snapshots of the same page
+
+static char snapPath[PATH_MAX];
+static SDL_Surface *snapFrame;  // Read back, waiting to be saved
+static int snapBusy;            // The snap thread owns snapFrame
+static int snapFd = -1;
+static int snapPage;
+static Uint32 snapDue;
+
+int snapInit(const char *dir, int w, int h)
+{
+    snprintf(snapPath, sizeof(snapPath), "%sframe-%dx%d.png", dir, w, h);
+
+    if (snapFd < 0 && (snapFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "snapInit: eventfd: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+// Present the snapshot, or splash, as the first frame
+int snapShow(SDL_Renderer *renderer, const char *splash)
+{
+    SDL_Texture *frame;
+
+    if ((frame = IMG_LoadTexture(renderer, snapPath)) == NULL && (splash == NULL || (frame = IMG_LoadTexture(renderer, splash)) == NULL)) {
+        SDL_Log("No first frame in %s or %s", snapPath, splash == NULL? "-" : splash);
+        return -1;
+    }
+
+    SDL_RenderCopy(renderer, frame, NULL, NULL);
+    SDL_RenderPresent(renderer);
+    SDL_DestroyTexture(frame);
+
+    return 0;
+}
+
+// Called after a frame of page is presented, reads it back when due.
+// The caller leaves out frames that show the last known state.
+void snapTake(SDL_Renderer *renderer, int page)
+{
+    Uint32 now = SDL_GetTicks();
+    int w, h;
+
+    if (snapFd < 0)
+        return;
+
+    if (page != snapPage) {
+        snapPage = page;
+        snapDue = now + SNAP_SETTLE;
+        return;
+    }
+
+    if (!SDL_TICKS_PASSED(now, snapDue) || __atomic_load_n(&snapBusy, __ATOMIC_ACQUIRE))
+        return;
+
+    snapDue = now + SNAP_PERIOD;
+
+    TRCE_SCOPE("snapTake");
+
+    if (SDL_GetRendererOutputSize(renderer, &w, &h))
+        return;
+
+    if (snapFrame != NULL && (snapFrame->w != w || snapFrame->h != h)) {
+        SDL_FreeSurface(snapFrame);
+        snapFrame = NULL;
+    }
+
+    if (snapFrame == NULL && (snapFrame = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888)) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "snapTake: %s", SDL_GetError());
+        return;
+    }
+
+    if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, snapFrame->pixels, snapFrame->pitch)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "snapTake: %s", SDL_GetError());
+        return;
+    }
+
+    __atomic_store_n(&snapBusy, 1, __ATOMIC_RELEASE);
+    (void)eventfd_write(snapFd, 1);
+}
+
+// Save what the render loop has read back, aside and renamed into place
+int threadSnap(void *conf)
+{
+    configuration *configParams = conf;
+    char tmp[PATH_MAX+4];
+    eventfd_t cnt;
+
+    SDL_Log("Starting up first frame saver");
+
+    while (configParams->runSnp)
+    {
+        if (thrdWait(snapFd, POLLIN, 10000) < 0)
+            break;
+
+        if (eventfd_read(snapFd, &cnt) || !__atomic_load_n(&snapBusy, __ATOMIC_ACQUIRE))
+            continue;
+
+        snprintf(tmp, sizeof(tmp), "%s.tmp", snapPath);
+
+        if (IMG_SavePNG(snapFrame, tmp)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not save first frame %s: %s", tmp, SDL_GetError());
+            unlink(tmp);
+        } else if (rename(tmp, snapPath)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not save first frame %s: %s", snapPath, strerror(errno));
+            unlink(tmp);
+        }
+
+        __atomic_store_n(&snapBusy, 0, __ATOMIC_RELEASE);
+    }
+
+    SDL_Log("First frame saver stopped");
+
+    return 0;
+}
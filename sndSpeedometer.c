@@ -0,0 +1,273 @@
+/*
+ * sndSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The alarm sound mixer. Every sound in the sounds directory is decoded
+ * and converted to the format of the audio device once at startup, and
+ * the device is opened once and kept. Sounds to play are put in a queue
+ * ordered by priority from where the audio callback picks them up into a
+ * couple of voices that are mixed together, so nothing waits for a sound
+ * to finish. A sound already playing or queued is not queued again.
+ * The device is paused when there is nothing left to play.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <dirent.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define SND_CLIPS   16      // Sounds kept in memory
+#define SND_VOICES  2       // Sounds mixed at once
+#define SND_QUEUE   8       // Sounds waiting for a voice
+#define SND_FREQ    22050   // Wanted device rate
+
+typedef struct {
+    char    name[40];
+    Uint8   *buf;
+    Uint32  len;
+} sndClip;
+
+typedef struct {
+    sndClip *clip;
+    Uint32  pos;
+    int     prio;
+} sndVoice;
+
+static sndClip clips[SND_CLIPS];
+static int nclips;
+static sndVoice voices[SND_VOICES];
+static sndVoice queue[SND_QUEUE];   // Highest priority first
+static int nqueue;
+static SDL_AudioDeviceID dev;
+static SDL_AudioSpec have;
+static int sndMuted;
+static int sndPaused = 1;
+
+// Runs in the audio thread with the device locked
+static void sndMix(void *userdata, Uint8 *stream, int len)
+{
+    (void)userdata;
+
+    memset(stream, have.silence, len);
+
+    for (int v = 0; v < SND_VOICES; v++) {
+        sndVoice *vc = &voices[v];
+        int off = 0;
+
+        while (off < len && !sndMuted) {
+            Uint32 n;
+
+            if (vc->clip == NULL) {
+                if (nqueue == 0)
+                    break;
+                *vc = queue[0];
+                memmove(&queue[0], &queue[1], --nqueue * sizeof(sndVoice));
+            }
+
+            n = vc->clip->len - vc->pos;
+            if (n > (Uint32)(len - off))
+                n = len - off;
+
+            SDL_MixAudioFormat(stream + off, vc->clip->buf + vc->pos, have.format, n, SDL_MIX_MAXVOLUME);
+            off += n;
+
+            if ((vc->pos += n) >= vc->clip->len)
+                vc->clip = NULL;
+        }
+    }
+}
+
+static void sndLoad(const char *dir, const char *name)
+{
+    SDL_AudioSpec wavSpec;
+    SDL_AudioCVT cvt;
+    Uint32 wavLength;
+    Uint8 *wavBuffer;
+    char path[4096];
+    sndClip *clip = &clips[nclips];
+
+    snprintf(path, sizeof(path), "%s%s", dir, name);
+
+    if (SDL_LoadWAV(path, &wavSpec, &wavBuffer, &wavLength) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Sound %s: %s", path, SDL_GetError());
+        return;
+    }
+
+    if (SDL_BuildAudioCVT(&cvt, wavSpec.format, wavSpec.channels, wavSpec.freq, have.format, have.channels, have.freq) < 0 ||
+            (cvt.buf = SDL_malloc(wavLength * cvt.len_mult)) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Sound %s: Cannot convert: %s", path, SDL_GetError());
+        SDL_FreeWAV(wavBuffer);
+        return;
+    }
+
+    cvt.len = wavLength;
+    memcpy(cvt.buf, wavBuffer, wavLength);
+    SDL_FreeWAV(wavBuffer);
+
+    if (SDL_ConvertAudio(&cvt) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Sound %s: Cannot convert: %s", path, SDL_GetError());
+        SDL_free(cvt.buf);
+        return;
+    }
+
+    snprintf(clip->name, sizeof(clip->name), "%s", name);
+    clip->buf = cvt.buf;
+    clip->len = cvt.len_cvt;
+    nclips++;
+}
+
+// Open the device and decode all sounds in dir
+int sndInit(const char *dir)
+{
+    SDL_AudioSpec want;
+    struct dirent *ent;
+    DIR *dp;
+
+    if (dev != 0)
+        return 0;
+
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize audio: %s", SDL_GetError());
+        return -1;
+    }
+
+    memset(&want, 0, sizeof(want));
+    want.freq = SND_FREQ;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = 1024;
+    want.callback = sndMix;
+
+    if ((dev = SDL_OpenAudioDevice(NULL, 0, &want, &have,
+            SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE)) == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't open audio device: %s", SDL_GetError());
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return -1;
+    }
+
+    if ((dp = opendir(dir)) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Sounds in %s: %s", dir, strerror(errno));
+        return 0;
+    }
+
+    while ((ent = readdir(dp)) != NULL && nclips < SND_CLIPS) {
+        size_t len = strlen(ent->d_name);
+        if (len > 4 && len < sizeof(clips[0].name) && !strcasecmp(ent->d_name + len - 4, ".wav"))
+            sndLoad(dir, ent->d_name);
+    }
+
+    closedir(dp);
+
+    SDL_Log("%d sounds loaded, %d Hz %d channel(s)", nclips, have.freq, have.channels);
+
+    return 0;
+}
+
+void sndClose(void)
+{
+    if (dev == 0)
+        return;
+
+    SDL_CloseAudioDevice(dev);
+    dev = 0;
+
+    for (int i = 0; i < nclips; i++)
+        SDL_free(clips[i].buf);
+    nclips = nqueue = 0;
+    memset(voices, 0, sizeof(voices));
+    sndPaused = 1;
+
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+// Queue a sound unless it is already there. Returns at once.
+int sndPlay(const char *name, int prio)
+{
+    sndClip *clip = NULL;
+    int i, busy = 0;
+
+    if (dev == 0 || sndMuted)
+        return -1;
+
+    for (i = 0; i < nclips && clip == NULL; i++) {
+        if (!strcmp(clips[i].name, name))
+            clip = &clips[i];
+    }
+
+    if (clip == NULL)
+        return -1;
+
+    SDL_LockAudioDevice(dev);
+
+    for (i = 0; i < SND_VOICES; i++)
+        busy |= voices[i].clip == clip;
+    for (i = 0; i < nqueue; i++)
+        busy |= queue[i].clip == clip;
+
+    // A full queue gives way to a higher priority only
+    if (!busy && (nqueue < SND_QUEUE || queue[SND_QUEUE-1].prio < prio)) {
+        for (i = nqueue < SND_QUEUE? nqueue++ : SND_QUEUE-1; i > 0 && queue[i-1].prio < prio; i--)
+            queue[i] = queue[i-1];
+        queue[i].clip = clip;
+        queue[i].pos = 0;
+        queue[i].prio = prio;
+    }
+
+    SDL_UnlockAudioDevice(dev);
+
+    if (sndPaused) {
+        SDL_PauseAudioDevice(dev, 0);
+        sndPaused = 0;
+    }
+
+    return 0;
+}
+
+// Silence all, i.e. when an alarm is acknowledged
+void sndStop(void)
+{
+    if (dev == 0)
+        return;
+
+    SDL_LockAudioDevice(dev);
+    memset(voices, 0, sizeof(voices));
+    nqueue = 0;
+    SDL_UnlockAudioDevice(dev);
+}
+
+void sndMute(int on)
+{
+    sndMuted = on;
+
+    if (on)
+        sndStop();
+}
+
+// Pause the device when all is played, to spare the wakeups
+void sndIdle(void)
+{
+    int busy = 0;
+
+    if (dev == 0 || sndPaused)
+        return;
+
+    SDL_LockAudioDevice(dev);
+    for (int i = 0; i < SND_VOICES; i++)
+        busy |= voices[i].clip != NULL;
+    busy |= nqueue;
+    SDL_UnlockAudioDevice(dev);
+
+    if (!busy) {
+        SDL_PauseAudioDevice(dev, 1);
+        sndPaused = 1;
+    }
+}
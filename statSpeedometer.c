@@ -0,0 +1,231 @@
+/*
+ * statSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * Rolling statistics over the last minute, ten minutes and hour for every
+ * channel, fed by the history sampler once a second.
+ * All windows of a channel share one ring of samples. Each window keeps
+ * running sums for the mean and standard deviation and a pair of monotonic
+ * deques where the front is always the window's min or max, so an update
+ * and a query are both O(1) amortized whatever the window length.
+ * Angular channels are summed as unit vectors and get a circular mean and
+ * standard deviation instead.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <SDL2/SDL.h>   // For the purpose of logging
+#include "sdlSpeedometer.h"
+
+#define STAT_RING   3600    // Samples in the longest window
+
+static const int statWidth[STAT_NWIN] = { 60, 600, 3600 };     // Seconds
+
+typedef struct {
+    uint32_t    *seq;       // Sample numbers
+    uint32_t    head;       // Front, oldest
+    uint32_t    tail;       // Next free
+} statDeque;
+
+typedef struct {
+    uint32_t    first;      // Oldest sample in the window
+    double      sum;
+    double      sumsq;
+    double      sins;
+    double      coss;
+    statDeque   min;        // Increasing values
+    statDeque   max;        // Decreasing values
+} statWin;
+
+typedef struct {
+    time_t      ts[STAT_RING];
+    float       val[STAT_RING];
+    uint32_t    next;       // Next sample number
+    statWin     win[STAT_NWIN];
+} statChan;
+
+static statChan *chans;
+static SDL_mutex *statLock;
+
+#define SAMPLE(c, s)    ((c)->val[(s) % STAT_RING])
+#define DQLEN(d)        ((d)->tail - (d)->head)
+
+static inline int statAngular(int chan)
+{
+    return chan == HIST_HDM || chan == HIST_AWA || chan == HIST_TWA;
+}
+
+int statInit(void)
+{
+    uint32_t *seq;
+    size_t n = 0;
+
+    if (chans != NULL)
+        return 0;
+
+    for (int w = 0; w < STAT_NWIN; w++)
+        n += 2*statWidth[w];
+
+    chans = calloc(HIST_NCHAN, sizeof(statChan));
+    seq = calloc(HIST_NCHAN*n, sizeof(uint32_t));
+
+    if (chans == NULL || seq == NULL || (statLock = SDL_CreateMutex()) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "statInit: Out of memory");
+        free(chans);
+        free(seq);
+        chans = NULL;
+        return -1;
+    }
+
+    // A deque never holds more samples than its window
+    for (int c = 0; c < HIST_NCHAN; c++) {
+        for (int w = 0; w < STAT_NWIN; w++) {
+            chans[c].win[w].min.seq = seq;
+            seq += statWidth[w];
+            chans[c].win[w].max.seq = seq;
+            seq += statWidth[w];
+        }
+    }
+
+    return 0;
+}
+
+static inline uint32_t dqAt(statDeque *d, int w, uint32_t i)
+{
+    return d->seq[i % statWidth[w]];
+}
+
+static inline void dqPush(statDeque *d, int w, uint32_t s)
+{
+    d->seq[d->tail++ % statWidth[w]] = s;
+}
+
+// Add one row of HIST_NCHAN values (NAN = no data) for second ts
+void statAdd(time_t ts, const float *row)
+{
+    if (chans == NULL)
+        return;
+
+    SDL_LockMutex(statLock);
+
+    for (int c = 0; c < HIST_NCHAN; c++) {
+        statChan *ch = &chans[c];
+        float v = row[c];
+        uint32_t s = ch->next;
+
+        // Expire what has fallen out of each window
+        for (int w = 0; w < STAT_NWIN; w++) {
+            statWin *wn = &ch->win[w];
+
+            while (wn->first != s && ch->ts[wn->first % STAT_RING] <= ts - statWidth[w]) {
+                float old = SAMPLE(ch, wn->first);
+                wn->sum -= old;
+                wn->sumsq -= (double)old*old;
+                if (statAngular(c)) {
+                    wn->sins -= sin(old * M_PI/180);
+                    wn->coss -= cos(old * M_PI/180);
+                }
+                wn->first++;
+            }
+
+            while (DQLEN(&wn->min) && dqAt(&wn->min, w, wn->min.head) < wn->first)
+                wn->min.head++;
+            while (DQLEN(&wn->max) && dqAt(&wn->max, w, wn->max.head) < wn->first)
+                wn->max.head++;
+        }
+
+        if (isnan(v))
+            continue;
+
+        ch->ts[s % STAT_RING] = ts;
+        ch->val[s % STAT_RING] = v;
+        ch->next++;
+
+        for (int w = 0; w < STAT_NWIN; w++) {
+            statWin *wn = &ch->win[w];
+
+            wn->sum += v;
+            wn->sumsq += (double)v*v;
+            if (statAngular(c)) {
+                wn->sins += sin(v * M_PI/180);
+                wn->coss += cos(v * M_PI/180);
+            }
+
+            while (DQLEN(&wn->min) && SAMPLE(ch, dqAt(&wn->min, w, wn->min.tail-1)) >= v)
+                wn->min.tail--;
+            dqPush(&wn->min, w, s);
+
+            while (DQLEN(&wn->max) && SAMPLE(ch, dqAt(&wn->max, w, wn->max.tail-1)) <= v)
+                wn->max.tail--;
+            dqPush(&wn->max, w, s);
+
+            // Start over from the exact sums now and then
+            if (s % STAT_RING == 0 && wn->first != s) {
+                wn->sum = wn->sumsq = wn->sins = wn->coss = 0;
+                for (uint32_t i = wn->first; i <= s; i++) {
+                    float o = SAMPLE(ch, i);
+                    wn->sum += o;
+                    wn->sumsq += (double)o*o;
+                    if (statAngular(c)) {
+                        wn->sins += sin(o * M_PI/180);
+                        wn->coss += cos(o * M_PI/180);
+                    }
+                }
+            }
+        }
+    }
+
+    SDL_UnlockMutex(statLock);
+}
+
+// Statistics of a channel over one of the windows ending now.
+// Angles are in degrees 0-360. Returns the number of samples.
+int statGet(int chan, int window, statValue *st)
+{
+    statChan *ch;
+    statWin *wn;
+    int n;
+
+    st->min = st->max = st->mean = st->stddev = NAN;
+    st->count = 0;
+
+    if (chans == NULL || chan < 0 || chan >= HIST_NCHAN || window < 0 || window >= STAT_NWIN)
+        return 0;
+
+    ch = &chans[chan];
+    wn = &ch->win[window];
+
+    SDL_LockMutex(statLock);
+
+    n = ch->next - wn->first;
+
+    // Nothing added lately, the samples may be older than the window
+    if (n && ch->ts[(ch->next-1) % STAT_RING] > time(NULL) - statWidth[window]) {
+        st->count = n;
+        st->min = SAMPLE(ch, dqAt(&wn->min, window, wn->min.head));
+        st->max = SAMPLE(ch, dqAt(&wn->max, window, wn->max.head));
+
+        if (statAngular(chan)) {
+            double r = hypot(wn->sins, wn->coss) / n;
+            st->mean = fmod(atan2(wn->sins, wn->coss) * 180/M_PI + 360, 360);
+            st->stddev = r > 0 && r < 1? sqrt(-2*log(r)) * 180/M_PI : (r >= 1? 0 : 180);
+        } else {
+            double var = wn->sumsq/n - (wn->sum/n)*(wn->sum/n);
+            st->mean = wn->sum/n;
+            st->stddev = var > 0? sqrt(var) : 0;
+        }
+    }
+
+    SDL_UnlockMutex(statLock);
+
+    return st->count;
+}
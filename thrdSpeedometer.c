@@ -0,0 +1,364 @@
+/*
+ * thrdSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The thread supervisor. Every worker thread is started joinable through
+ * here and gets its own eventfd as a stop signal. The workers do all of
+ * their sleeping and waiting for i/o with thrdSleep() and thrdWait(), which
+ * poll that eventfd as well, so a stop request is seen at once and not
+ * after the next ten second timeout. Stopping joins the thread within a
+ * bounded grace time and the time it took is logged.
+ * The time a thread leaves thrdWait() is kept as well, so a watched thread
+ * that has been away from it for too long is seen as stalled.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define THRD_MAX    16      // Supervised threads
+#define THRD_GRACE  3000    // ms for a thread to honour a stop
+
+typedef struct {
+    const char  *name;
+    SDL_ThreadFunction fn;
+    void        *data;
+    int         *run;       // Run flag of the thread, may be NULL
+    void        (*wake)(void);  // Extra wake up for a thread waiting elsewhere
+    SDL_Thread  *thread;
+    int         stopfd;
+    int         done;
+    int         left;       // Detached after the grace time, the slot is still its own
+    int         watch;      // ms away from thrdWait() before stalled, 0 = not watched
+    Uint32      busy;       // When it left thrdWait(), 0 while waiting
+} thrdSlot;
+
+static thrdSlot slots[THRD_MAX];
+static SDL_mutex *thrdLock;
+static SDL_cond *thrdDone;
+static __thread thrdSlot *self;
+
+static thrdSlot *thrdFind(const char *name)
+{
+    for (int i = 0; i < THRD_MAX; i++) {
+        if (slots[i].name != NULL && !strcmp(slots[i].name, name))
+            return &slots[i];
+    }
+
+    return NULL;
+}
+
+static int thrdMain(void *arg)
+{
+    thrdSlot *slot = arg;
+    int rval;
+
+    self = slot;
+    rval = slot->fn(slot->data);
+
+    SDL_LockMutex(thrdLock);
+    slot->done = 1;
+    SDL_CondBroadcast(thrdDone);
+    SDL_UnlockMutex(thrdLock);
+
+    return rval;
+}
+
+int thrdInit(void)
+{
+    if (thrdLock != NULL)
+        return 0;
+
+    if ((thrdLock = SDL_CreateMutex()) == NULL || (thrdDone = SDL_CreateCond()) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "thrdInit: %s", SDL_GetError());
+        return -1;
+    }
+
+    return 0;
+}
+
+// Start fn as a supervised thread. A restart reuses the slot of the same name.
+int thrdStart(const char *name, SDL_ThreadFunction fn, void *data, int *run)
+{
+    thrdSlot *slot;
+
+    if (thrdLock == NULL && thrdInit())
+        return -1;
+
+    SDL_LockMutex(thrdLock);
+
+    if ((slot = thrdFind(name)) == NULL) {
+        for (int i = 0; i < THRD_MAX && slot == NULL; i++) {
+            if (slots[i].name == NULL)
+                slot = &slots[i];
+        }
+    }
+
+    // A thread left behind still uses the slot and its stop eventfd
+    if (slot == NULL || slot->thread != NULL || (slot->left && !slot->done)) {
+        SDL_UnlockMutex(thrdLock);
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "thrdStart %s: %s", name, slot == NULL? "No free slot" :
+            slot->thread != NULL? "Already running" : "Not yet stopped");
+        return -1;
+    }
+
+    if (slot->name == NULL && (slot->stopfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        SDL_UnlockMutex(thrdLock);
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "thrdStart %s: eventfd: %s", name, strerror(errno));
+        return -1;
+    }
+
+    slot->name = name;
+    slot->fn = fn;
+    slot->data = data;
+    slot->run = run;
+    slot->wake = NULL;
+    slot->done = 0;
+    slot->left = 0;
+    slot->busy = 0;         // A restarted thread is still watched
+
+    // A stop that nobody waited for
+    eventfd_t dummy;
+    (void)eventfd_read(slot->stopfd, &dummy);
+
+    if ((slot->thread = SDL_CreateThread(thrdMain, name, slot)) == NULL) {
+        SDL_UnlockMutex(thrdLock);
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateThread %s failed: %s", name, SDL_GetError());
+        return -1;
+    }
+
+    SDL_UnlockMutex(thrdLock);
+
+    return 0;
+}
+
+// Called by a thread that blocks on something of its own, i.e. a condition variable
+void thrdOnStop(void (*wake)(void))
+{
+    if (self != NULL)
+        self->wake = wake;
+}
+
+static void thrdSignal(thrdSlot *slot)
+{
+    if (slot->run != NULL)
+        *slot->run = 0;
+
+    (void)eventfd_write(slot->stopfd, 1);
+
+    if (slot->wake != NULL)
+        slot->wake();
+}
+
+// Join within what is left of the grace time. Returns 0 if joined.
+static int thrdJoin(thrdSlot *slot, Uint32 deadline)
+{
+    Uint32 now;
+
+    SDL_LockMutex(thrdLock);
+
+    while (!slot->done && !SDL_TICKS_PASSED((now = SDL_GetTicks()), deadline))
+        SDL_CondWaitTimeout(thrdDone, thrdLock, deadline - now);
+
+    slot->left = !slot->done;
+
+    SDL_UnlockMutex(thrdLock);
+
+    if (slot->left) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Thread %s did not stop within %d ms, left behind", slot->name, THRD_GRACE);
+        SDL_DetachThread(slot->thread);
+        slot->thread = NULL;
+        return -1;
+    }
+
+    SDL_WaitThread(slot->thread, NULL);
+    slot->thread = NULL;
+
+    return 0;
+}
+
+int thrdStop(const char *name)
+{
+    thrdSlot *slot = thrdFind(name);
+    Uint32 start = SDL_GetTicks();
+
+    if (slot == NULL || slot->thread == NULL)
+        return 0;
+
+    thrdSignal(slot);
+
+    if (thrdJoin(slot, start + THRD_GRACE))
+        return -1;
+
+    SDL_Log("Thread %s stopped in %u ms", name, SDL_GetTicks() - start);
+
+    return 0;
+}
+
+// Stop and start again with the same arguments, i.e. after a configuration change
+int thrdRestart(const char *name)
+{
+    thrdSlot *slot = thrdFind(name);
+    Uint32 start = SDL_GetTicks();
+
+    if (slot == NULL)
+        return -1;
+
+    if (slot->thread != NULL) {
+        thrdSignal(slot);
+        (void)thrdJoin(slot, start + THRD_GRACE);
+    }
+
+    // Not while the one left behind could see its run flag set again
+    SDL_LockMutex(thrdLock);
+    if (slot->left && !slot->done) {
+        SDL_UnlockMutex(thrdLock);
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Thread %s not restarted, the old one is still running", name);
+        return -1;
+    }
+    SDL_UnlockMutex(thrdLock);
+
+    if (slot->run != NULL)
+        *slot->run = 1;
+
+    if (thrdStart(slot->name, slot->fn, slot->data, slot->run))
+        return -1;
+
+    SDL_Log("Thread %s restarted in %u ms", name, SDL_GetTicks() - start);
+
+    return 0;
+}
+
+// Signal all at once and then join them all within one grace time
+void thrdStopAll(void)
+{
+    Uint32 start = SDL_GetTicks();
+    int left = 0;
+
+    for (int i = 0; i < THRD_MAX; i++) {
+        if (slots[i].thread != NULL)
+            thrdSignal(&slots[i]);
+    }
+
+    for (int i = 0; i < THRD_MAX; i++) {
+        if (slots[i].thread != NULL)
+            left -= thrdJoin(&slots[i], start + THRD_GRACE);
+    }
+
+    if (left)
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to take down all threads: %d remains.", left);
+    else
+        SDL_Log("All threads stopped in %u ms", SDL_GetTicks() - start);
+}
+
+int thrdRunning(const char *name)
+{
+    thrdSlot *slot = thrdFind(name);
+
+    return slot != NULL && slot->thread != NULL && !slot->done;
+}
+
+/*
+ * Wait up to ms for events on fd, or just sleep if fd < 0.
+ * Returns > 0 if fd is ready, 0 on timeout and -1 on a stop request.
+ */
+int thrdWait(int fd, short events, int ms)
+{
+    struct pollfd pfd[2];
+    int n = 0, rval;
+
+    if (fd >= 0) {
+        pfd[n].fd = fd;
+        pfd[n].events = events;
+        pfd[n++].revents = 0;
+    }
+
+    if (self != NULL) {
+        pfd[n].fd = self->stopfd;
+        pfd[n].events = POLLIN;
+        pfd[n++].revents = 0;
+    }
+
+    if (n == 0) {
+        SDL_Delay(ms);
+        return 0;
+    }
+
+    if (self != NULL)
+        __atomic_store_n(&self->busy, 0, __ATOMIC_RELAXED);
+
+    while ((rval = poll(pfd, n, ms)) < 0 && errno == EINTR)
+        ;
+
+    if (self != NULL)
+        __atomic_store_n(&self->busy, SDL_GetTicks() | 1, __ATOMIC_RELAXED);
+
+    if (rval <= 0)
+        return 0;
+
+    if (self != NULL && pfd[n-1].revents)
+        return -1;
+
+    return pfd[0].revents;
+}
+
+// Sleep ms or until stopped. Returns 1 when stopped.
+int thrdSleep(int ms)
+{
+    return thrdWait(-1, 0, ms) < 0;
+}
+
+// Count a running thread as stalled when away from thrdWait() for ms
+int thrdWatch(const char *name, int ms)
+{
+    thrdSlot *slot;
+
+    SDL_LockMutex(thrdLock);
+
+    if ((slot = thrdFind(name)) != NULL)
+        slot->watch = ms;
+
+    SDL_UnlockMutex(thrdLock);
+
+    return slot == NULL? -1 : 0;
+}
+
+// The watched thread stalled the longest, returns 0 if none is
+int thrdStalled(const char **name, Uint32 *ms)
+{
+    Uint32 now = SDL_GetTicks();
+    int stalled = 0;
+
+    if (thrdLock == NULL)
+        return 0;
+
+    SDL_LockMutex(thrdLock);
+
+    for (int i = 0; i < THRD_MAX; i++) {
+        thrdSlot *slot = &slots[i];
+        Uint32 busy = __atomic_load_n(&slot->busy, __ATOMIC_RELAXED);
+
+        if (slot->thread == NULL || slot->done || !slot->watch || !busy || now - busy <= (Uint32)slot->watch)
+            continue;
+
+        if (!stalled++ || now - busy > *ms) {
+            *name = slot->name;
+            *ms = now - busy;
+        }
+    }
+
+    SDL_UnlockMutex(thrdLock);
+
+    return stalled;
+}
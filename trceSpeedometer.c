@@ -0,0 +1,244 @@
+/*
+ * trceSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The trace recorder, for chasing stutters. TRCE_SCOPE() marks a block
+ * and when recording its start and end in monotonic ns are put into a
+ * ring of the thread that ran it, with no locks and no system calls but
+ * the clock. When not recording a scope costs one well predicted branch.
+ * Recording is started with -t or toggled with SIGUSR1, and SIGUSR2 or
+ * three fingers on the screen dump the rings to a Chrome trace_event
+ * JSON file in /tmp, to be opened in chrome://tracing or Perfetto.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define TRCE_DIR        "/tmp/"
+#define TRCE_EVENTS     8192    // Per thread, a power of two
+#define TRCE_THREADS    32
+
+typedef struct {
+    const char  *name;
+    uint64_t    t0;
+    uint64_t    t1;
+} trceEvent;
+
+typedef struct {
+    uint64_t    head;       // Events written
+    int         tid;
+    int         used;
+    char        name[16];
+    trceEvent   ev[TRCE_EVENTS];
+} trceRing;
+
+int trceOn;
+
+static trceRing *rings[TRCE_THREADS];
+static __thread trceRing *self;
+static pthread_key_t trceKey;
+static int trceFd = -1;
+
+uint64_t trceNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+// The thread is gone, its ring is kept for the dump until taken over
+static void trceRelease(void *ring)
+{
+    __atomic_store_n(&((trceRing*)ring)->used, 0, __ATOMIC_RELEASE);
+}
+
+static trceRing *trceAttach(void)
+{
+    trceRing *ring = NULL;
+
+    for (int i = 0; i < TRCE_THREADS && ring == NULL; i++) {
+        int unused = 0;
+
+        if (rings[i] == NULL) {
+            trceRing *r = calloc(1, sizeof(trceRing));
+            trceRing *none = NULL;
+            if (r == NULL)
+                return NULL;
+            r->used = 1;
+            if (__atomic_compare_exchange_n(&rings[i], &none, r, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                ring = r;
+            else
+                free(r);
+        } else if (__atomic_compare_exchange_n(&rings[i]->used, &unused, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            ring = rings[i];
+            __atomic_store_n(&ring->head, 0, __ATOMIC_RELEASE);
+        }
+    }
+
+    if (ring == NULL)
+        return NULL;
+
+    ring->tid = syscall(SYS_gettid);
+    (void)prctl(PR_GET_NAME, ring->name, 0, 0, 0);
+    (void)pthread_setspecific(trceKey, ring);
+
+    return ring;
+}
+
+// A finished scope into the ring of this thread
+void trceAdd(const char *name, uint64_t t0, uint64_t t1)
+{
+    trceEvent *ev;
+    uint64_t h;
+
+    if (self == NULL && (self = trceAttach()) == NULL)
+        return;
+
+    h = self->head;
+    ev = &self->ev[h % TRCE_EVENTS];
+    ev->name = name;
+    ev->t0 = t0;
+    ev->t1 = t1;
+    __atomic_store_n(&self->head, h + 1, __ATOMIC_RELEASE);
+}
+
+static void trceSignal(int sig)
+{
+    if (sig == SIGUSR1)
+        __atomic_store_n(&trceOn, !__atomic_load_n(&trceOn, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    else
+        trceRequest();
+}
+
+int trceInit(int on)
+{
+    struct sigaction sa;
+
+    if (pthread_key_create(&trceKey, trceRelease))
+        return -1;
+
+    if ((trceFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "trceInit: eventfd: %s", strerror(errno));
+        return -1;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = trceSignal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    (void)sigaction(SIGUSR1, &sa, NULL);
+    (void)sigaction(SIGUSR2, &sa, NULL);
+
+    trceOn = on;
+
+    return 0;
+}
+
+// Ask for a dump, also from a signal handler
+void trceRequest(void)
+{
+    if (trceFd >= 0)
+        (void)eventfd_write(trceFd, 1);
+}
+
+// What is in the rings as trace_event JSON, aside and renamed into place
+static int trceDump(void)
+{
+    static trceEvent copy[TRCE_EVENTS];
+    char path[PATH_MAX], tmp[PATH_MAX+4];
+    int pid = getpid(), n = 0;
+    time_t now = time(NULL);
+    FILE *fp;
+
+    strftime(tmp, sizeof(tmp), "%Y%m%d-%H%M%S", localtime(&now));
+    snprintf(path, sizeof(path), "%ssdlSpeedometer-trace-%s.json", TRCE_DIR, tmp);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    if ((fp = fopen(tmp, "w")) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Trace %s: %s", tmp, strerror(errno));
+        return -1;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    for (int i = 0; i < TRCE_THREADS; i++) {
+        trceRing *r = __atomic_load_n(&rings[i], __ATOMIC_ACQUIRE);
+        uint64_t h0, h1, from;
+
+        if (r == NULL || (h0 = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE)) == 0)
+            continue;
+
+        memcpy(copy, r->ev, sizeof(copy));
+
+        // Events written meanwhile may have overwritten the oldest of the copy
+        h1 = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        from = h1 > TRCE_EVENTS? h1 - TRCE_EVENTS + 1 : 0;
+        if (h0 > TRCE_EVENTS && h0 - TRCE_EVENTS > from)
+            from = h0 - TRCE_EVENTS;
+
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            n++? ",\n" : "", pid, r->tid, r->name);
+
+        for (uint64_t e = from; e < h0; e++) {
+            trceEvent *ev = &copy[e % TRCE_EVENTS];
+            if (ev->t1 < ev->t0)
+                continue;
+            // Monotonic time in us, as the format wants
+            fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                ev->name, pid, r->tid, ev->t0/1000.0, (ev->t1 - ev->t0)/1000.0);
+        }
+    }
+
+    fprintf(fp, "\n]}\n");
+
+    if (fclose(fp) || rename(tmp, path)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Trace %s: %s", path, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+
+    SDL_Log("Trace of %d threads written to %s", n, path);
+
+    return 0;
+}
+
+// Write the dumps asked for, off the render and collector threads
+int threadTrace(void *conf)
+{
+    configuration *configParams = conf;
+    eventfd_t cnt;
+    int rval;
+
+    while (configParams->runTrc)
+    {
+        if ((rval = thrdWait(trceFd, POLLIN, 10000)) < 0)
+            break;
+
+        if (rval > 0 && eventfd_read(trceFd, &cnt) == 0)
+            (void)trceDump();
+    }
+
+    return 0;
+}
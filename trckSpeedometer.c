@@ -0,0 +1,721 @@
+/*
+ * trckSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The track recorder. Every position fix from the collectors, at most one
+ * per second, goes into a memory mapped ring of TRCK_SLOTS fixes that
+ * survives restarts. Tracks are exported as GPX or CSV by streaming fixes
+ * straight to the file, optionally simplified on the fly by an opening
+ * window variant of Douglas-Peucker that needs no more than a bounded
+ * window of points in memory.
+ * The same simplifier feeds the breadcrumb view on the track page.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>   // For the purpose of logging
+#include "sdlSpeedometer.h"
+
+#define TRCK_MAGIC      "SDLTRCK"
+#define TRCK_VERSION    1
+#define TRCK_GAP        300         // Seconds without fixes that starts a new segment
+#define TRCK_WINDOW     1024        // Max points held by the simplifier
+#define EARTH_RADIUS    6371000.0   // Meters
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t slots;
+    uint64_t count;                 // Fixes ever written
+} trckHeader;
+
+typedef struct {
+    double      x;
+    double      y;
+    uint64_t    idx;            // Fix index
+} trckVertex;
+
+typedef struct {
+    double      tol;            // Max deviation, 0 keeps all
+    int         size;           // Window capacity
+    int         nwin;
+    int         started;
+    trckVertex  anchor;         // Last final vertex
+    trckVertex  last;           // Pending vertex
+    trckVertex  *window;        // Vertices since the anchor
+} trckSimp;
+
+static trckHeader *hdr;
+static trckFix *ring;
+static size_t mapSize;
+static SDL_mutex *trckLock;
+
+int trckOpen(const char *path)
+{
+    struct stat sb;
+    int fd;
+    int fresh = 0;
+
+    mapSize = sizeof(trckHeader) + sizeof(trckFix)*TRCK_SLOTS;
+
+    if ((fd = open(path, O_RDWR | O_CREAT, (mode_t)0664)) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open track store %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if (fstat(fd, &sb) < 0 || sb.st_size != mapSize) {
+        fresh = 1;
+        if (ftruncate(fd, 0) < 0 || ftruncate(fd, mapSize) < 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to size track store %s: %s", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+
+    hdr = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (hdr == MAP_FAILED) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to map track store %s: %s", path, strerror(errno));
+        hdr = NULL;
+        return -1;
+    }
+
+    if (fresh || strcmp(hdr->magic, TRCK_MAGIC) || hdr->version != TRCK_VERSION || hdr->slots != TRCK_SLOTS) {
+        memset(hdr, 0, sizeof(trckHeader));
+        hdr->version = TRCK_VERSION;
+        hdr->slots = TRCK_SLOTS;
+        strcpy(hdr->magic, TRCK_MAGIC);
+        SDL_Log("Created a new track store %s for %d days", path, TRCK_DAYS);
+    }
+
+    ring = (trckFix*)(hdr + 1);
+
+    if (trckLock == NULL)
+        trckLock = SDL_CreateMutex();
+
+    return 0;
+}
+
+void trckClose(void)
+{
+    if (hdr == NULL)
+        return;
+
+    (void)msync(hdr, mapSize, MS_SYNC);
+    munmap(hdr, mapSize);
+    hdr = NULL;
+}
+
+// Record a fix. Called from the collectors, only the first fix each second is kept.
+void trckAdd(const trckFix *fix)
+{
+    if (hdr == NULL || isnan(fix->lat) || isnan(fix->lon))
+        return;
+
+    SDL_LockMutex(trckLock);
+
+    if (hdr->count == 0 || fix->ts > ring[(hdr->count-1) % TRCK_SLOTS].ts) {
+        ring[hdr->count % TRCK_SLOTS] = *fix;
+        __sync_synchronize();
+        hdr->count++;
+    }
+
+    SDL_UnlockMutex(trckLock);
+}
+
+// Fix indices are ever increasing. Valid ones are [trckOldest(), trckCount()).
+uint64_t trckCount(void)
+{
+    return hdr == NULL? 0 : hdr->count;
+}
+
+uint64_t trckOldest(void)
+{
+    if (hdr == NULL)
+        return 0;
+
+    return hdr->count > TRCK_SLOTS? hdr->count - TRCK_SLOTS : 0;
+}
+
+const trckFix *trckGet(uint64_t idx)
+{
+    return &ring[idx % TRCK_SLOTS];
+}
+
+// First fix at or after ts
+uint64_t trckFind(time_t ts)
+{
+    uint64_t lo = trckOldest(), hi = trckCount();
+
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo)/2;
+        if (trckGet(mid)->ts < ts)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// Distance from p to the segment a-b in the plane
+static double trckXtd(const trckVertex *a, const trckVertex *b, const trckVertex *p)
+{
+    double bx = b->x - a->x, by = b->y - a->y;
+    double px = p->x - a->x, py = p->y - a->y;
+    double len = bx*bx + by*by;
+    double t = len > 0? (px*bx + py*by)/len : 0;
+
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+
+    return hypot(px - t*bx, py - t*by);
+}
+
+static void simpReset(trckSimp *s)
+{
+    s->nwin = 0;
+    s->started = 0;
+}
+
+// Opening window simplification. The window from the anchor grows until
+// a point in it strays more than tol from anchor-v, then the previous
+// vertex is final and becomes the new anchor.
+// Returns 1 with *out set when a vertex is final.
+static int simpPush(trckSimp *s, const trckVertex *v, trckVertex *out)
+{
+    int emit = 0;
+
+    if (!s->started) {
+        s->started = 1;
+        s->anchor = s->last = *out = *v;
+        return 1;
+    }
+
+    if (s->tol <= 0) {
+        s->anchor = s->last = *out = *v;
+        return 1;
+    }
+
+    if (s->nwin == s->size) {
+        emit = 1;
+    } else {
+        for (int i = 0; i < s->nwin; i++) {
+            if (trckXtd(&s->anchor, v, &s->window[i]) > s->tol) {
+                emit = 1;
+                break;
+            }
+        }
+    }
+
+    if (emit) {
+        *out = s->anchor = s->last;
+        s->nwin = 0;
+    }
+
+    s->window[s->nwin++] = *v;
+    s->last = *v;
+
+    return emit;
+}
+
+// The pending vertex, if any, at the end of a track or segment
+static int simpFlush(trckSimp *s, trckVertex *out)
+{
+    if (!s->started || s->last.idx == s->anchor.idx)
+        return 0;
+
+    *out = s->anchor = s->last;
+    s->nwin = 0;
+
+    return 1;
+}
+
+// Local flat earth in meters around latitude lat0
+static void trckProject(const trckFix *fix, double lat0, trckVertex *v)
+{
+    v->x = fix->lon * cos(lat0 * M_PI/180) * M_PI/180 * EARTH_RADIUS;
+    v->y = fix->lat * M_PI/180 * EARTH_RADIUS;
+}
+
+static void trckWrite(FILE *out, int gpx, const trckFix *fix, int newSeg)
+{
+    char tbuf[40];
+    time_t ts = fix->ts;
+
+    strftime(tbuf, sizeof(tbuf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&ts));
+
+    if (gpx) {
+        if (newSeg)
+            fprintf(out, "    </trkseg>\n    <trkseg>\n");
+        fprintf(out, "      <trkpt lat=\"%.7f\" lon=\"%.7f\"><time>%s</time></trkpt>\n", fix->lat, fix->lon, tbuf);
+    } else {
+        fprintf(out, "%s,%.7f,%.7f,%.1f,%.0f\n", tbuf, fix->lat, fix->lon, fix->sog, fix->cog);
+    }
+}
+
+// Export fixes in [from, to] to path as GPX or CSV (by file extension).
+// Points closer than tolerance meters to the simplified line are dropped.
+// Returns the number of points written or -1.
+int trckExport(const char *path, time_t from, time_t to, double tolerance)
+{
+    static trckVertex window[TRCK_WINDOW];
+    trckSimp simp = { .tol = tolerance, .size = TRCK_WINDOW, .window = window };
+    const char *ext = strrchr(path, '.');
+    int gpx = !(ext != NULL && !strcasecmp(ext, ".csv"));
+    uint64_t idx, end;
+    trckVertex v, out;
+    time_t last = 0;
+    double lat0 = 0;
+    int written = 0;
+    FILE *fd;
+
+    if (hdr == NULL)
+        return -1;
+
+    if ((fd = fopen(path, "w")) == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    setvbuf(fd, NULL, _IOFBF, 64*1024);
+
+    if (gpx) {
+        fprintf(fd, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+        fprintf(fd, "<gpx version=\"1.1\" creator=\"sdlSpeedometer\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n");
+        fprintf(fd, "  <trk>\n    <name>sdlSpeedometer</name>\n    <trkseg>\n");
+    } else {
+        fprintf(fd, "time,lat,lon,sog,cog\n");
+    }
+
+    simpReset(&simp);
+    end = trckCount();
+
+    for (idx = trckFind(from); idx < end; idx++) {
+        const trckFix *fix = trckGet(idx);
+        int newSeg = 0;
+
+        if (idx < trckOldest())     // Overwritten while exporting
+            continue;
+        if (fix->ts > to)
+            break;
+
+        if (written == 0)
+            lat0 = fix->lat;
+
+        if (written && fix->ts - last > TRCK_GAP) {
+            // Close the old segment with its last point and start over
+            if (simpFlush(&simp, &out)) {
+                trckWrite(fd, gpx, trckGet(out.idx), 0);
+                written++;
+            }
+            simpReset(&simp);
+            newSeg = 1;
+        }
+
+        trckProject(fix, lat0, &v);
+        v.idx = idx;
+        last = fix->ts;
+
+        if (simpPush(&simp, &v, &out)) {
+            trckWrite(fd, gpx, trckGet(out.idx), newSeg);
+            written++;
+        }
+    }
+
+    if (simpFlush(&simp, &out)) {
+        trckWrite(fd, gpx, trckGet(out.idx), 0);
+        written++;
+    }
+
+    if (gpx)
+        fprintf(fd, "    </trkseg>\n  </trk>\n</gpx>\n");
+
+    if (fclose(fd)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    return written;
+}
+
+/*
+ * The breadcrumb view.
+ * Fixes are projected once, relative to a fixed origin, and simplified into
+ * one copy of the track per zoom level with a tolerance of one pixel. Each
+ * copy has a grid index of its segments so a frame only visits the cells
+ * under the viewport. All visible segments are drawn as thin quads in one
+ * geometry batch. Only used by the render thread.
+ */
+#define TRCK_VIEW_HOURS 72          // Track shown on the view
+#define TRCK_VWIN       64          // Simplifier window per zoom level
+#define TRCK_BATCH      10000       // Max fixes ingested per frame
+#define TRCK_CELL       128         // Grid cell size in pixels
+#define TRCK_HASH       4096        // Grid hash heads, power of 2
+
+static const float trckScales[TRCK_ZOOMS] = { 2, 10, 50, 250, 1250 };  // Meters per pixel
+
+typedef struct {
+    int         seg;                // First point of the segment
+    int         cx;
+    int         cy;
+    int         next;
+} trckCell;
+
+typedef struct {
+    trckSimp    simp;
+    trckVertex  window[TRCK_VWIN];
+    SDL_FPoint  *pts;               // Simplified, meters from the origin
+    uint8_t     *brk;               // Point starts a new segment after a gap
+    int         *stamp;             // Last frame a segment was drawn
+    int         npts;
+    int         maxpts;
+    trckCell    *cells;
+    int         ncells;
+    int         maxcells;
+    int         heads[TRCK_HASH];
+} trckLevel;
+
+static struct {
+    int         ready;
+    double      lat0;               // Projection origin
+    double      x0;
+    double      y0;
+    time_t      since;              // Oldest fix in view
+    time_t      last;               // Last fix ingested
+    uint64_t    next;               // Next fix index to ingest
+    int         frame;
+    trckLevel   level[TRCK_ZOOMS];
+#if SDL_VERSION_ATLEAST(2,0,18)
+    SDL_Vertex  *verts;
+    int         *indices;
+    int         maxsegs;
+#endif
+} view;
+
+float trckViewScale(int zoom)
+{
+    return trckScales[zoom % TRCK_ZOOMS];
+}
+
+static inline int trckHash(int cx, int cy)
+{
+    return ((unsigned)cx * 73856093u ^ (unsigned)cy * 19349663u) & (TRCK_HASH-1);
+}
+
+static int trckIndex(trckLevel *lv, int seg, int cx, int cy)
+{
+    trckCell *c;
+    int h = trckHash(cx, cy);
+
+    if (lv->ncells == lv->maxcells) {
+        int n = lv->maxcells? lv->maxcells*2 : 4096;
+        trckCell *cells = realloc(lv->cells, sizeof(trckCell)*n);
+        if (cells == NULL)
+            return -1;
+        lv->cells = cells;
+        lv->maxcells = n;
+    }
+
+    c = &lv->cells[lv->ncells];
+    c->seg = seg;
+    c->cx = cx;
+    c->cy = cy;
+    c->next = lv->heads[h];
+    lv->heads[h] = lv->ncells++;
+
+    return 0;
+}
+
+// Append a simplified point and index the segment it ends
+static int trckViewPoint(trckLevel *lv, float cell, const trckVertex *v, int brk)
+{
+    SDL_FPoint *a, *b;
+
+    if (lv->npts == lv->maxpts) {
+        int n = lv->maxpts? lv->maxpts*2 : 1024;
+        SDL_FPoint *pts = realloc(lv->pts, sizeof(SDL_FPoint)*n);
+        uint8_t *brks = realloc(lv->brk, n);
+        int *stamp = realloc(lv->stamp, sizeof(int)*n);
+        if (pts != NULL) lv->pts = pts;
+        if (brks != NULL) lv->brk = brks;
+        if (stamp != NULL) lv->stamp = stamp;
+        if (pts == NULL || brks == NULL || stamp == NULL)
+            return -1;
+        lv->maxpts = n;
+    }
+
+    b = &lv->pts[lv->npts];
+    b->x = v->x - view.x0;
+    b->y = v->y - view.y0;
+    lv->brk[lv->npts] = brk;
+    lv->stamp[lv->npts] = 0;
+
+    if (lv->npts++ == 0 || brk)
+        return 0;
+
+    a = b - 1;
+
+    // Walk the cells the segment crosses, end to end however long it is
+    {
+        int cx = floorf(a->x/cell), cy = floorf(a->y/cell);
+        int ex = floorf(b->x/cell), ey = floorf(b->y/cell);
+        int sx = ex > cx? 1 : -1, sy = ey > cy? 1 : -1;
+        int steps = abs(ex - cx) + abs(ey - cy);
+        float dx = b->x - a->x, dy = b->y - a->y;
+        float tdx = dx != 0? fabsf(cell/dx) : INFINITY;
+        float tdy = dy != 0? fabsf(cell/dy) : INFINITY;
+        float tx = dx != 0? ((cx + (sx > 0)) * cell - a->x)/dx : INFINITY;
+        float ty = dy != 0? ((cy + (sy > 0)) * cell - a->y)/dy : INFINITY;
+
+        for (;;) {
+            if (trckIndex(lv, lv->npts-2, cx, cy))
+                return -1;
+            if (steps-- == 0)
+                break;
+            if (cy == ey || (cx != ex && tx < ty)) {
+                cx += sx;
+                tx += tdx;
+            } else {
+                cy += sy;
+                ty += tdy;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void trckViewReset(void)
+{
+    for (int z = 0; z < TRCK_ZOOMS; z++) {
+        trckLevel *lv = &view.level[z];
+        lv->npts = lv->ncells = 0;
+        memset(lv->heads, -1, sizeof(lv->heads));
+        lv->simp.tol = trckScales[z];
+        lv->simp.size = TRCK_VWIN;
+        lv->simp.window = lv->window;
+        simpReset(&lv->simp);
+    }
+    view.ready = 0;
+    view.frame = 0;
+    view.last = 0;
+}
+
+void trckViewClose(void)
+{
+    for (int z = 0; z < TRCK_ZOOMS; z++) {
+        trckLevel *lv = &view.level[z];
+        free(lv->pts);
+        free(lv->brk);
+        free(lv->stamp);
+        free(lv->cells);
+    }
+#if SDL_VERSION_ATLEAST(2,0,18)
+    free(view.verts);
+    free(view.indices);
+#endif
+    memset(&view, 0, sizeof(view));
+}
+
+// Ingest new fixes into all zoom levels, a batch per call so a long
+// backlog fills in over a few frames. Returns the number of fixes in view or -1 if there is no track.
+int trckViewUpdate(void)
+{
+    time_t now = time(NULL);
+    uint64_t end = trckCount();
+    int err = 0;
+
+    if (hdr == NULL || end == 0)
+        return -1;
+
+    // Start over when the view has grown a day past its span
+    if (!view.ready || now - view.since > (TRCK_VIEW_HOURS+24)*3600 || view.next < trckOldest()) {
+        trckViewReset();
+        view.next = trckFind(now - TRCK_VIEW_HOURS*3600);
+        if (view.next == end)
+            return -1;
+        view.lat0 = trckGet(view.next)->lat;
+        view.since = trckGet(view.next)->ts;
+        {
+            trckVertex o;
+            trckProject(trckGet(view.next), view.lat0, &o);
+            view.x0 = o.x;
+            view.y0 = o.y;
+        }
+        view.ready = 1;
+    }
+
+    if (end - view.next > TRCK_BATCH)
+        end = view.next + TRCK_BATCH;
+
+    for (; view.next < end && !err; view.next++) {
+        const trckFix *fix = trckGet(view.next);
+        int gap = view.last && fix->ts - view.last > TRCK_GAP;
+        trckVertex v, out;
+
+        trckProject(fix, view.lat0, &v);
+        v.idx = view.next;
+
+        for (int z = 0; z < TRCK_ZOOMS && !err; z++) {
+            trckLevel *lv = &view.level[z];
+            float cell = TRCK_CELL * trckScales[z];
+
+            if (gap) {
+                if (simpFlush(&lv->simp, &out))
+                    err = trckViewPoint(lv, cell, &out, 0);
+                simpReset(&lv->simp);
+            }
+            if (!err && simpPush(&lv->simp, &v, &out))
+                err = trckViewPoint(lv, cell, &out, gap);
+        }
+        view.last = fix->ts;
+    }
+
+    if (err) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "trckViewUpdate: Out of memory");
+        trckViewClose();
+        return -1;
+    }
+
+    return (int)(trckCount() - trckFind(view.since));
+}
+
+#if SDL_VERSION_ATLEAST(2,0,18)
+// A segment as a quad of width w
+static void trckQuad(int n, const SDL_FPoint *a, const SDL_FPoint *b, float w, SDL_Color color)
+{
+    SDL_Vertex *v = &view.verts[4*n];
+    int *ix = &view.indices[6*n];
+    float dx = b->x - a->x, dy = b->y - a->y;
+    float len = hypotf(dx, dy);
+    float nx = len > 0? -dy/len * w/2 : w/2;
+    float ny = len > 0? dx/len * w/2 : 0;
+
+    v[0].position.x = a->x + nx; v[0].position.y = a->y + ny;
+    v[1].position.x = a->x - nx; v[1].position.y = a->y - ny;
+    v[2].position.x = b->x + nx; v[2].position.y = b->y + ny;
+    v[3].position.x = b->x - nx; v[3].position.y = b->y - ny;
+
+    for (int i = 0; i < 4; i++) {
+        v[i].color = color;
+        v[i].tex_coord.x = v[i].tex_coord.y = 0;
+    }
+
+    ix[0] = 4*n;   ix[1] = 4*n+1; ix[2] = 4*n+2;
+    ix[3] = 4*n+1; ix[4] = 4*n+3; ix[5] = 4*n+2;
+}
+#endif
+
+// Draw the track north up with the current position in the center of area.
+// Returns the number of segments drawn.
+int trckViewDraw(SDL_Renderer *renderer, const SDL_Rect *area, int zoom, Uint32 color)
+{
+    trckLevel *lv = &view.level[zoom % TRCK_ZOOMS];
+    float mpp = trckScales[zoom % TRCK_ZOOMS];
+    float cell = TRCK_CELL * mpp;
+    float cxs = area->x + area->w/2.0, cys = area->y + area->h/2.0;
+    SDL_Color col = { (color >> 16) & 0xff, (color >> 8) & 0xff, color & 0xff, 255 };
+    SDL_FPoint here, last;
+    int x0, x1, y0, y1;
+    int nsegs = 0;
+
+    if (!view.ready || lv->npts == 0)
+        return 0;
+
+    {
+        trckVertex v;
+        trckProject(trckGet(view.next-1), view.lat0, &v);
+        here.x = v.x - view.x0;
+        here.y = v.y - view.y0;
+    }
+
+    // Viewport in cells, one cell of margin
+    x0 = floorf((here.x - area->w/2.0*mpp)/cell) - 1;
+    x1 = floorf((here.x + area->w/2.0*mpp)/cell) + 1;
+    y0 = floorf((here.y - area->h/2.0*mpp)/cell) - 1;
+    y1 = floorf((here.y + area->h/2.0*mpp)/cell) + 1;
+
+    if (++view.frame == 0)
+        view.frame = 1;
+
+#if SDL_VERSION_ATLEAST(2,0,18)
+    if (view.maxsegs < lv->npts + 1) {
+        int n = lv->npts + 1024;
+        SDL_Vertex *verts = realloc(view.verts, sizeof(SDL_Vertex)*4*n);
+        int *indices = realloc(view.indices, sizeof(int)*6*n);
+        if (verts != NULL) view.verts = verts;
+        if (indices != NULL) view.indices = indices;
+        if (verts == NULL || indices == NULL) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "trckViewDraw: Out of memory");
+            return 0;
+        }
+        view.maxsegs = n;
+    }
+#else
+    SDL_SetRenderDrawColor(renderer, col.r, col.g, col.b, 255);
+#endif
+
+    SDL_RenderSetClipRect(renderer, area);
+
+    for (int cx = x0; cx <= x1; cx++) {
+        for (int cy = y0; cy <= y1; cy++) {
+            for (int c = lv->heads[trckHash(cx, cy)]; c >= 0; c = lv->cells[c].next) {
+                trckCell *e = &lv->cells[c];
+                SDL_FPoint a, b;
+
+                if (e->cx != cx || e->cy != cy || lv->stamp[e->seg] == view.frame)
+                    continue;
+                lv->stamp[e->seg] = view.frame;
+
+                a.x = cxs + (lv->pts[e->seg].x - here.x)/mpp;
+                a.y = cys - (lv->pts[e->seg].y - here.y)/mpp;
+                b.x = cxs + (lv->pts[e->seg+1].x - here.x)/mpp;
+                b.y = cys - (lv->pts[e->seg+1].y - here.y)/mpp;
+#if SDL_VERSION_ATLEAST(2,0,18)
+                trckQuad(nsegs, &a, &b, 2, col);
+#else
+                SDL_RenderDrawLineF(renderer, a.x, a.y, b.x, b.y);
+#endif
+                nsegs++;
+            }
+        }
+    }
+
+    // From the last simplified point to the boat
+    last.x = cxs + (lv->pts[lv->npts-1].x - here.x)/mpp;
+    last.y = cys - (lv->pts[lv->npts-1].y - here.y)/mpp;
+    here.x = cxs;
+    here.y = cys;
+#if SDL_VERSION_ATLEAST(2,0,18)
+    trckQuad(nsegs++, &last, &here, 2, col);
+#else
+    SDL_RenderDrawLineF(renderer, last.x, last.y, here.x, here.y);
+#endif
+
+#if SDL_VERSION_ATLEAST(2,0,18)
+    if (nsegs)
+        SDL_RenderGeometry(renderer, NULL, view.verts, 4*nsegs, view.indices, 6*nsegs);
+#endif
+
+    SDL_RenderSetClipRect(renderer, NULL);
+
+    return nsegs;
+}
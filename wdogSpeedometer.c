@@ -0,0 +1,136 @@
+/*
+ * wdogSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * The watchdog. A frozen display looks alive, so systemd is told that we
+ * are alive only when we are: the render loop beats once a frame and the
+ * watched worker threads are seen by the thread supervisor to come back
+ * to thrdWait(), and as long as none of them has been away for too long
+ * WATCHDOG=1 is sent to $NOTIFY_SOCKET at half the period systemd asks
+ * for. When one has stalled the pings stop, which one and for how long is
+ * logged, and systemd restarts us after WatchdogSec. Without systemd the
+ * stalls are only logged.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <SDL2/SDL.h>
+#include "sdlSpeedometer.h"
+
+#define WDOG_CHECK  5000    // ms between checks without systemd
+#define WDOG_STALL  15000   // ms without a frame, or away from thrdWait()
+
+static Uint32 wdogBeat;     // Last frame, 0 before the first
+static int wdogHeld;        // The display is handed over to a subtask
+static int wdogFd = -1;
+static struct sockaddr_un wdogAddr;
+static socklen_t wdogLen;
+
+// Send a state to systemd, as sd_notify(3)
+int wdogNotify(const char *state)
+{
+    const char *path = getenv("NOTIFY_SOCKET");
+
+    if (path == NULL || (path[0] != '/' && path[0] != '@') || strlen(path) >= sizeof(wdogAddr.sun_path))
+        return -1;
+
+    if (wdogFd < 0) {
+        if ((wdogFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0)
+            return -1;
+        memset(&wdogAddr, 0, sizeof(wdogAddr));
+        wdogAddr.sun_family = AF_UNIX;
+        memcpy(wdogAddr.sun_path, path, strlen(path));
+        if (path[0] == '@')
+            wdogAddr.sun_path[0] = '\0';    // Abstract namespace
+        wdogLen = offsetof(struct sockaddr_un, sun_path) + strlen(path);
+    }
+
+    if (sendto(wdogFd, state, strlen(state), MSG_NOSIGNAL, (struct sockaddr*)&wdogAddr, wdogLen) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "wdogNotify %s: %s", state, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+// From the render loop, once a frame
+void wdogFrame(void)
+{
+    __atomic_store_n(&wdogBeat, SDL_GetTicks() | 1, __ATOMIC_RELAXED);
+}
+
+// The render loop is away on purpose, or back again
+void wdogHold(int on)
+{
+    if (!on)
+        wdogFrame();
+    __atomic_store_n(&wdogHeld, on, __ATOMIC_RELAXED);
+}
+
+int threadWatchdog(void *conf)
+{
+    configuration *configParams = conf;
+    const char *usec = getenv("WATCHDOG_USEC");
+    const char *name, *last = NULL;
+    int period = WDOG_CHECK;
+    Uint32 ms, beat;
+
+    // Ping twice per period, as systemd wants
+    if (usec != NULL && atoll(usec) > 0)
+        period = atoll(usec)/2000;
+
+    SDL_Log("Watchdog checking every %d ms%s", period, usec == NULL? ", without systemd" : "");
+
+    while (configParams->runWdg)
+    {
+        if (thrdSleep(period))
+            break;
+
+        beat = __atomic_load_n(&wdogBeat, __ATOMIC_RELAXED);
+
+        if (beat && !__atomic_load_n(&wdogHeld, __ATOMIC_RELAXED) && SDL_GetTicks() - beat > WDOG_STALL) {
+            name = "render loop";
+            ms = SDL_GetTicks() - beat;
+        } else if (!thrdStalled(&name, &ms)) {
+            if (last != NULL)
+                SDL_Log("Watchdog: %s is running again", last);
+            last = NULL;
+            if (usec != NULL)
+                (void)wdogNotify("WATCHDOG=1");
+            continue;
+        }
+
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Watchdog: %s stalled for %u s%s", name, ms/1000,
+            usec != NULL? ", systemd will restart us" : "");
+        last = name;
+    }
+
+    SDL_Log("Watchdog stopped");
+
+    return 0;
+}
+
+// The worker threads that must not stall
+void wdogWatch(void)
+{
+    static const char * const watched[] = {
+        "nmeaNetCollector", "threadGPS", "i2cCollector", "threadHistory", "threadAlarm", "threadLogbook", NULL
+    };
+
+    for (int i = 0; watched[i] != NULL; i++) {
+        if (thrdRunning(watched[i]))
+            (void)thrdWatch(watched[i], WDOG_STALL);
+    }
+}
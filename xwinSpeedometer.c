@@ -0,0 +1,323 @@
+/*
+ * xwinSpeedometer.c
+ *
+ *  Copyright (C) 2024 by Erland Hedman <erland@hedmanshome.se>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ * Desription:
+ * What used to be asked of xdpyinfo, xprop, xrandr and wmctrl at startup
+ * is asked of the X server directly. The waits for the server, for the
+ * window manager and for our own window are driven by events, inotify on
+ * the X socket directory and property changes on the root window, so the
+ * startup takes as long as Xorg and the window manager do and no longer.
+ * Each call has a connection of its own, which makes them safe to use in
+ * a forked child.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#include <SDL2/SDL.h>
+#ifdef HAS_XRANDR
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/Xrandr.h>
+#endif
+#include "sdlSpeedometer.h"
+
+#define XWIN_SOCKDIR    "/tmp/.X11-unix"
+#define XWIN_RECHECK    250     // ms between attempts when there is no event to wait for
+
+#ifdef HAS_XRANDR
+
+static int xwinXerror(Display *dpy, XErrorEvent *ev)
+{
+    (void)dpy; (void)ev;
+
+    return 0;   // The window may be gone by the time we ask
+}
+
+// Wait up to ms for the X server to accept connections
+int xwinReady(int ms)
+{
+    Uint32 deadline = SDL_GetTicks() + ms;
+    Display *dpy;
+    int fd;
+
+    if ((dpy = XOpenDisplay(NULL)) != NULL) {
+        XCloseDisplay(dpy);
+        return 0;
+    }
+
+    // The server creates its socket when it is about to listen
+    if ((fd = inotify_init1(IN_CLOEXEC)) >= 0 && inotify_add_watch(fd, XWIN_SOCKDIR, IN_CREATE | IN_ATTRIB) < 0) {
+        close(fd);
+        fd = -1;
+    }
+
+    while (!SDL_TICKS_PASSED(SDL_GetTicks(), deadline)) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        char buf[512];
+
+        if (poll(&pfd, fd < 0? 0 : 1, XWIN_RECHECK) > 0)
+            (void)read(fd, buf, sizeof(buf));
+
+        if ((dpy = XOpenDisplay(NULL)) != NULL)
+            break;
+    }
+
+    if (fd >= 0)
+        close(fd);
+
+    if (dpy == NULL)
+        return -1;
+
+    XCloseDisplay(dpy);
+
+    return 0;
+}
+
+int xwinSize(int *w, int *h)
+{
+    Display *dpy;
+
+    if ((dpy = XOpenDisplay(NULL)) == NULL)
+        return -1;
+
+    *w = DisplayWidth(dpy, DefaultScreen(dpy));
+    *h = DisplayHeight(dpy, DefaultScreen(dpy));
+
+    XCloseDisplay(dpy);
+
+    return 0;
+}
+
+// Change the screen to one of its sizes
+int xwinSetSize(int w, int h)
+{
+    XRRScreenConfiguration *conf;
+    XRRScreenSize *sizes;
+    Display *dpy;
+    Rotation rot;
+    int n, rval = -1;
+
+    if ((dpy = XOpenDisplay(NULL)) == NULL)
+        return -1;
+
+    if ((conf = XRRGetScreenInfo(dpy, DefaultRootWindow(dpy))) != NULL) {
+        sizes = XRRConfigSizes(conf, &n);
+        (void)XRRConfigCurrentConfiguration(conf, &rot);
+
+        for (int i = 0; i < n; i++) {
+            if (sizes[i].width == w && sizes[i].height == h) {
+                rval = XRRSetScreenConfig(dpy, conf, DefaultRootWindow(dpy), i, rot, CurrentTime) == Success? 0 : -1;
+                break;
+            }
+        }
+        XRRFreeScreenConfigInfo(conf);
+    }
+
+    if (rval)
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Screen size %dx%d is not available", w, h);
+
+    XCloseDisplay(dpy);
+
+    return rval;
+}
+
+// The clients of the window manager, NULL if there is none
+static Window *xwinClients(Display *dpy, unsigned long *n)
+{
+    Atom list = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+    Atom type;
+    int format;
+    unsigned long after;
+    unsigned char *data = NULL;
+
+    if (XGetWindowProperty(dpy, DefaultRootWindow(dpy), list, 0, 1024, False, XA_WINDOW,
+            &type, &format, n, &after, &data) != Success || type != XA_WINDOW) {
+        if (data != NULL)
+            XFree(data);
+        return NULL;
+    }
+
+    return (Window*)data;
+}
+
+static int xwinNamed(Display *dpy, Window win, const char *name)
+{
+    char *wname = NULL;
+    int rval;
+
+    if (!XFetchName(dpy, win, &wname) || wname == NULL)
+        return 0;
+
+    rval = !strcmp(wname, name);
+    XFree(wname);
+
+    return rval;
+}
+
+// Find name among the clients, or any client if name is NULL
+static Window xwinFind(Display *dpy, const char *name)
+{
+    unsigned long n;
+    Window *clients = xwinClients(dpy, &n), win = None;
+
+    if (clients == NULL)
+        return None;
+
+    for (unsigned long i = 0; i < n && win == None; i++) {
+        if (name == NULL || xwinNamed(dpy, clients[i], name))
+            win = clients[i];
+    }
+
+    if (name == NULL)
+        win = DefaultRootWindow(dpy);   // Just that there is a list at all
+
+    XFree(clients);
+
+    return win;
+}
+
+// Wait up to ms for a client, as xwinFind(), to show up
+static Window xwinWaitFor(Display *dpy, const char *name, int ms)
+{
+    Uint32 deadline = SDL_GetTicks() + ms;
+    Window win;
+    Sint32 left;
+
+    XSelectInput(dpy, DefaultRootWindow(dpy), PropertyChangeMask);
+    XSync(dpy, False);
+
+    // Signed, the deadline may pass between the check and the poll
+    while ((win = xwinFind(dpy, name)) == None && (left = (Sint32)(deadline - SDL_GetTicks())) > 0) {
+        struct pollfd pfd = { ConnectionNumber(dpy), POLLIN, 0 };
+
+        if (!XPending(dpy) && poll(&pfd, 1, left) <= 0)
+            continue;
+
+        while (XPending(dpy)) {
+            XEvent ev;
+            XNextEvent(dpy, &ev);
+        }
+    }
+
+    return win;
+}
+
+int xwinHasWm(void)
+{
+    Display *dpy;
+    int rval;
+
+    if ((dpy = XOpenDisplay(NULL)) == NULL)
+        return 0;
+
+    rval = xwinFind(dpy, NULL) != None;
+
+    XCloseDisplay(dpy);
+
+    return rval;
+}
+
+// Wait up to ms for a window manager to manage the screen
+int xwinWaitWm(int ms)
+{
+    Display *dpy;
+    int rval;
+
+    if ((dpy = XOpenDisplay(NULL)) == NULL)
+        return -1;
+
+    rval = xwinWaitFor(dpy, NULL, ms) != None? 0 : -1;
+
+    XCloseDisplay(dpy);
+
+    return rval;
+}
+
+// Wait up to ms for the window called name and bring it to front
+int xwinRaise(const char *name, int ms)
+{
+    XEvent ev;
+    Display *dpy;
+    Window win;
+
+    if ((dpy = XOpenDisplay(NULL)) == NULL)
+        return -1;
+
+    XSetErrorHandler(xwinXerror);
+
+    if ((win = xwinWaitFor(dpy, name, ms)) == None) {
+        XCloseDisplay(dpy);
+        return -1;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.xclient.type = ClientMessage;
+    ev.xclient.window = win;
+    ev.xclient.message_type = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
+    ev.xclient.format = 32;
+    ev.xclient.data.l[0] = 2;   // From a pager, i.e. on behalf of the user
+    ev.xclient.data.l[1] = CurrentTime;
+
+    XSendEvent(dpy, DefaultRootWindow(dpy), False, SubstructureRedirectMask | SubstructureNotifyMask, &ev);
+    XMapRaised(dpy, win);
+    XSync(dpy, False);
+    XCloseDisplay(dpy);
+
+    return 0;
+}
+
+#else
+
+int xwinReady(int ms)
+{
+    (void)ms;
+
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Built without Xlib and XRandR, the X server is not checked");
+
+    return 0;
+}
+
+int xwinSize(int *w, int *h)
+{
+    (void)w; (void)h;
+
+    return -1;
+}
+
+int xwinSetSize(int w, int h)
+{
+    (void)w; (void)h;
+
+    return -1;
+}
+
+int xwinHasWm(void)
+{
+    return 0;
+}
+
+int xwinWaitWm(int ms)
+{
+    (void)ms;
+
+    return -1;
+}
+
+int xwinRaise(const char *name, int ms)
+{
+    (void)name; (void)ms;
+
+    return -1;
+}
+
+#endif